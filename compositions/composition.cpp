@@ -6,6 +6,10 @@
  * Last Modified Date: September 22, 2019
  */
 
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
 #include <sndfile.h>
 #include <portaudio.h>
 
@@ -13,7 +17,7 @@
 
 namespace audioelectric {
 
-  Composition::Composition(float fs, int sampwidth, int chans) : _fs(fs), _sampwidth(sampwidth), _chans(chans)
+  Composition::Composition(float fs, int sampwidth, int chans) : _fs(fs), _sampwidth(sampwidth), _chans(chans), _time(0)
   {
     
   }
@@ -28,6 +32,7 @@ namespace audioelectric {
     SNDFILE *sf = sf_open(filename.c_str(), SFM_WRITE, &info);
 
     float *frames = new float[bufsize*_chans];
+    _buffer.resize(bufsize);
     size_t frames_left = time*_fs;
     while (frames_left > 0) {
       int nframes = frames_left > bufsize ? bufsize : frames_left;
@@ -49,16 +54,25 @@ namespace audioelectric {
   
   void Composition::generate(float *frames, int nframes)
   {
-    float *f = frames;
-    float *end = frames + nframes;
-    for (; f<end; f++) {
+    memset(frames, 0, sizeof(float)*nframes);
+    while (nframes > 0) {
       updateNotes();
-      *f = 0;
+
+      // Render every instrument up to the next note event
+      size_t n = framesToNextNote();
+      if (n > (size_t)nframes)
+        n = nframes;
       for (auto& inst : _instruments) {
-        *f += inst.value();
-        inst.increment();
+        inst.process(_buffer.data(), n);
+        for (size_t i=0; i<n; i++)
+          frames[i] += _buffer[i];
       }
-      _time++;
+
+      for (auto& part : _score)
+        part.lastnote += n;
+      _time += n;
+      frames += n;
+      nframes -= n;
     }
   }
 
@@ -81,9 +95,21 @@ namespace audioelectric {
       // Now we need to release notes that are done and remove them from _playing
       auto is_done = [](Note n, size_t time) {return time >= n.length_or_tstop;};
       playing.remove_if(std::bind(is_done, std::placeholders::_1, _time));
-      lastnote++;
     }
   }
+
+  size_t Composition::framesToNextNote(void) const
+  {
+    size_t next = SIZE_MAX;
+    for (auto& part : _score) {
+      if (part.notes.empty())
+        continue;
+      size_t wait = part.notes.front().tstart - part.lastnote;
+      if (wait < next)
+        next = wait;
+    }
+    return next;
+  }
   
 
 }  // audioelectric
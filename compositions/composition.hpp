@@ -83,6 +83,7 @@ namespace audioelectric {
     std::vector<Cloud<float>> _instruments;
     std::vector<Part> _score;
     std::vector<std::list<Note>> _playing;
+    std::vector<float> _buffer;         //!< Scratch buffer that each instrument is rendered into
 
     /*!\brief Generates the next set of frames from the instruments
      */
@@ -91,6 +92,10 @@ namespace audioelectric {
     /*!\brief Starts or releases any notes that are queued up to be started or released
      */
     void updateNotes(void);
+
+    /*!\brief Returns the number of frames until the next note in any part is due to start
+     */
+    size_t framesToNextNote(void) const;
     
   };
 
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <list>
 
 namespace audioelectric {
@@ -31,4 +32,20 @@ namespace audioelectric {
     }
   }
 
+  /*!\brief Adds the next frames values of the objects in one "active" list to out, and moves any of the objects that
+   * evaluate to false afterward to a second "inactive" list.
+   */
+  template <typename T, typename S>
+  void processAndRemove(std::list<T>& active, std::list<T>& inactive, S* out, size_t frames) {
+    auto itr = active.begin();
+    while (itr != active.end()) {
+      itr->process(out, frames);
+      auto old_itr = itr;
+      itr++;
+      if (!*old_itr) {
+        inactive.splice(inactive.end(), active, old_itr);
+      }
+    }
+  }
+
 }  // audioelectric
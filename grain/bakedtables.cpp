@@ -0,0 +1,60 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include "bakedtables.hpp"
+
+namespace audioelectric {
+
+  namespace {
+
+    /*!\brief Every baked table of one length, which the compiler computes
+     */
+    template <size_t N>
+    struct Baked {
+      static constexpr std::array<double, N> tri0 = baked::triangleTable<N>(0);
+      static constexpr std::array<double, N> tri80 = baked::triangleTable<N>(0.8);
+      static constexpr std::array<double, N> square50 = baked::squareTable<N>(0.5);
+    };
+
+    /*!\brief A baked table and what it was generated with
+     */
+    struct BakedEntry {
+      TableType type;
+      size_t len;
+      double param;
+      const double* data;
+    };
+
+    template <size_t N>
+    constexpr std::array<BakedEntry, 3> entries(void)
+    {
+      return {{{TableType::TRIANGLE, N, 0, Baked<N>::tri0.data()},
+               {TableType::TRIANGLE, N, 0.8, Baked<N>::tri80.data()},
+               {TableType::SQUARE, N, 0.5, Baked<N>::square50.data()}}};
+    }
+
+    const std::array<BakedEntry, 3> baked_tables[] = {entries<1024>(), entries<2048>(), entries<4096>()};
+
+  }
+
+  template <typename T>
+  const double* BakedTable(TableType type, size_t len, T param)
+  {
+    for (auto& tables : baked_tables) {
+      for (auto& entry : tables) {
+        if (entry.type == type && entry.len == len && (T)entry.param == param)
+          return entry.data;
+      }
+    }
+    return nullptr;
+  }
+
+  template const double* BakedTable<double>(TableType, size_t, double);
+  template const double* BakedTable<float>(TableType, size_t, float);
+
+}  // audioelectric
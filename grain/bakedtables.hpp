@@ -0,0 +1,69 @@
+/* \file bakedtables.hpp
+ * \brief Defines the constexpr generators of the standard tables, and the tables that are baked into the library
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ *
+ * The generators compute the same functions as GenerateTriangle() and GenerateSquare(), but they can be evaluated by
+ * the compiler. The library bakes the carrier tables of a Cloud at the standard lengths (see BakedTable()), and
+ * TableCache copies those rather than generating them. Grain shapes are GrainWindows and sine carriers are
+ * SineCarriers, so neither needs a baked table.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "tablecache.hpp"
+
+namespace audioelectric {
+
+  namespace baked {
+
+    /*!\brief Returns a table of GenerateTriangle()
+     */
+    template <size_t N>
+    constexpr std::array<double, N> triangleTable(double slant)
+    {
+      std::array<double, N> table{};
+      size_t uplen = (N/2)*(1 + slant);
+      size_t i = 0;
+      for (; i<uplen; i++)
+        table[i] = i*(1./uplen);
+      for (size_t j=0; i<N; i++, j++)
+        table[i] = 1.0 - j*(1./(N - uplen));
+      return table;
+    }
+
+    /*!\brief Returns a table of GenerateSquare()
+     */
+    template <size_t N>
+    constexpr std::array<double, N> squareTable(double width)
+    {
+      std::array<double, N> table{};
+      for (size_t i=N*width; i<N; i++)
+        table[i] = 1.0;
+      return table;
+    }
+
+  }  // baked
+
+  /*!\brief Returns a table that is baked into the library, or nullptr if there isn't one
+   *
+   * The baked tables are every combination of the lengths 1024, 2048 and 4096 with TRIANGLE tables at slants of 0 and
+   * 0.8 and SQUARE tables at a width of 0.5 (which covers the table carriers of a Cloud).
+   *
+   * \param type  The generator
+   * \param len   The length of the table
+   * \param param The generator's parameter. It matches a baked parameter that rounds to the same T
+   * \return The len samples of the table
+   */
+  template <typename T>
+  const double* BakedTable(TableType type, size_t len, T param);
+
+}  // audioelectric
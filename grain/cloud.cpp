@@ -5,21 +5,32 @@
  * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
  * Last Modified Date: July 27, 2019
  */
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
 #include "cloud.hpp"
 #include "algorithm.hpp"
+#include "resample.hpp"
+#include "samplelibrary.hpp"
+#include "tablecache.hpp"
 #include "waveform.hpp"
 
 namespace audioelectric {
 
   template <typename T>
-  Cloud<T>::Cloud(size_t fs) : _fs(fs)
+  Cloud<T>::Cloud(size_t fs) :
+    _fs(fs), _control_frames(VOICE_CONTROL_FRAMES), _seed(0), _fixed_point(false), _table_size(DEFAULT_TABLE_SIZE),
+    _file_carrier(false), _live(nullptr), _live_delay(0), _block_stride(0), _block_channels(1), _max_block(CLOUD_MAX_BLOCK)
   {
     setShape(DEFAULT_SHAPE);
     setCarrier(DEFAULT_CARRIER);
   }
 
   template <typename T>
-  Cloud<T>::Cloud(size_t fs, int voices, Shape shape, Carrier carrier) : _fs(fs)
+  Cloud<T>::Cloud(size_t fs, int voices, Shape shape, Carrier carrier) :
+    _fs(fs), _control_frames(VOICE_CONTROL_FRAMES), _seed(0), _fixed_point(false), _table_size(DEFAULT_TABLE_SIZE),
+    _file_carrier(false), _live(nullptr), _live_delay(0), _block_stride(0), _block_channels(1), _max_block(CLOUD_MAX_BLOCK)
   {
     setShape(shape);
     setCarrier(carrier);
@@ -27,7 +38,9 @@ namespace audioelectric {
   }
 
   template <typename T>
-  Cloud<T>::Cloud(size_t fs, int voices, Shape shape, std::string afile, size_t begin, size_t end) : _fs(fs)
+  Cloud<T>::Cloud(size_t fs, int voices, Shape shape, std::string afile, size_t begin, size_t end) :
+    _fs(fs), _control_frames(VOICE_CONTROL_FRAMES), _seed(0), _fixed_point(false), _table_size(DEFAULT_TABLE_SIZE),
+    _file_carrier(false), _live(nullptr), _live_delay(0), _block_stride(0), _block_channels(1), _max_block(CLOUD_MAX_BLOCK)
   {
     setShape(shape);
     setCarrier(afile, begin, end);
@@ -77,8 +90,11 @@ namespace audioelectric {
   T Cloud<T>::value(void) const
   {
     T out = 0;
-    for (auto& voice : _active)
+    // Voices that are between grains are silent
+    for (auto& voice : _active) {
+      if (voice._graingen)
         out += voice.value();
+    }
     return out;
   }
 
@@ -88,52 +104,211 @@ namespace audioelectric {
     incrementAndRemove(_active, _inactive);
   }
 
+  template <typename T>
+  void Cloud<T>::process(T* const* outputs, size_t channels, size_t frames)
+  {
+    for (size_t c=0; c<channels; c++)
+      memset(outputs[c], 0, sizeof(T)*frames);
+    for (size_t done=0; done<frames; done+=_max_block)
+      processBlock(outputs, channels, done, std::min(frames - done, _max_block));
+  }
+
+  template <typename T>
+  void Cloud<T>::processBlock(T* const* outputs, size_t channels, size_t offset, size_t frames)
+  {
+    size_t voices = _active.size();
+    if (voices == 0)
+      return;
+    bool parallel = _render && voices > 1;
+    // The voices only render the carrier channels that the outputs play
+    size_t rendered = std::min(channels, _block_channels);
+    size_t span = (rendered - 1)*_block_stride + frames;
+
+    // Each voice starts from a silent buffer either way, so the sums below don't depend on how the voices were rendered
+    if (parallel) {
+      // The buffers and the list have room for every voice (see sizeBlocks())
+      auto rendering = _rendering.begin();
+      for (auto& voice : _active)
+        *rendering++ = &voice;
+      _render->run(voices, [this, frames, rendered, span](size_t i) {
+          T* buffer = block(i);
+          memset(buffer, 0, sizeof(T)*span);
+          _rendering[i]->process(buffer, frames, rendered, _block_stride);
+        });
+      for (size_t i=0; i<voices; i++)
+        mixBlock(outputs, channels, offset, block(i), frames);
+    }
+    else {
+      T* buffer = block(0);
+      for (auto& voice : _active) {
+        memset(buffer, 0, sizeof(T)*span);
+        voice.process(buffer, frames, rendered, _block_stride);
+        mixBlock(outputs, channels, offset, buffer, frames);
+      }
+    }
+
+    // The voices that have finished go back to the inactive list, as in processAndRemove()
+    auto voice = _active.begin();
+    while (voice != _active.end()) {
+      auto old_voice = voice;
+      voice++;
+      if (!*old_voice)
+        _inactive.splice(_inactive.end(), _active, old_voice);
+    }
+  }
+
   template <typename T>
   void Cloud<T>::setVoiceNumber(int voices)
   {
-    Voice<T> tmplt(_shape, _carrier);
+    Voice<T> tmplt(Waveform<T>(), _carrier);
+    tmplt.setControlRate(_control_frames);
     _active.clear();
     _inactive.resize(voices, tmplt);
+    updateVoices();
+    setSeed(_seed);
   }
 
   template <typename T>
   void Cloud<T>::setShape(Shape shape)
   {
-
+    _shape_type = shape;
     switch(shape) {
     case Shape::Gaussian:
-      GenerateGaussian(_shape, _fs, T(0.15));
+      _shape = GrainWindow(WindowType::GAUSSIAN, _table_size, 0.15);
+      break;
+    case Shape::Hann:
+      _shape = GrainWindow(WindowType::HANN, _table_size);
+      break;
+    case Shape::Tukey:
+      _shape = GrainWindow(WindowType::TUKEY, _table_size, 0.5);
+      break;
+    case Shape::Trapezoid:
+      _shape = GrainWindow(WindowType::TRAPEZOID, _table_size, 0.25);
     }
-    
-    for (auto& voice : _inactive)
-      voice._graingen.setShape(_shape);
+    updateVoices();
   }
 
   template <typename T>
   void Cloud<T>::setCarrier(Carrier carrier)
   {
+    _carrier_type = carrier;
+    _file_carrier = false;
+    _live = nullptr;
+    _compact = CompactWaveform<T>();
+    _sine = SineCarrier();
+    TableType type = TableType::TRIANGLE;
+    T param = 0;
     switch(carrier) {
     case Carrier::Sin:
-      GenerateSin(_carrier, _fs);
-      break;
+      // A sine is computed by the grains, so it needs neither a table nor band-limiting
+      _sine = SineCarrier(_table_size);
+      _carrier = Waveform<T>();
+      _carrier_mip = Wavetable<T>();
+      updateVoices();
+      return;
     case Carrier::Triangle:
-      GenerateTriangle(_carrier, _fs, T(0));
       break;
     case Carrier::Saw:
-      GenerateTriangle(_carrier, _fs, T(0.8));
+      param = T(0.8);
       break;
     case Carrier::Square:
-      GenerateSquare(_carrier, _fs, T(0.5));
+      type = TableType::SQUARE;
+      param = T(0.5);
     }
+    // The tables (and their band-limited levels) are shared by every Cloud that uses them
+    TableCache<T>& cache = TableCache<T>::instance();
+    _carrier = cache.table(type, _table_size, param);
+    // Band-limit the carrier so that high grain frequencies don't alias
+    if (_carrier.powerOfTwo())
+      _carrier_mip = cache.wavetable(type, _table_size, param);
+    updateVoices();
+  }
+
+  template <typename T>
+  void Cloud<T>::setCarrier(std::string afile, size_t begin, size_t end, InterpType it, ChannelLayout layout)
+  {
+    _carrier = SampleLibrary<T>::instance().load(afile, begin, end, _fs, it, layout, true);
+    _compact = CompactWaveform<T>();
+    _sine = SineCarrier();
+    _file_carrier = true;
+    _live = nullptr;
+    updateVoices();
+  }
+
+  template <typename T>
+  void Cloud<T>::setCarrier(std::string afile, SampleFormat format, size_t begin, size_t end)
+  {
+    _compact = CompactWaveform<T>(LoadWaveform<T>(afile, _fs, begin, end), format);
+    _carrier = Waveform<T>();
+    _sine = SineCarrier();
+    _file_carrier = true;
+    _live = nullptr;
+    updateVoices();
+  }
 
-    for (auto& voice : _inactive)
-      voice._graingen.setCarrier(_carrier);
+  template <typename T>
+  void Cloud<T>::setCarrier(const LiveWaveform<T>& live, double delay)
+  {
+    _carrier = live.waveform();
+    _compact = CompactWaveform<T>();
+    _sine = SineCarrier();
+    _file_carrier = true;
+    _live = &live;
+    _live_delay = delay;
+    updateVoices();
   }
 
   template <typename T>
-  void Cloud<T>::setCarrier(std::string afile, size_t begin, size_t end)
+  void Cloud<T>::setTableSize(size_t len)
   {
-    _carrier = Waveform<T>(afile, begin, end);
+    _table_size = len;
+    setShape(_shape_type);
+    if (!_file_carrier)
+      setCarrier(_carrier_type);
+  }
+
+  template <typename T>
+  void Cloud<T>::setControlRate(size_t frames)
+  {
+    _control_frames = frames;
+    for (auto* voices : {&_active, &_inactive}) {
+      for (auto& voice : *voices)
+        voice.setControlRate(frames);
+    }
+  }
+
+  template <typename T>
+  void Cloud<T>::setFixedPoint(bool fixed)
+  {
+    _fixed_point = fixed;
+    updateVoices();
+  }
+
+  template <typename T>
+  void Cloud<T>::setSeed(uint64_t seed)
+  {
+    _seed = seed;
+    uint64_t stream = 0;
+    for (auto* voices : {&_active, &_inactive}) {
+      for (auto& voice : *voices)
+        voice.setSeed(seed, stream++);
+    }
+  }
+
+  template <typename T>
+  void Cloud<T>::setThreads(unsigned threads)
+  {
+    if (threads > 1)
+      _render = std::make_shared<RenderPool>(threads);
+    else
+      _render.reset();
+  }
+
+  template <typename T>
+  void Cloud<T>::setMaxBlockSize(size_t frames)
+  {
+    _max_block = frames > 0 ? frames : 1;
+    sizeBlocks();
   }
 
   /******************** Private Functions ********************/
@@ -149,6 +324,66 @@ namespace audioelectric {
     return voice;
   }
 
+  template <typename T>
+  void Cloud<T>::updateVoices(void)
+  {
+    // The generated tables hold one cycle (or one grain) per second of playback at a rate of 1
+    size_t carrier_size = _sine.size() > 0 ? _sine.size() : _carrier.size();
+    double carrier_scale = _file_carrier ? 1. : (double)carrier_size/_fs;
+    double shape_scale = (double)_shape.size()/_fs;
+    Wavetable<T> mipmap = !_file_carrier && _carrier.powerOfTwo() ? _carrier_mip : Wavetable<T>();
+    // The voices share the waveforms' data rather than copying it
+    for (auto* voices : {&_active, &_inactive}) {
+      for (auto& voice : *voices) {
+        voice._graingen.setShape(_shape);
+        if (_live)
+          voice._graingen.setCarrier(*_live, _live_delay);
+        else if (_sine.size() > 0)
+          voice._graingen.setCarrier(_sine);
+        else if (_compact.size() > 0)
+          voice._graingen.setCarrier(_compact);
+        else
+          voice._graingen.setCarrier(_carrier);
+        voice._graingen.setCarrierMipmap(mipmap);
+        voice._graingen.setRateScales(carrier_scale, shape_scale);
+        voice._graingen.setFixedPoint(_fixed_point);
+      }
+    }
+    sizeBlocks();
+  }
+
+
+  template <typename T>
+  void Cloud<T>::sizeBlocks(void)
+  {
+    size_t voices = _active.size() + _inactive.size();
+    size_t line = CLOUD_BLOCK_ALIGN/sizeof(T);
+    _block_stride = (_max_block + line - 1)/line*line;
+    // A sine or compact carrier leaves _carrier empty, which has one channel
+    _block_channels = _carrier.channels();
+    _rendering.assign(voices, nullptr);
+    // The extra line leaves room to align the first buffer
+    _blocks.assign(voices*_block_channels*_block_stride + line, 0);
+  }
+
+  template <typename T>
+  T* Cloud<T>::block(size_t i)
+  {
+    size_t misalignment = reinterpret_cast<uintptr_t>(_blocks.data()) % CLOUD_BLOCK_ALIGN;
+    size_t skip = misalignment == 0 ? 0 : (CLOUD_BLOCK_ALIGN - misalignment)/sizeof(T);
+    return _blocks.data() + skip + i*_block_channels*_block_stride;
+  }
+
+  template <typename T>
+  void Cloud<T>::mixBlock(T* const* outputs, size_t channels, size_t offset, const T* buffer, size_t frames)
+  {
+    for (size_t c=0; c<channels; c++) {
+      T* out = outputs[c] + offset;
+      const T* in = buffer + (c % _block_channels)*_block_stride;
+      for (size_t n=0; n<frames; n++)
+        out[n] += in[n];
+    }
+  }
 
   template class Cloud<double>;
   template class Cloud<float>;
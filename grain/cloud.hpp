@@ -10,6 +10,10 @@
  */
 #pragma once
 
+#include <memory>
+#include <vector>
+
+#include "renderpool.hpp"
 #include "voice.hpp"
 
 namespace audioelectric {
@@ -17,20 +21,28 @@ namespace audioelectric {
   /*!\brief Describes the set of carriers
    */
   enum class Carrier {
-    Sin,                //!< Sine wave
+    Sin,                //!< Sine wave (computed as the grains play, see SineCarrier)
     Triangle,           //!< Triangle wave
     Saw,                //!< Saw wave
     Square,             //!< Square wave
   };
 
   /*!\brief Describes the set of shapes
+   *
+   * The shapes are computed as the grains play (see GrainWindow) rather than read from tables.
    */
   enum class Shape {
     Gaussian,           //!< Gaussian
+    Hann,               //!< Raised cosine
+    Tukey,              //!< Raised cosine tapers over the first and last quarters, with a flat top between
+    Trapezoid,          //!< Linear ramps over the first and last quarters, with a flat top between
   };
 
 #define DEFAULT_SHAPE Shape::Gaussian
 #define DEFAULT_CARRIER Carrier::Sin
+#define DEFAULT_TABLE_SIZE 4096
+#define CLOUD_BLOCK_ALIGN 64    //!< The alignment (in bytes) of the voices' block buffers, which is one cache line
+#define CLOUD_MAX_BLOCK 1024    //!< The default number of frames that the voices' block buffers hold
 
   template <typename T>
   class Cloud final {
@@ -87,6 +99,33 @@ namespace audioelectric {
     T value(void) const;
 
     void increment(void);
+
+    /*!\brief Writes the next frames values of the cloud to out
+     *
+     * This is the block equivalent of calling value() and increment() for each frame, and is the preferred way to render
+     * a cloud since each voice is only visited once per block. Each voice renders into a buffer of its own, and the
+     * buffers are summed in order afterward, so the output is the same whether the voices are rendered on one thread or
+     * several (see setThreads()). Blocks of more frames than the buffers hold (see setMaxBlockSize()) are rendered in
+     * pieces, so process() never allocates.
+     *
+     * Like value(), this plays channel 0 of a multi-channel carrier.
+     *
+     * \param out    The buffer to write to (must hold at least frames values)
+     * \param frames The number of frames to generate
+     */
+    void process(T* out, size_t frames) {process(&out, 1, frames);}
+
+    /*!\brief Writes the next frames values of the cloud to a set of output channels
+     *
+     * Output channel c gets channel c % n of an n-channel carrier, so a stereo carrier plays in stereo, and a mono carrier
+     * plays the same in every output. Each voice renders the carrier channels that the outputs need, straight from the
+     * carrier's data, into buffers of its own, so the voices are summed just as they are by the single-channel process().
+     *
+     * \param outputs  One buffer per output channel (each must hold at least frames values)
+     * \param channels The number of output channels
+     * \param frames   The number of frames to generate
+     */
+    void process(T* const* outputs, size_t channels, size_t frames);
     
     /*!\brief Sets the number of voices.
      * 
@@ -99,7 +138,91 @@ namespace audioelectric {
 
     void setCarrier(Carrier carrier);
 
-    void setCarrier(std::string afile, size_t begin=0, size_t end=0);
+    /*!\brief Sets the carrier to a section of an audio file
+     *
+     * The file is converted to the Cloud's sample rate when it's loaded (see LoadWaveform()), so grains play it at its
+     * original pitch at a rate of 1. The section comes from the process-wide SampleLibrary, so Clouds that play the same
+     * section share one copy of it, and the voices' grains read that copy whatever its channels.
+     *
+     * \param afile  The audio file to use as the carrier
+     * \param begin  The beginning frame to capture from the audio file
+     * \param end    The ending frame to capture from the audio file. A value of 0 means to capture to the end
+     * \param it     How to interpolate the carrier. CUBIC or SINC keep grains that are pitched far from the file's rate
+     *               clean without resampling the file beforehand
+     * \param layout How to keep the channels of a multi-channel file. PLANAR keeps each channel contiguous, so that the
+     *               grains read every channel with the same kernels as a mono carrier. INTERLEAVED lets a float WAV be
+     *               mapped rather than read, but the grains read its channels one lookup at a time. MIXDOWN mixes the
+     *               channels down to a mono carrier
+     */
+    void setCarrier(std::string afile, size_t begin=0, size_t end=0, InterpType it=InterpType::LINEAR,
+                    ChannelLayout layout=ChannelLayout::PLANAR);
+
+    /*!\brief Sets the carrier to a section of an audio file, stored in 16-bit samples (see CompactWaveform)
+     *
+     * The file is converted to the Cloud's sample rate just as it is by the other setCarrier() for files, and then to the
+     * compact format. The compact carrier isn't shared through the SampleLibrary, since the library would keep the full
+     * precision section around as well.
+     *
+     * \param afile  The audio file to use as the carrier
+     * \param format The format to store the samples in
+     * \param begin  The beginning frame to capture from the audio file
+     * \param end    The ending frame to capture from the audio file. A value of 0 means to capture to the end
+     */
+    void setCarrier(std::string afile, SampleFormat format, size_t begin=0, size_t end=0);
+
+    /*!\brief Sets the carrier to a live recording, which the grains read a number of frames behind its write head
+     *
+     * The recording should be at the Cloud's sample rate, and the block of input that goes with each block of output
+     * should be written to it before process() is called. Every grain starts delay frames behind the input, as of the
+     * frame on which the grain starts (see GrainGenerator::setCarrier()). The LiveWaveform must outlive its use as the
+     * carrier.
+     *
+     * \param live  The recording
+     * \param delay The number of frames behind the write head at which grains start
+     */
+    void setCarrier(const LiveWaveform<T>& live, double delay);
+
+    /*!\brief Sets the length of the generated carrier tables (and the shape windows), and regenerates them
+     *
+     * The table length is independent of the sample rate. Power-of-two lengths are recommended, since carriers that
+     * cycle over a power-of-two table wrap with a bitmask (see Phasor). A carrier read from an audio file is unaffected.
+     */
+    void setTableSize(size_t len);
+
+    /*!\brief Sets the number of frames between the control points of every voice (see Voice::setControlRate())
+     */
+    void setControlRate(size_t frames);
+
+    /*!\brief Sets whether the grains of every voice keep their phases in fixed point (see GrainPool::setFixedPoint())
+     *
+     * Fixed point keeps long grains from drifting. It's off by default.
+     */
+    void setFixedPoint(bool fixed);
+
+    /*!\brief Seeds the grain randomization of every voice
+     *
+     * Each voice draws from its own stream of the seed (its index among the voices), so a Cloud that's given the same
+     * seed and the same notes renders the same output every time. The seed is 0 until it's set, and it's reapplied
+     * whenever the number of voices changes.
+     */
+    void setSeed(uint64_t seed);
+
+    /*!\brief Sets the number of threads that process() renders the voices on
+     *
+     * The active voices are shared out between the threads a block at a time (see RenderPool), with the thread that
+     * calls process() taking its share. The default of 1 renders every voice on the calling thread. Copies of a Cloud
+     * share its threads, and take turns with them.
+     *
+     * \param threads The number of threads, counting the one that calls process()
+     */
+    void setThreads(unsigned threads);
+
+    /*!\brief Sets the number of frames that the voices' block buffers hold, and resizes them
+     *
+     * This should be at least the number of frames that's usually passed to process(), which renders larger blocks in
+     * pieces. It's CLOUD_MAX_BLOCK by default.
+     */
+    void setMaxBlockSize(size_t frames);
 
     GrainParams<T>& params(void) {return _params;}
     GrainParams<T>& velocityModulators(void) {return _vel_mod;}
@@ -112,14 +235,32 @@ namespace audioelectric {
   private:
 
     size_t _fs;      //!< The sample rate
+    size_t _control_frames;     //!< The number of frames between the voices' control points
+    uint64_t _seed;             //!< The seed of the voices' grain randomization
+    bool _fixed_point;          //!< Whether the voices' grains keep their phases in fixed point
+    std::shared_ptr<RenderPool> _render;        //!< The threads that render the voices, if there's more than one
     
     // Waveforms
-    Waveform<T> _shape;
+    size_t _table_size;         //!< The length of the generated tables and the shape windows
+    Shape _shape_type;          //!< The current shape
+    Carrier _carrier_type;      //!< The current carrier (if it isn't from a file)
+    bool _file_carrier;         //!< Whether the carrier was read from an audio file (or is a live recording)
+    const LiveWaveform<T>* _live;       //!< The live recording that's the carrier, if any
+    double _live_delay;         //!< The number of frames behind the live recording's write head at which grains start
+    GrainWindow _shape;
     Waveform<T> _carrier;
+    SineCarrier _sine;          //!< The carrier, if it's a generated sine
+    CompactWaveform<T> _compact;        //!< The carrier, if it was read from an audio file in a compact format
+    Wavetable<T> _carrier_mip;  //!< The band-limited levels of a generated, power-of-two carrier
     
     // Voices
     std::list<Voice<T>> _active;        //!< The active voices 
     std::list<Voice<T>> _inactive;      //!< The inactive voices
+    std::vector<Voice<T>*> _rendering;  //!< The active voices, in order, while process() renders them
+    std::vector<T> _blocks;             //!< The block buffers of the voices that are rendering
+    size_t _block_stride;               //!< The distance between the starts of the block buffers
+    size_t _block_channels;             //!< The number of block buffers that each voice has (one per carrier channel)
+    size_t _max_block;                  //!< The number of frames that the block buffers hold
 
     // User Parameters
     GrainParams<T> _params;     //!< Base parameters. freq->tuning, ampl->overall volume, density & length -> base grains
@@ -133,6 +274,30 @@ namespace audioelectric {
     GrainParams<T> _env2_mult;          //!< Multipliers for envelope 2
 
     typename std::list<Voice<T>>::iterator checkForActiveFreq(T freq);
+
+    /*!\brief Passes the shape, the carrier, the carrier Wavetable and the rate scales to every voice
+     *
+     * The rate scales make freq in Hz and length in seconds, whatever the table and window sizes.
+     */
+    void updateVoices(void);
+
+    /*!\brief Sizes the block buffers and the rendering list for every voice, active or not
+     *
+     * This is done whenever the number of voices, the carrier or the block size changes, rather than in process().
+     */
+    void sizeBlocks(void);
+
+    /*!\brief Adds up to _max_block frames of the active voices to the outputs, from frame offset on (see process())
+     */
+    void processBlock(T* const* outputs, size_t channels, size_t offset, size_t frames);
+
+    /*!\brief Adds a voice's block buffers to the outputs, from frame offset on
+     */
+    void mixBlock(T* const* outputs, size_t channels, size_t offset, const T* buffer, size_t frames);
+
+    /*!\brief Returns the first of the ith voice's block buffers, which are each aligned to CLOUD_BLOCK_ALIGN
+     */
+    T* block(size_t i);
     
   };
   
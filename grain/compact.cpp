@@ -0,0 +1,60 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include <utility>
+
+#include "compact.hpp"
+
+namespace audioelectric {
+
+  template <typename T>
+  CompactWaveform<T>::CompactWaveform(void) :
+    _format(SampleFormat::INT16), _size(0), _end(0), _guard(Guard::ZEROS), _samplerate(0), _data(nullptr)
+  {
+
+  }
+
+  template <typename T>
+  CompactWaveform<T>::CompactWaveform(const Waveform<T>& wf, SampleFormat format) :
+    _format(format), _size(wf.size()), _end(wf.size()-1), _guard(wf.guard()), _samplerate(wf.samplerate()),
+    _data(nullptr)
+  {
+    if (wf.channels() != 1)
+      throw WaveformError("Only a single-channel Waveform can be stored compactly");
+    if (_size == 0)
+      return;
+    // Wrap the guards of a power-of-two Waveform without copying it
+    Waveform<T> src = wf;
+    if (src.powerOfTwo() && src.guard() != Guard::WRAPPED)
+      src.setGuard(Guard::WRAPPED);
+    _guard = src.guard();
+    const T* d = std::as_const(src).data() - WAVEFORM_GUARD;
+    auto samples = std::make_shared<std::vector<uint16_t>>(_size + 2*WAVEFORM_GUARD);
+    for (size_t i=0; i<samples->size(); i++)
+      (*samples)[i] = format == SampleFormat::HALF ? kernel::packHalf(d[i]) : kernel::packInt16(d[i]);
+    _storage = samples;
+    _data = samples->data() + WAVEFORM_GUARD;
+  }
+
+  template <typename T>
+  Waveform<T> CompactWaveform<T>::expand(void) const
+  {
+    Waveform<T> wf(_size, _samplerate);
+    if (_size == 0)
+      return wf;
+    T* d = wf.data();
+    for (size_t i=0; i<_size; i++)
+      d[i] = (*this)[i];
+    wf.setGuard(_guard);
+    return wf;
+  }
+
+  template class CompactWaveform<double>;
+  template class CompactWaveform<float>;
+
+}  // audioelectric
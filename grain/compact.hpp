@@ -0,0 +1,228 @@
+/* \file compact.hpp
+ * \brief Defines the CompactWaveform class and the conversions between its 16-bit samples and floats
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ *
+ * Every 16-bit sample converts to a float exactly, so a CompactWaveform reads back exactly the same values as a float
+ * Waveform of its decoded samples (see CompactWaveform::expand()), and the grain kernels that read it (see
+ * grainkernel.hpp) return bit-identical results with or without SIMD.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "waveform.hpp"
+
+namespace audioelectric {
+
+  /*!\brief The formats that a CompactWaveform can store its samples in
+   */
+  enum class SampleFormat {
+    INT16,      //!< 16-bit signed integers, scaled so that 32768 is 1. Values outside of [-1,1) are clipped
+    HALF,       //!< IEEE 754 half-precision floats (11 bits of precision, with a range of +/-65504)
+  };
+
+  namespace kernel {
+
+    /*!\brief Converts a sample to a 16-bit integer, rounding to the nearest one and clipping
+     */
+    inline uint16_t packInt16(float x)
+    {
+      float s = x*32768.f;
+      s = s < -32768.f ? -32768.f : (s > 32767.f ? 32767.f : s);
+      return (uint16_t)(int16_t)lrintf(s);
+    }
+
+    /*!\brief Converts a sample to a half-precision float, rounding to the nearest even one
+     */
+    inline uint16_t packHalf(float x)
+    {
+      uint32_t u;
+      memcpy(&u, &x, 4);
+      uint32_t sign = (u >> 16) & 0x8000;
+      u &= 0x7fffffff;
+      uint32_t h;
+      if (u >= 0x47800000) {
+        // Too large for a half (65536 and up), infinity or NaN
+        h = u > 0x7f800000 ? 0x7e00 : 0x7c00;
+      }
+      else if (u < 0x38800000) {
+        // Smaller than the smallest normal half: adding 0.5 lines the half's subnormal bits up with the float's mantissa
+        float f;
+        memcpy(&f, &u, 4);
+        f += 0.5f;
+        memcpy(&h, &f, 4);
+        h -= 0x3f000000;
+      }
+      else {
+        // Rebias the exponent and round the mantissa to 10 bits, to the nearest even on a tie
+        u += ((uint32_t)(15 - 127) << 23) + 0xfff + ((u >> 13) & 1);
+        h = u >> 13;
+      }
+      return h | sign;
+    }
+
+    /*!\brief Converts a 16-bit integer sample to a float
+     */
+    inline float unpackInt16(uint16_t s)
+    {
+      return (int16_t)s * (1.f/32768);
+    }
+
+    /*!\brief Converts a half-precision float to a float
+     *
+     * The half's exponent and mantissa are shifted into place and the exponent is rebiased with a multiplication, which
+     * also normalizes subnormal halves. The SIMD conversion in grainkernel.hpp does the same thing.
+     */
+    inline float unpackHalf(uint16_t s)
+    {
+      uint32_t em = (uint32_t)(s & 0x7fff) << 13;
+      float f;
+      memcpy(&f, &em, 4);
+      f *= 0x1p112f;
+      uint32_t u;
+      memcpy(&u, &f, 4);
+      if (em >= 0x0f800000)
+        u |= 0x7f800000;        // Infinity or NaN
+      u |= (uint32_t)(s & 0x8000) << 16;
+      memcpy(&f, &u, 4);
+      return f;
+    }
+
+    /*!\brief Converts a sample of a format to a float
+     */
+    template <SampleFormat F>
+    inline float unpack(uint16_t s)
+    {
+      if constexpr (F == SampleFormat::HALF)
+        return unpackHalf(s);
+      else
+        return unpackInt16(s);
+    }
+
+    /*!\brief Scalar linear interpolation of 16-bit samples, matching CompactWaveform::interp()
+     *
+     * The samples are converted to floats before they're interpolated, so this matches lookup() on the decoded samples.
+     */
+    template <SampleFormat F, typename T>
+    inline T lookup(const uint16_t* data, long mask, double pos)
+    {
+      long p = pos;
+      const uint16_t* d = data + (p & mask);
+      T a = unpack<F>(d[0]);
+      T b = unpack<F>(d[1]);
+      double diff = pos - (double)p;
+      return (b-a)*diff + a;
+    }
+
+  }  // kernel
+
+  /*!\brief A read-only, single-channel Waveform that stores its samples in 16 bits
+   *
+   * A CompactWaveform takes half the memory of a Waveform<float> (and a quarter of a Waveform<double>), and the samples
+   * are only converted to T as they're read, so grains that read a large carrier (see GrainPool) move half as many bytes
+   * through the caches. INT16 keeps the precision of 16-bit source files, and HALF keeps about 11 bits of precision at
+   * any level.
+   *
+   * Like a Waveform, the samples are padded with WAVEFORM_GUARD guard frames on each side, and copies share the data.
+   * There is no way to write to the samples, so the data is never copied. Only linear interpolation is supported.
+   */
+  template <typename T>
+  class CompactWaveform final {
+  public:
+
+    /*!\brief Creates a CompactWaveform of size 0
+     */
+    CompactWaveform(void);
+
+    /*!\brief Converts a single-channel Waveform
+     *
+     * The guard frames are converted along with the data, and they're wrapped if the Waveform is a power of two, since
+     * grains cycle over those (see GrainPool).
+     *
+     * \throw WaveformError if the Waveform has more than one channel
+     *
+     * \param wf     The Waveform to convert
+     * \param format The format to store the samples in
+     */
+    CompactWaveform(const Waveform<T>& wf, SampleFormat format=SampleFormat::INT16);
+
+    /*!\brief Returns the format of the samples
+     */
+    SampleFormat format(void) const {return _format;}
+
+    /*!\brief Returns the number of samples
+     */
+    size_t size(void) const {return _size;}
+
+    /*!\brief Returns the end position of the Waveform
+     */
+    double end(void) const {return _end;}
+
+    /*!\brief Returns true if the number of samples is a power of two
+     */
+    bool powerOfTwo(void) const {return _size > 0 && (_size & (_size-1)) == 0;}
+
+    /*!\brief Returns what the guard frames hold
+     */
+    Guard guard(void) const {return _guard;}
+
+    T samplerate(void) const {return _samplerate;}
+
+    /*!\brief Returns the number of bytes that the samples and their guard frames take
+     */
+    size_t bytes(void) const {return _size > 0 ? (_size + 2*WAVEFORM_GUARD)*sizeof(uint16_t) : 0;}
+
+    /*!\brief Returns a sample, converted to T
+     */
+    T operator[](size_t pos) const {
+      return _format == SampleFormat::HALF ? kernel::unpackHalf(_data[pos]) : kernel::unpackInt16(_data[pos]);
+    }
+
+    /*!\brief Returns the interpolated value at a position, or 0 outside of the Waveform (see Waveform::waveform())
+     */
+    T waveform(double pos) const {
+      if (pos < 0 || pos > _end)
+        return 0;
+      return interp(pos);
+    }
+
+    /*!\brief Returns the interpolated value at a position without checking its bounds (see Waveform::interp())
+     */
+    T interp(double pos) const {
+      if (_format == SampleFormat::HALF)
+        return kernel::lookup<SampleFormat::HALF, T>(_data, -1, pos);
+      return kernel::lookup<SampleFormat::INT16, T>(_data, -1, pos);
+    }
+
+    /*!\brief Returns a pointer to the raw samples
+     */
+    const uint16_t* data(void) const {return _data;}
+
+    /*!\brief Returns a Waveform of the decoded samples, with the same guard frames
+     */
+    Waveform<T> expand(void) const;
+
+  private:
+
+    SampleFormat _format;       //!< The format of the samples
+    size_t _size;               //!< The number of samples
+    size_t _end;                //!< The last index of _data
+    Guard _guard;               //!< What the guard frames hold
+    T _samplerate;              //!< The native samplerate of the waveform
+    std::shared_ptr<const std::vector<uint16_t>> _storage;    //!< The samples and their guard frames
+    const uint16_t* _data;      //!< The first sample
+
+  };
+
+}  // audioelectric
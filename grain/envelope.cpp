@@ -70,6 +70,27 @@ namespace audioelectric {
     _updatePhase();
   }
 
+  template <typename T>
+  void Envelope<T>::increment(size_t frames)
+  {
+    while (frames > 0 && *this && _phase != EnvPhase::sus) {
+      size_t n = frames < _phs_rem ? frames : _phs_rem;
+      _out += _slope*n;
+      _phs_rem -= n;
+      frames -= n;
+      _updatePhase();
+    }
+  }
+
+  template <typename T>
+  void Envelope<T>::process(T* out, size_t frames)
+  {
+    for (size_t i=0; i<frames; i++) {
+      out[i] = _out;
+      increment();
+    }
+  }
+
   template <typename T>
   void Envelope<T>::gate(bool g)
   {
@@ -41,6 +41,17 @@ namespace audioelectric {
 
     void increment(void);
 
+    /*!\brief Increments the envelope by a number of frames
+     *
+     * Each phase of the envelope is linear, so this advances through the phases in one step per phase rather than one
+     * step per frame.
+     */
+    void increment(size_t frames);
+
+    /*!\brief Writes the next frames values of the envelope to out, incrementing after each one
+     */
+    void process(T* out, size_t frames);
+
     operator bool(void) const {return _phase != EnvPhase::inactive;}
 
     /*!\brief Controls the gate value
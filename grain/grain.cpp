@@ -10,8 +10,17 @@
 
 namespace audioelectric {
 
+#define GRAIN_CHUNK_SIZE 64
+
   template<typename T>
-  Grain<T>::Grain(Waveform<T>& carrier, double crate, Waveform<T>& shape, double srate, T ampl) :
+  Grain<T>::Grain(const Waveform<T>& carrier, double crate, const Waveform<T>& shape, double srate, T ampl) :
+    _carrier(carrier, crate, true), _shape(shape, srate), _ampl(ampl)
+  {
+    
+  }
+
+  template<typename T>
+  Grain<T>::Grain(const Wavetable<T>& carrier, double crate, const Waveform<T>& shape, double srate, T ampl) :
     _carrier(carrier, crate, true), _shape(shape, srate), _ampl(ampl)
   {
     
@@ -44,6 +53,22 @@ namespace audioelectric {
     _shape.increment();
   }
 
+  template <typename T>
+  void Grain<T>::process(T* out, size_t frames)
+  {
+    T cbuf[GRAIN_CHUNK_SIZE];
+    T sbuf[GRAIN_CHUNK_SIZE];
+    while (frames > 0 && _shape) {
+      size_t n = frames < GRAIN_CHUNK_SIZE ? frames : GRAIN_CHUNK_SIZE;
+      _carrier.process(cbuf, n);
+      _shape.process(sbuf, n);
+      for (size_t i=0; i<n; i++)
+        out[i] += cbuf[i] * sbuf[i] * _ampl;
+      out += n;
+      frames -= n;
+    }
+  }
+
   template <typename T>
   Grain<T>::operator bool(void) const
   {
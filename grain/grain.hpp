@@ -23,7 +23,11 @@ namespace audioelectric {
      * \param srate   The shape rate
      * \param ampl    The amplitude of the grain
      */
-    Grain(Waveform<T>& carrier, double crate, Waveform<T>& shape, double srate, T ampl);
+    Grain(const Waveform<T>& carrier, double crate, const Waveform<T>& shape, double srate, T ampl);
+
+    /*!\brief Constructs a grain whose carrier reads from a band-limited Wavetable (see Phasor)
+     */
+    Grain(const Wavetable<T>& carrier, double crate, const Waveform<T>& shape, double srate, T ampl);
 
     Grain(Phasor<T>& carrier, Phasor<T>& shape, T ampl);
 
@@ -37,13 +41,23 @@ namespace audioelectric {
      */
     void increment(void);
 
+    /*!\brief Adds the next frames values of the grain to out
+     *
+     * This is the block equivalent of calling value() and increment() for each frame. Once the grain has finished, the
+     * remaining frames are left untouched.
+     *
+     * \param out    The buffer to add the grain to
+     * \param frames The number of frames to generate
+     */
+    void process(T* out, size_t frames);
+
     /*!\brief Returns true if the grain is still running
      */
     operator bool(void) const;
 
-    void setCarrier(Waveform<T>& carrier) {_carrier.setWaveform(carrier);}
+    void setCarrier(const Waveform<T>& carrier) {_carrier.setWaveform(carrier);}
 
-    void setShape(Waveform<T>& shape) {_shape.setWaveform(shape);}
+    void setShape(const Waveform<T>& shape) {_shape.setWaveform(shape);}
     
     /*!\brief Sets the carrier rate
      */
@@ -58,6 +72,10 @@ namespace audioelectric {
     void setAmplitude(T ampl) {_ampl = ampl;}
 
     void setParams(double crate, double srate, T ampl, double front=0, double back=-1);
+
+    /*!\brief Sets whether the carrier and shape keep their phases in fixed point (see Phasor::setFixedPoint())
+     */
+    void setFixedPoint(bool fixed) {_carrier.setFixedPoint(fixed); _shape.setFixedPoint(fixed);}
     
     /*!\brief Resets the carrier and the shape back to their beginning phases
      */
@@ -6,13 +6,12 @@
  * Last Modified Date: June 28, 2019
  */
 
+#include <cmath>
+
 #include "graingenerator.hpp"
-#include "algorithm.hpp"
 
 namespace audioelectric {
 
-#define GRAIN_ALLOC_NUM 5
-
   template <typename T>
   void GrainParams<T>::modulate(GrainParams<T>& other)
   {
@@ -61,51 +60,92 @@ namespace audioelectric {
   }
 
   template <typename T>
-  GrainGenerator<T>::GrainGenerator(Waveform<T>& shape, Waveform<T>& carrier) :
-    _last_grain_t(0), _rand_grain_t(0), _params(), _rand({0,0,0,0,0,0}), _dist(-1,1),
-    _shape(shape), _carrier(carrier)
+  GrainGenerator<T>::GrainGenerator(const Waveform<T>& shape, const Waveform<T>& carrier, size_t max_grains) :
+    _grains(carrier, shape, max_grains), _events(max_grains), _nevents(0), _live(nullptr), _live_delay(0),
+    _last_grain_t(0), _rand_grain_t(0), _params(), _ramp(0, 0, 0, 0, 0, 0), _ramp_len(0), _ramp_pos(0),
+    _rand({0,0,0,0,0,0}), _crate_scale(1), _srate_scale(1)
   {
-    std::random_device rd;
-    _gen = std::ranlux48_base(rd());
-    _allocateGrains();
+    _scheduleGrain();
   }
 
   template <typename T>
   GrainGenerator<T>::operator bool(void) const
   {
-    return !_active.empty();
+    return _grains;
   }
 
   template <typename T>
   T GrainGenerator<T>::value(void) const
   {
-    T val = 0;
-    for (auto& grn : _active)
-      val += grn.value();
-    return val;
+    return _grains.value();
   }
 
   template <typename T>
   void GrainGenerator<T>::increment(void)
   {
-    // Increment grains and move completed grains to the _inactive list
-    incrementAndRemove(_active, _inactive);
+    // Increment grains and remove the completed ones
+    _grains.increment();
 
     // Generate a grain if it is time
-    double grain_period = 1./_params.density;
-    if (_last_grain_t >= grain_period*(1. + _rand_grain_t*_rand.density)) {
-      _rand_grain_t = _random();
-      _last_grain_t = 0;
-      if (_inactive.empty())
-        _allocateGrains();
-      _moveAndSetGrain(_params.freq*(1. + _random(_rand.freq)),         // crate
-                       (1. + _random(_rand.length))/_params.length,     // srate
-                       _params.ampl*(1. + _random(_rand.ampl)),         // ampl
-                       _params.front*(1. + _random(_rand.front)),       // front
-                       _params.back*(1. + _random(_rand.back)));        // back
-    }
+    if (_last_grain_t >= _next_grain_t)
+      _grains.add(_emitGrain(_params));
 
     _last_grain_t++;
+    _advanceRamp(1);
+  }
+
+  template <typename T>
+  void GrainGenerator<T>::process(T* out, size_t frames, size_t channels, size_t stride)
+  {
+    // Schedule the grains that start during this block. t counts the increments that have been made in the block, and a
+    // grain generated on increment t is first heard on frame t+1.
+    _nevents = 0;
+
+    // An idle generator whose next grain is past the end of the block only has to count the block's frames
+    if (!_grains && (_ramp.density == 0 || _ramp_pos == _ramp_len) && _last_grain_t + frames < _next_grain_t) {
+      _last_grain_t += frames;
+      _advanceRamp(frames);
+      return;
+    }
+
+    size_t t = 0;
+    while (true) {
+      // While the density is ramping the grain period changes on every frame, so the next grain is looked for one frame
+      // at a time, and past the end of the ramp it's found directly
+      size_t ramp_left = _ramp.density != 0 ? _ramp_len - _ramp_pos : 0;
+      size_t k = 0;
+      while (t + k < ramp_left && t + k < frames && _last_grain_t + k < _nextGrainTime(t + k))
+        k++;
+      double wait = k;
+      if (t + k >= ramp_left && t + k < frames) {
+        double next_grain_t = (ramp_left > 0 ? _nextGrainTime(t + k) : _next_grain_t) - wait;
+        wait += next_grain_t > _last_grain_t ? std::ceil(next_grain_t - _last_grain_t) : 0;
+      }
+      if (wait >= frames - t) {
+        _last_grain_t += frames - t;
+        break;
+      }
+      t += wait;
+      _last_grain_t += wait;
+      // The events are sized when the generator is made, so that the audio thread never allocates. More grains than the
+      // pool can hold are dropped, just as they would be by a full pool.
+      GrainEvent<T> grain = _emitGrain(_rampedParams(t), t + 1, frames - (t + 1));
+      if (_nevents < _events.size())
+        _events[_nevents++] = grain;
+      _last_grain_t++;
+      t++;
+    }
+
+    _grains.process(out, frames, channels, stride, _events.data(), _nevents);
+    _advanceRamp(frames);
+  }
+
+  template <typename T>
+  void GrainGenerator<T>::setCarrier(const LiveWaveform<T>& live, double delay)
+  {
+    _grains.setCarrier(live.waveform());
+    _live = &live;
+    _live_delay = delay;
   }
 
   template <typename T>
@@ -115,20 +155,63 @@ namespace audioelectric {
     if (_params.density <= MIN_DENSITY)
       _params.density = MIN_DENSITY;
     //_params.length = 1/_params.length; //Assumes that the grain length = 1 second
+    _ramp_len = _ramp_pos = 0;
+    _scheduleGrain();
+  }
+
+  template <typename T>
+  void GrainGenerator<T>::rampInputs(GrainParams<T> params, size_t frames)
+  {
+    if (frames == 0) {
+      applyInputs(params);
+      return;
+    }
+    if (params.density <= MIN_DENSITY)
+      params.density = MIN_DENSITY;
+    _from = _params;
+    _target = params;
+    _ramp = params + _params*T(-1);
+    _ramp *= T(1)/frames;
+    _ramp_len = frames;
+    _ramp_pos = 0;
+  }
+
+  template <typename T>
+  GrainParams<T> GrainGenerator<T>::_rampedParams(size_t frames) const
+  {
+    if (_ramp_pos == _ramp_len)
+      return _params;
+    size_t pos = _ramp_pos + frames;
+    // The end of the ramp is exact, rather than accumulated
+    return pos < _ramp_len ? _from + _ramp*T(pos) : _target;
   }
 
   template <typename T>
-  void GrainGenerator<T>::_allocateGrains(void)
+  void GrainGenerator<T>::_advanceRamp(size_t frames)
   {
-    _inactive.resize(GRAIN_ALLOC_NUM, Grain<T>(_carrier, 0, _shape, 0, 1));
+    if (_ramp_pos == _ramp_len)
+      return;
+    _params = _rampedParams(frames);
+    _ramp_pos = frames < _ramp_len - _ramp_pos ? _ramp_pos + frames : _ramp_len;
+    if (_ramp.density != 0)
+      _scheduleGrain();
   }
 
   template <typename T>
-  void GrainGenerator<T>::_moveAndSetGrain(double crate, double srate, T ampl, double front, double back)
+  GrainEvent<T> GrainGenerator<T>::_emitGrain(const GrainParams<T>& params, size_t offset, size_t lag)
   {
-    _inactive.front().setParams(crate, srate, ampl, front, back);
-    _inactive.front().reset();
-    _active.splice(_active.end(), _inactive, _inactive.begin());
+    _rand_grain_t = _random();
+    _last_grain_t = 0;
+    _next_grain_t = _grainTime(params.density);
+    GrainEvent<T> grain;
+    grain.offset = offset;
+    grain.crate = params.freq*(1. + _random(_rand.freq))*_crate_scale;
+    grain.srate = (1. + _random(_rand.length))/params.length*_srate_scale;
+    grain.ampl = params.ampl*(1. + _random(_rand.ampl));
+    grain.front = params.front*(1. + _random(_rand.front));
+    grain.back = params.back*(1. + _random(_rand.back));
+    grain.phase = _live ? _live->phase(_live_delay + lag) : -1;
+    return grain;
   }
 
 
@@ -137,7 +220,7 @@ namespace audioelectric {
   {
     if (mult == 0)
       return 0;
-    return mult*_dist(_gen);
+    return mult*_rng();
   }
 
   template class GrainParams<double>;
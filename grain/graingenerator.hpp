@@ -9,9 +9,9 @@
  * Last Modified Date: June 28, 2019
  */
 
-#include <list>
-#include <random>
-#include "grain.hpp"
+#include "grainpool.hpp"
+#include "grainrandom.hpp"
+#include "livewaveform.hpp"
 
 #define MIN_DENSITY 1e-9
 
@@ -35,12 +35,23 @@ namespace audioelectric {
   };
 
   /*!\brief Generates grains according to various parameters
+   *
+   * The time of the next grain is worked out when a grain is generated, and again only when the density (or its
+   * randomization) changes, so between grains the generator does no scheduling beyond counting frames. process() skips
+   * straight from one grain to the next, and a block in which there are no grains to render and none to start is only
+   * counted.
    */
   template <typename T>
   class GrainGenerator final {
   public:
 
-    GrainGenerator(Waveform<T>& shape, Waveform<T>& carrier);
+    /*!
+     * \param shape      The shape waveform
+     * \param carrier    The carrier waveform
+     * \param max_grains The maximum number of grains that may be active at once. Grains that would exceed this are
+     *                   dropped.
+     */
+    GrainGenerator(const Waveform<T>& shape, const Waveform<T>& carrier, size_t max_grains=DEFAULT_GRAIN_CAPACITY);
 
     GrainGenerator(void) = delete;
 
@@ -54,27 +65,99 @@ namespace audioelectric {
      */
     void increment(void);
 
+    /*!\brief Adds the next frames values of the generator to out
+     *
+     * This is the block equivalent of calling value() and increment() for each frame. The onsets of all of the grains that
+     * start during the block are scheduled first, and then each grain is rendered over its whole span of the block. The
+     * inputs are held constant for the whole block.
+     *
+     * \param out    The buffer to add the grains to
+     * \param frames The number of frames to generate
+     */
+    void process(T* out, size_t frames) {process(out, frames, 1, 0);}
+
+    /*!\brief Adds the next frames values of the generator to a set of planar output channels
+     *
+     * Output channel c starts at out + c*stride, and gets channel c % channels of the carrier (see GrainPool::process()).
+     *
+     * \param out      The first output channel
+     * \param frames   The number of frames to generate
+     * \param channels The number of output channels
+     * \param stride   The distance between the output channels
+     */
+    void process(T* out, size_t frames, size_t channels, size_t stride);
+
     /*!\brief Updates the values of the inputs
      *
      * \param params The input parameters
      */
     void applyInputs(GrainParams<T> params);
 
+    /*!\brief Ramps the values of the inputs linearly to new values
+     *
+     * The inputs reach params after frames increments (or frames of process()), and every grain that starts along the way
+     * gets the inputs from its point on the ramp. Calling applyInputs() or rampInputs() again replaces the ramp.
+     *
+     * \param params The input parameters at the end of the ramp
+     * \param frames The length of the ramp. A length of 0 applies the inputs at once, just like applyInputs()
+     */
+    void rampInputs(GrainParams<T> params, size_t frames);
+
     /*!\brief Sets the carrier waveform to use
      */
-    void setCarrier(Waveform<T>& carrier) {_carrier = carrier;}
+    void setCarrier(const Waveform<T>& carrier) {_grains.setCarrier(carrier); _live = nullptr;}
+
+    /*!\brief Sets a carrier of 16-bit samples to use (see GrainPool::setCarrier())
+     */
+    void setCarrier(const CompactWaveform<T>& carrier) {_grains.setCarrier(carrier); _live = nullptr;}
+
+    /*!\brief Sets a computed sine carrier to use (see GrainPool::setCarrier())
+     */
+    void setCarrier(const SineCarrier& carrier) {_grains.setCarrier(carrier); _live = nullptr;}
+
+    /*!\brief Sets a live recording as the carrier, and starts each grain a number of frames behind its write head
+     *
+     * A grain that starts on frame n of a block of process() starts at the frame that was recorded delay frames before
+     * frame n, assuming that the block's input was written to the LiveWaveform before process() was called, so a grain
+     * with a carrier rate of 1 plays the input delay frames late. A grain started by increment() starts delay frames
+     * behind the write head. The delay plus the block size must stay within the recording's capacity (see LiveWaveform
+     * for the delays that are safe to read). The LiveWaveform must outlive the generator's use of it.
+     *
+     * \param live  The recording
+     * \param delay The number of frames behind the write head at which grains start
+     */
+    void setCarrier(const LiveWaveform<T>& live, double delay);
 
     /*!\brief Sets the grain shape
      */
-    void setShape(Waveform<T>& shape) {_shape = shape;}
+    void setShape(const Waveform<T>& shape) {_grains.setShape(shape);}
+
+    /*!\brief Sets a computed grain shape (see GrainPool::setShape())
+     */
+    void setShape(const GrainWindow& window) {_grains.setShape(window);}
+
+    /*!\brief Sets a band-limited Wavetable of the carrier for the grains to read from (see GrainPool::setMipmap())
+     */
+    void setCarrierMipmap(const Wavetable<T>& mipmap) {_grains.setMipmap(mipmap);}
+
+    /*!\brief Sets whether the grains keep their phases in fixed point (see GrainPool::setFixedPoint())
+     */
+    void setFixedPoint(bool fixed) {_grains.setFixedPoint(fixed);}
+
+    /*!\brief Sets the factors that convert the freq and length inputs to carrier and shape rates
+     *
+     * A grain's carrier rate is freq*carrier_scale and its shape rate is shape_scale/length. Both factors default to 1,
+     * which is right for waveforms that have one sample per frame of a one second cycle.
+     */
+    void setRateScales(double carrier_scale, double shape_scale) {_crate_scale = carrier_scale; _srate_scale = shape_scale;}
 
     /*!\brief Sets the random parameters
      */
-    void setRandParams(GrainParams<T> rand) {_rand = rand;}
+    void setRandParams(GrainParams<T> rand) {_rand = rand; _scheduleGrain();}
     
     /*!\brief Sets the amount of desnity randomization [0,1]
      */
-    void setDensityRand(double rand) {_rand.density = rand;}
+    void setDensityRand(double rand) {_rand.density = rand; _scheduleGrain();}
 
     /*!\brief Sets the amount of length randomization [0,1]
      */
@@ -88,35 +171,79 @@ namespace audioelectric {
      */
     void setFreqRand(double rand) {_rand.freq = rand;}
 
+    /*!\brief Restarts the random number generator with a seed (see GrainRandom)
+     *
+     * A generator's grains are randomized the same way every time it's given the same seed and stream. Generators
+     * start with a seed and stream of 0.
+     *
+     * \param seed   The seed
+     * \param stream The stream, which should differ between generators that share a seed
+     */
+    void setSeed(uint64_t seed, uint64_t stream=0) {_rng.seed(seed, stream);}
+
   private:
 
     // Random
-    std::ranlux48_base _gen;
-//    std::mt19937 _gen;                          //!< Random number algorithm
-    std::uniform_real_distribution<T> _dist;     //!< Random number generator
+    GrainRandom<T> _rng;                //!< Random number generator
 
     // Grains
-    std::list<Grain<T>> _active;       //!< The active grains
-    std::list<Grain<T>> _inactive;     //!< The inactive grains
+    GrainPool<T> _grains;              //!< The active grains
+    std::vector<GrainEvent<T>> _events; //!< The grains that start during the current block (as many as the pool holds)
+    size_t _nevents;                    //!< The number of grains that start during the current block
+    const LiveWaveform<T>* _live;       //!< The live recording that the carrier is read from, if any
+    double _live_delay;                 //!< The number of frames behind the write head at which grains start
     double _last_grain_t;              //!< The time since the last grain was generated
-    double _rand_grain_t;              //!< The time of the next grain
+    double _rand_grain_t;              //!< The randomization of the time of the next grain [-1,1]
+    double _next_grain_t;              //!< The time since the last grain at which the next grain is due
 
     // Inputs (signals that come from signal generators of some sort)
     GrainParams<T> _params;
+    GrainParams<T> _from;               //!< The inputs at the start of the current ramp
+    GrainParams<T> _target;             //!< The inputs at the end of the current ramp
+    GrainParams<T> _ramp;               //!< The change in the inputs on each frame of the ramp
+    size_t _ramp_len;                   //!< The length of the current ramp
+    size_t _ramp_pos;                   //!< The number of frames of the ramp that have passed
 
     // Controls (settings that are controlled by the user)
-    Waveform<T>& _carrier;              //!< The carrier waveform
-    Waveform<T>& _shape;                //!< The shape waveform
     GrainParams<T> _rand;               //!< Thre randomization amount for the params
+    double _crate_scale;                //!< Converts the freq input to a carrier rate
+    double _srate_scale;                //!< Converts the inverse of the length input to a shape rate
 
-    void _allocateGrains(void);
+    /*!\brief Generates a new grain with randomized parameters and resets the grain timer
+     *
+     * \param params The inputs to generate the grain from
+     * \param offset The frame of the current block on which the grain starts
+     * \param lag    The number of frames that the grain starts behind the start of a live carrier's delay (the frames of
+     *               the block that follow the grain's onset)
+     */
+    GrainEvent<T> _emitGrain(const GrainParams<T>& params, size_t offset=0, size_t lag=0);
+
+    /*!\brief Returns the inputs as they will be after another frames frames of the ramp
+     *
+     * Each point on the ramp is computed from its start, so process() and increment() see exactly the same inputs.
+     */
+    GrainParams<T> _rampedParams(size_t frames) const;
+
+    /*!\brief Returns the time since the last grain at which the next grain is due, with the inputs after another frames
+     *        frames of the ramp
+     */
+    double _nextGrainTime(size_t frames) const {return _grainTime(_rampedParams(frames).density);}
 
-    void _moveAndSetGrain(double crate, double srate, T ampl, double front, double back);
+    /*!\brief Returns the time since the last grain at which the next grain is due at a density
+     */
+    double _grainTime(T density) const {return 1./density*(1. + _rand_grain_t*_rand.density);}
+
+    /*!\brief Works out the time of the next grain from the current inputs
+     */
+    void _scheduleGrain(void) {_next_grain_t = _nextGrainTime(0);}
+
+    /*!\brief Moves the inputs along the ramp by a number of frames
+     */
+    void _advanceRamp(size_t frames);
 
-    /*!\brief Generates a random number on the interval of [-1,1]
+    /*!\brief Generates a random number on the interval of [-1,1], scaled by mult
      *
-     * \todo Right now this uses the mt19937 algorithm, but at some point I need to run some tests to find the fastest
-     *       algorithm
+     * No number is drawn if mult is 0, so parameters that aren't randomized don't use up the generator's values.
      */
     inline T _random(T mult=1);
 
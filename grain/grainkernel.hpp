@@ -0,0 +1,871 @@
+/* \file grainkernel.hpp
+ * \brief Contains the vectorized kernels that render the grains in a GrainPool
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ *
+ * sumGrains() works across GRAIN_LANES grains at a time and renderGrain() works across consecutive frames of a single
+ * grain. The SIMD version used depends on the instruction sets that the library is compiled for (build with --native to
+ * enable AVX2). Every version of sumGrains() accumulates grain i into lane i%GRAIN_LANES and reduces the lanes in the same
+ * order, and every version of renderGrain() computes each frame with the same operations, so the SIMD and scalar versions
+ * return bit-identical results.
+ *
+ * Only linear interpolation is vectorized across grains and frames. The overloads that take an InterpType interpolate
+ * the carrier one lookup at a time with the kernels in interpolate.hpp, which are vectorized across their taps instead.
+ *
+ * The overloads that take a SampleFormat read a carrier of 16-bit samples (see CompactWaveform). The samples are
+ * converted to floats right after they're loaded (with a single 32-bit gather for each pair of neighbouring samples
+ * under AVX2), and from there the grains are computed exactly as they are for a float carrier.
+ *
+ * sumWindowed() and renderWindowed() take the grains' shapes already computed (see GrainWindow), so they only look up
+ * the carriers. sumComputed() and renderComputed() take both the carriers and the shapes already computed, for grains
+ * whose carriers are computed as they play (see SineCarrier), and rotateGrains() moves those carriers along.
+ * sumStrided() and renderStrided() read one channel of an interleaved carrier, whose frames aren't next to each other.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "compact.hpp"
+#include "interpolate.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define GRAIN_LANES 8
+
+namespace audioelectric {
+
+  namespace kernel {
+
+    /*!\brief Scalar linear interpolation, matching Waveform::interp()
+     *
+     * The bounds aren't checked: the second sample of the last frame is read from the Waveform's guard frame. The index
+     * of the first sample is masked, which wraps it on a power-of-two waveform with wrapped guards (see
+     * Waveform::cyclic()). A mask of -1 leaves it unchanged.
+     */
+    template <typename T>
+    inline T lookup(const T* data, long mask, double pos)
+    {
+      long p = pos;
+      const T* d = data + (p & mask);
+      T a = d[0];
+      T b = d[1];
+      double diff = pos - (double)p;
+      return (b-a)*diff + a;
+    }
+
+    /*!\brief Scalar interpolation with an interpolation type, matching Waveform::interp()
+     */
+    template <typename T>
+    inline T lookup(const T* data, long mask, double pos, InterpType it)
+    {
+      long p = pos;
+      return interpolate(data + (p & mask), 1, pos - (double)p, it);
+    }
+
+    /*!\brief Scalar interpolation of one channel of an interleaved waveform, whose frames are stride samples apart
+     */
+    template <typename T>
+    inline T lookup(const T* data, size_t stride, long mask, double pos, InterpType it)
+    {
+      long p = pos;
+      return interpolate(data + (p & mask)*stride, stride, pos - (double)p, it);
+    }
+
+    /*!\brief Cycles a carrier phase that has left [front,back] back into it, just like a cycling Phasor
+     */
+    inline double cycle(double phase, double front, double back)
+    {
+      if (phase > back)
+        return fmod(phase - front, back - front) + front;
+      else if (phase < front)
+        return back - fmod(back - phase, back - front);
+      return phase;
+    }
+
+    /*!\brief Cycles a fixed-point carrier phase back into [front,back] just as cycle() does
+     */
+    inline int64_t cycleFixed(int64_t phase, int64_t front, int64_t back)
+    {
+      if (phase > back)
+        return (phase - front) % (back - front) + front;
+      else if (phase < front)
+        return back - (back - phase) % (back - front);
+      return phase;
+    }
+
+    /*!\brief Reduces the lane accumulators: lanes j and j+4 first, then j and j+2, then the final two
+     */
+    template <typename T>
+    inline T reduce(const T* acc)
+    {
+      T s0 = acc[0] + acc[4];
+      T s1 = acc[1] + acc[5];
+      T s2 = acc[2] + acc[6];
+      T s3 = acc[3] + acc[7];
+      s0 += s2;
+      s1 += s3;
+      return s0 + s1;
+    }
+
+#if defined(__AVX2__)
+
+    /*!\brief Interpolates four positions of a float table with gathers
+     */
+    inline __m128 lookup4(const float* data, __m128i mask, __m256d pos)
+    {
+      __m128i p = _mm256_cvttpd_epi32(pos);
+      __m128i idx = _mm_and_si128(p, mask);
+      __m128 a = _mm_i32gather_ps(data, idx, 4);
+      __m128 b = _mm_i32gather_ps(data + 1, idx, 4);
+      __m256d diff = _mm256_sub_pd(pos, _mm256_cvtepi32_pd(p));
+      __m256d val = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtps_pd(_mm_sub_ps(b, a)), diff), _mm256_cvtps_pd(a));
+      return _mm256_cvtpd_ps(val);
+    }
+
+    /*!\brief Interpolates four positions, each in its own float table
+     *
+     * The tables can't share a gather, so their samples are loaded one at a time.
+     */
+    inline __m128 lookup4(const float* const* data, long mask, __m256d pos)
+    {
+      __m128i p = _mm256_cvttpd_epi32(pos);
+      alignas(16) int idx[4];
+      _mm_store_si128((__m128i*)idx, _mm_and_si128(p, _mm_set1_epi32(mask)));
+      const float* d0 = data[0] + idx[0];
+      const float* d1 = data[1] + idx[1];
+      const float* d2 = data[2] + idx[2];
+      const float* d3 = data[3] + idx[3];
+      __m128 a = _mm_setr_ps(d0[0], d1[0], d2[0], d3[0]);
+      __m128 b = _mm_setr_ps(d0[1], d1[1], d2[1], d3[1]);
+      __m256d diff = _mm256_sub_pd(pos, _mm256_cvtepi32_pd(p));
+      __m256d val = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtps_pd(_mm_sub_ps(b, a)), diff), _mm256_cvtps_pd(a));
+      return _mm256_cvtpd_ps(val);
+    }
+
+#elif defined(__SSE2__)
+
+    /*!\brief Interpolates two positions, each in its own float table
+     */
+    inline __m128d lookup2(const float* const* data, long mask, __m128d pos)
+    {
+      __m128i p = _mm_cvttpd_epi32(pos);
+      const float* d0 = data[0] + (_mm_cvtsi128_si32(p) & mask);
+      const float* d1 = data[1] + (_mm_cvtsi128_si32(_mm_shuffle_epi32(p, 1)) & mask);
+      __m128 a = _mm_setr_ps(d0[0], d1[0], 0, 0);
+      __m128 b = _mm_setr_ps(d0[1], d1[1], 0, 0);
+      __m128d diff = _mm_sub_pd(pos, _mm_cvtepi32_pd(p));
+      return _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(_mm_sub_ps(b, a)), diff), _mm_cvtps_pd(a));
+    }
+
+    /*!\brief Interpolates four positions, each in its own float table
+     */
+    inline __m128 lookup4(const float* const* data, long mask, const double* pos)
+    {
+      __m128 lo = _mm_cvtpd_ps(lookup2(data, mask, _mm_loadu_pd(pos)));
+      __m128 hi = _mm_cvtpd_ps(lookup2(data + 2, mask, _mm_loadu_pd(pos + 2)));
+      return _mm_movelh_ps(lo, hi);
+    }
+
+#endif
+
+#if defined(__SSE2__)
+
+    /*!\brief Converts four half-precision floats (in the low halves of the 32-bit lanes) to floats, like unpackHalf()
+     */
+    inline __m128 unpackHalf4(__m128i h)
+    {
+      __m128i em = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+      __m128 f = _mm_mul_ps(_mm_castsi128_ps(em), _mm_set1_ps(0x1p112f));
+      __m128i infnan = _mm_and_si128(_mm_cmpgt_epi32(em, _mm_set1_epi32(0x0f7fffff)), _mm_set1_epi32(0x7f800000));
+      __m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+      return _mm_or_ps(f, _mm_castsi128_ps(_mm_or_si128(infnan, sign)));
+    }
+
+    /*!\brief Converts four pairs of 16-bit samples to floats
+     *
+     * Each 32-bit lane of v holds a sample in its low half and the next sample in its high half, which are returned in a
+     * and b.
+     */
+    template <SampleFormat F>
+    inline void unpack4(__m128i v, __m128& a, __m128& b)
+    {
+      if constexpr (F == SampleFormat::HALF) {
+#if defined(__F16C__)
+        __m128 lo = _mm_cvtph_ps(v);
+        __m128 hi = _mm_cvtph_ps(_mm_unpackhi_epi64(v, v));
+        a = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        b = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+#else
+        a = unpackHalf4(_mm_and_si128(v, _mm_set1_epi32(0xffff)));
+        b = unpackHalf4(_mm_srli_epi32(v, 16));
+#endif
+      }
+      else {
+        const __m128 scale = _mm_set1_ps(1.f/32768);
+        a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(v, 16), 16)), scale);
+        b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(v, 16)), scale);
+      }
+    }
+
+#endif
+
+#if defined(__AVX2__)
+
+    /*!\brief Interpolates four positions of a table of 16-bit samples with a gather
+     *
+     * Each 32-bit gather reads a sample along with the next one.
+     */
+    template <SampleFormat F>
+    inline __m128 lookup4(const uint16_t* data, __m128i mask, __m256d pos)
+    {
+      __m128i p = _mm256_cvttpd_epi32(pos);
+      __m128i idx = _mm_and_si128(p, mask);
+      __m128 a, b;
+      unpack4<F>(_mm_i32gather_epi32((const int*)data, idx, 2), a, b);
+      __m256d diff = _mm256_sub_pd(pos, _mm256_cvtepi32_pd(p));
+      __m256d val = _mm256_add_pd(_mm256_mul_pd(_mm256_cvtps_pd(_mm_sub_ps(b, a)), diff), _mm256_cvtps_pd(a));
+      return _mm256_cvtpd_ps(val);
+    }
+
+#elif defined(__SSE2__)
+
+    /*!\brief Interpolates four positions of a table of 16-bit samples
+     *
+     * Each pair of neighbouring samples is loaded as one 32-bit word, and the words are converted together.
+     */
+    template <SampleFormat F>
+    inline __m128 lookup4(const uint16_t* data, long mask, const double* pos)
+    {
+      __m128d plo = _mm_loadu_pd(pos);
+      __m128d phi = _mm_loadu_pd(pos + 2);
+      __m128i ilo = _mm_cvttpd_epi32(plo);
+      __m128i ihi = _mm_cvttpd_epi32(phi);
+      alignas(16) int idx[4];
+      _mm_store_si128((__m128i*)idx, _mm_and_si128(_mm_unpacklo_epi64(ilo, ihi), _mm_set1_epi32(mask)));
+      uint32_t words[4];
+      for (int k=0; k<4; k++)
+        memcpy(words + k, data + idx[k], 4);
+      __m128 a, b;
+      unpack4<F>(_mm_loadu_si128((const __m128i*)words), a, b);
+      __m128 d = _mm_sub_ps(b, a);
+      __m128d lo = _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(d), _mm_sub_pd(plo, _mm_cvtepi32_pd(ilo))), _mm_cvtps_pd(a));
+      __m128d hi = _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(d, d)), _mm_sub_pd(phi, _mm_cvtepi32_pd(ihi))),
+                              _mm_cvtps_pd(_mm_movehl_ps(a, a)));
+      return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+    }
+
+#endif
+
+    /*!\brief Accumulates grains [begin,n) into the lane accumulators one grain at a time
+     */
+    template <typename T>
+    inline void sumGrainsScalar(T* acc, const T* const* carrier, long cmask, const double* cphase, const T* shape,
+                                const double* sphase, const T* ampl, size_t begin, size_t n)
+    {
+      for (size_t i=begin; i<n; i++)
+        acc[i % GRAIN_LANES] += lookup(carrier[i], cmask, cphase[i]) * lookup(shape, -1, sphase[i]) * ampl[i];
+    }
+
+  }  // kernel
+
+  /*!\brief Returns the sum of a set of grains
+   *
+   * Each grain's value is carrier(cphase)*shape(sphase)*ampl, where the carrier and shape are linearly interpolated
+   * just like Waveform::interp(). The bounds aren't checked, so every phase must be within its waveform (up to its
+   * size()), and the data must come from Waveforms, whose guard frames hold the samples past the end.
+   *
+   * \param carrier The carrier data of each grain (the carriers may differ, but they must all have the same size)
+   * \param cmask   The mask applied to carrier indices (size-1 for a periodic power-of-two carrier with wrapped guards,
+   *                otherwise -1)
+   * \param cphase  The carrier phases of the grains
+   * \param shape   The shape data
+   * \param sphase  The shape phases of the grains
+   * \param ampl    The amplitudes of the grains
+   * \param n       The number of grains
+   */
+  template <typename T>
+  inline T sumGrains(const T* const* carrier, long cmask, const double* cphase, const T* shape, const double* sphase,
+                     const T* ampl, size_t n)
+  {
+    T acc[GRAIN_LANES] = {0};
+    kernel::sumGrainsScalar(acc, carrier, cmask, cphase, shape, sphase, ampl, 0, n);
+    return kernel::reduce(acc);
+  }
+
+#if defined(__AVX2__)
+
+  template <>
+  inline float sumGrains<float>(const float* const* carrier, long cmask, const double* cphase, const float* shape,
+                                const double* sphase, const float* ampl, size_t n)
+  {
+    __m128i vsmask = _mm_set1_epi32(-1);
+    __m256 vacc = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + GRAIN_LANES <= n; i += GRAIN_LANES) {
+      __m256 c = _mm256_set_m128(kernel::lookup4(carrier + i + 4, cmask, _mm256_loadu_pd(cphase + i + 4)),
+                                 kernel::lookup4(carrier + i, cmask, _mm256_loadu_pd(cphase + i)));
+      __m256 s = _mm256_set_m128(kernel::lookup4(shape, vsmask, _mm256_loadu_pd(sphase + i + 4)),
+                                 kernel::lookup4(shape, vsmask, _mm256_loadu_pd(sphase + i)));
+      vacc = _mm256_add_ps(vacc, _mm256_mul_ps(_mm256_mul_ps(c, s), _mm256_loadu_ps(ampl + i)));
+    }
+    alignas(32) float acc[GRAIN_LANES];
+    _mm256_store_ps(acc, vacc);
+    kernel::sumGrainsScalar(acc, carrier, cmask, cphase, shape, sphase, ampl, i, n);
+    return kernel::reduce(acc);
+  }
+
+#elif defined(__SSE2__)
+
+  template <>
+  inline float sumGrains<float>(const float* const* carrier, long cmask, const double* cphase, const float* shape,
+                                const double* sphase, const float* ampl, size_t n)
+  {
+    const float* shapes[4] = {shape, shape, shape, shape};
+    __m128 vacc_lo = _mm_setzero_ps();
+    __m128 vacc_hi = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + GRAIN_LANES <= n; i += GRAIN_LANES) {
+      __m128 c = kernel::lookup4(carrier + i, cmask, cphase + i);
+      __m128 s = kernel::lookup4(shapes, -1, sphase + i);
+      vacc_lo = _mm_add_ps(vacc_lo, _mm_mul_ps(_mm_mul_ps(c, s), _mm_loadu_ps(ampl + i)));
+      c = kernel::lookup4(carrier + i + 4, cmask, cphase + i + 4);
+      s = kernel::lookup4(shapes, -1, sphase + i + 4);
+      vacc_hi = _mm_add_ps(vacc_hi, _mm_mul_ps(_mm_mul_ps(c, s), _mm_loadu_ps(ampl + i + 4)));
+    }
+    alignas(16) float acc[GRAIN_LANES];
+    _mm_store_ps(acc, vacc_lo);
+    _mm_store_ps(acc + 4, vacc_hi);
+    kernel::sumGrainsScalar(acc, carrier, cmask, cphase, shape, sphase, ampl, i, n);
+    return kernel::reduce(acc);
+  }
+
+#endif
+
+  /*!\brief Returns the sum of a set of grains, interpolating their carriers with an interpolation type
+   *
+   * This is sumGrains() with the carrier lookups done by kernel::interpolate(). The grains are accumulated into the
+   * same lanes, so a LINEAR carrier gives the same result either way.
+   */
+  template <typename T>
+  inline T sumGrains(const T* const* carrier, long cmask, InterpType cinterp, const double* cphase, const T* shape,
+                     const double* sphase, const T* ampl, size_t n)
+  {
+    if (cinterp == InterpType::LINEAR)
+      return sumGrains(carrier, cmask, cphase, shape, sphase, ampl, n);
+    T acc[GRAIN_LANES] = {0};
+    for (size_t i=0; i<n; i++)
+      acc[i % GRAIN_LANES] += kernel::lookup(carrier[i], cmask, cphase[i], cinterp) * kernel::lookup(shape, -1, sphase[i])
+        * ampl[i];
+    return kernel::reduce(acc);
+  }
+
+  /*!\brief Adds a single grain to a span of frames
+   *
+   * This renders one grain over consecutive frames rather than many grains on one frame, and each frame's value is
+   * computed exactly as it is in sumGrains().
+   *
+   * \param out     The buffer to add the grain to
+   * \param carrier The carrier data
+   * \param cmask   The mask applied to carrier indices (size-1 for a periodic power-of-two carrier with wrapped guards,
+   *                otherwise -1)
+   * \param cphase  The carrier phase on each frame
+   * \param shape   The shape data
+   * \param sphase  The shape phase on each frame
+   * \param ampl    The amplitude of the grain
+   * \param n       The number of frames
+   */
+  template <typename T>
+  inline void renderGrain(T* out, const T* carrier, long cmask, const double* cphase, const T* shape,
+                          const double* sphase, T ampl, size_t n)
+  {
+    for (size_t i=0; i<n; i++)
+      out[i] += kernel::lookup(carrier, cmask, cphase[i]) * kernel::lookup(shape, -1, sphase[i]) * ampl;
+  }
+
+#if defined(__AVX2__)
+
+  template <>
+  inline void renderGrain<float>(float* out, const float* carrier, long cmask, const double* cphase, const float* shape,
+                                 const double* sphase, float ampl, size_t n)
+  {
+    __m128i vcmask = _mm_set1_epi32(cmask);
+    __m128i vsmask = _mm_set1_epi32(-1);
+    __m256 vampl = _mm256_set1_ps(ampl);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      __m256 c = _mm256_set_m128(kernel::lookup4(carrier, vcmask, _mm256_loadu_pd(cphase + i + 4)),
+                                 kernel::lookup4(carrier, vcmask, _mm256_loadu_pd(cphase + i)));
+      __m256 s = _mm256_set_m128(kernel::lookup4(shape, vsmask, _mm256_loadu_pd(sphase + i + 4)),
+                                 kernel::lookup4(shape, vsmask, _mm256_loadu_pd(sphase + i)));
+      _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(_mm256_mul_ps(c, s), vampl)));
+    }
+    for (; i<n; i++)
+      out[i] += kernel::lookup(carrier, cmask, cphase[i]) * kernel::lookup(shape, -1, sphase[i]) * ampl;
+  }
+
+#elif defined(__SSE2__)
+
+  template <>
+  inline void renderGrain<float>(float* out, const float* carrier, long cmask, const double* cphase, const float* shape,
+                                 const double* sphase, float ampl, size_t n)
+  {
+    const float* carriers[4] = {carrier, carrier, carrier, carrier};
+    const float* shapes[4] = {shape, shape, shape, shape};
+    __m128 vampl = _mm_set1_ps(ampl);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m128 c = kernel::lookup4(carriers, cmask, cphase + i);
+      __m128 s = kernel::lookup4(shapes, -1, sphase + i);
+      _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_mul_ps(c, s), vampl)));
+    }
+    for (; i<n; i++)
+      out[i] += kernel::lookup(carrier, cmask, cphase[i]) * kernel::lookup(shape, -1, sphase[i]) * ampl;
+  }
+
+#endif
+
+  /*!\brief Adds a single grain to a span of frames, interpolating its carrier with an interpolation type
+   */
+  template <typename T>
+  inline void renderGrain(T* out, const T* carrier, long cmask, InterpType cinterp, const double* cphase,
+                          const T* shape, const double* sphase, T ampl, size_t n)
+  {
+    if (cinterp == InterpType::LINEAR) {
+      renderGrain(out, carrier, cmask, cphase, shape, sphase, ampl, n);
+      return;
+    }
+    for (size_t i=0; i<n; i++)
+      out[i] += kernel::lookup(carrier, cmask, cphase[i], cinterp) * kernel::lookup(shape, -1, sphase[i]) * ampl;
+  }
+
+  namespace kernel {
+
+    /*!\brief Accumulates grains [begin,n) of a 16-bit carrier into the lane accumulators one grain at a time
+     */
+    template <SampleFormat F, typename T>
+    inline void sumPackedScalar(T* acc, const uint16_t* carrier, long cmask, const double* cphase, const T* shape,
+                                const double* sphase, const T* ampl, size_t begin, size_t n)
+    {
+      for (size_t i=begin; i<n; i++)
+        acc[i % GRAIN_LANES] += lookup<F, T>(carrier, cmask, cphase[i]) * lookup(shape, -1, sphase[i]) * ampl[i];
+    }
+
+    /*!\brief sumGrains() for a carrier of 16-bit samples of a format
+     */
+    template <SampleFormat F, typename T>
+    inline T sumPacked(const uint16_t* carrier, long cmask, const double* cphase, const T* shape, const double* sphase,
+                       const T* ampl, size_t n)
+    {
+      T acc[GRAIN_LANES] = {0};
+      sumPackedScalar<F>(acc, carrier, cmask, cphase, shape, sphase, ampl, 0, n);
+      return reduce(acc);
+    }
+
+    /*!\brief renderGrain() for a carrier of 16-bit samples of a format
+     */
+    template <SampleFormat F, typename T>
+    inline void renderPacked(T* out, const uint16_t* carrier, long cmask, const double* cphase, const T* shape,
+                             const double* sphase, T ampl, size_t n)
+    {
+      for (size_t i=0; i<n; i++)
+        out[i] += lookup<F, T>(carrier, cmask, cphase[i]) * lookup(shape, -1, sphase[i]) * ampl;
+    }
+
+#if defined(__AVX2__)
+
+    template <SampleFormat F>
+    inline float sumPacked(const uint16_t* carrier, long cmask, const double* cphase, const float* shape,
+                           const double* sphase, const float* ampl, size_t n)
+    {
+      __m128i vcmask = _mm_set1_epi32(cmask);
+      __m128i vsmask = _mm_set1_epi32(-1);
+      __m256 vacc = _mm256_setzero_ps();
+      size_t i = 0;
+      for (; i + GRAIN_LANES <= n; i += GRAIN_LANES) {
+        __m256 c = _mm256_set_m128(lookup4<F>(carrier, vcmask, _mm256_loadu_pd(cphase + i + 4)),
+                                   lookup4<F>(carrier, vcmask, _mm256_loadu_pd(cphase + i)));
+        __m256 s = _mm256_set_m128(lookup4(shape, vsmask, _mm256_loadu_pd(sphase + i + 4)),
+                                   lookup4(shape, vsmask, _mm256_loadu_pd(sphase + i)));
+        vacc = _mm256_add_ps(vacc, _mm256_mul_ps(_mm256_mul_ps(c, s), _mm256_loadu_ps(ampl + i)));
+      }
+      alignas(32) float acc[GRAIN_LANES];
+      _mm256_store_ps(acc, vacc);
+      sumPackedScalar<F>(acc, carrier, cmask, cphase, shape, sphase, ampl, i, n);
+      return reduce(acc);
+    }
+
+    template <SampleFormat F>
+    inline void renderPacked(float* out, const uint16_t* carrier, long cmask, const double* cphase, const float* shape,
+                             const double* sphase, float ampl, size_t n)
+    {
+      __m128i vcmask = _mm_set1_epi32(cmask);
+      __m128i vsmask = _mm_set1_epi32(-1);
+      __m256 vampl = _mm256_set1_ps(ampl);
+      size_t i = 0;
+      for (; i + 8 <= n; i += 8) {
+        __m256 c = _mm256_set_m128(lookup4<F>(carrier, vcmask, _mm256_loadu_pd(cphase + i + 4)),
+                                   lookup4<F>(carrier, vcmask, _mm256_loadu_pd(cphase + i)));
+        __m256 s = _mm256_set_m128(lookup4(shape, vsmask, _mm256_loadu_pd(sphase + i + 4)),
+                                   lookup4(shape, vsmask, _mm256_loadu_pd(sphase + i)));
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(_mm256_mul_ps(c, s), vampl)));
+      }
+      for (; i<n; i++)
+        out[i] += lookup<F, float>(carrier, cmask, cphase[i]) * lookup(shape, -1, sphase[i]) * ampl;
+    }
+
+#elif defined(__SSE2__)
+
+    template <SampleFormat F>
+    inline float sumPacked(const uint16_t* carrier, long cmask, const double* cphase, const float* shape,
+                           const double* sphase, const float* ampl, size_t n)
+    {
+      const float* shapes[4] = {shape, shape, shape, shape};
+      __m128 vacc_lo = _mm_setzero_ps();
+      __m128 vacc_hi = _mm_setzero_ps();
+      size_t i = 0;
+      for (; i + GRAIN_LANES <= n; i += GRAIN_LANES) {
+        __m128 c = lookup4<F>(carrier, cmask, cphase + i);
+        __m128 s = lookup4(shapes, -1, sphase + i);
+        vacc_lo = _mm_add_ps(vacc_lo, _mm_mul_ps(_mm_mul_ps(c, s), _mm_loadu_ps(ampl + i)));
+        c = lookup4<F>(carrier, cmask, cphase + i + 4);
+        s = lookup4(shapes, -1, sphase + i + 4);
+        vacc_hi = _mm_add_ps(vacc_hi, _mm_mul_ps(_mm_mul_ps(c, s), _mm_loadu_ps(ampl + i + 4)));
+      }
+      alignas(16) float acc[GRAIN_LANES];
+      _mm_store_ps(acc, vacc_lo);
+      _mm_store_ps(acc + 4, vacc_hi);
+      sumPackedScalar<F>(acc, carrier, cmask, cphase, shape, sphase, ampl, i, n);
+      return reduce(acc);
+    }
+
+    template <SampleFormat F>
+    inline void renderPacked(float* out, const uint16_t* carrier, long cmask, const double* cphase, const float* shape,
+                             const double* sphase, float ampl, size_t n)
+    {
+      const float* shapes[4] = {shape, shape, shape, shape};
+      __m128 vampl = _mm_set1_ps(ampl);
+      size_t i = 0;
+      for (; i + 4 <= n; i += 4) {
+        __m128 c = lookup4<F>(carrier, cmask, cphase + i);
+        __m128 s = lookup4(shapes, -1, sphase + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_mul_ps(c, s), vampl)));
+      }
+      for (; i<n; i++)
+        out[i] += lookup<F, float>(carrier, cmask, cphase[i]) * lookup(shape, -1, sphase[i]) * ampl;
+    }
+
+#endif
+
+  }  // kernel
+
+  /*!\brief Returns the sum of a set of grains that read a carrier of 16-bit samples
+   *
+   * This is sumGrains() with every grain reading the same carrier, whose samples are converted to floats as they're
+   * read. The result is the same as sumGrains() on a float carrier of the decoded samples.
+   *
+   * \param carrier The carrier data (see CompactWaveform::data())
+   * \param format  The format of the carrier's samples
+   */
+  template <typename T>
+  inline T sumGrains(const uint16_t* carrier, SampleFormat format, long cmask, const double* cphase, const T* shape,
+                     const double* sphase, const T* ampl, size_t n)
+  {
+    if (format == SampleFormat::HALF)
+      return kernel::sumPacked<SampleFormat::HALF>(carrier, cmask, cphase, shape, sphase, ampl, n);
+    return kernel::sumPacked<SampleFormat::INT16>(carrier, cmask, cphase, shape, sphase, ampl, n);
+  }
+
+  /*!\brief Adds a single grain that reads a carrier of 16-bit samples to a span of frames
+   */
+  template <typename T>
+  inline void renderGrain(T* out, const uint16_t* carrier, SampleFormat format, long cmask, const double* cphase,
+                          const T* shape, const double* sphase, T ampl, size_t n)
+  {
+    if (format == SampleFormat::HALF)
+      kernel::renderPacked<SampleFormat::HALF>(out, carrier, cmask, cphase, shape, sphase, ampl, n);
+    else
+      kernel::renderPacked<SampleFormat::INT16>(out, carrier, cmask, cphase, shape, sphase, ampl, n);
+  }
+
+  /*!\brief Returns the sum of a set of grains whose shapes have already been computed (see GrainWindow)
+   *
+   * Each grain's value is carrier(cphase)*window*ampl, accumulated into the same lanes as sumGrains().
+   *
+   * \param window The shape of each grain
+   */
+  template <typename T>
+  inline T sumWindowed(const T* const* carrier, long cmask, InterpType cinterp, const double* cphase, const T* window,
+                       const T* ampl, size_t n)
+  {
+    T acc[GRAIN_LANES] = {0};
+    if (cinterp == InterpType::LINEAR) {
+      for (size_t i=0; i<n; i++)
+        acc[i % GRAIN_LANES] += kernel::lookup(carrier[i], cmask, cphase[i]) * window[i] * ampl[i];
+    }
+    else {
+      for (size_t i=0; i<n; i++)
+        acc[i % GRAIN_LANES] += kernel::lookup(carrier[i], cmask, cphase[i], cinterp) * window[i] * ampl[i];
+    }
+    return kernel::reduce(acc);
+  }
+
+  /*!\brief Returns the sum of a set of grains that read a carrier of 16-bit samples and whose shapes have already been
+   *        computed
+   */
+  template <typename T>
+  inline T sumWindowed(const uint16_t* carrier, SampleFormat format, long cmask, const double* cphase, const T* window,
+                       const T* ampl, size_t n)
+  {
+    T acc[GRAIN_LANES] = {0};
+    if (format == SampleFormat::HALF) {
+      for (size_t i=0; i<n; i++)
+        acc[i % GRAIN_LANES] += kernel::lookup<SampleFormat::HALF, T>(carrier, cmask, cphase[i]) * window[i] * ampl[i];
+    }
+    else {
+      for (size_t i=0; i<n; i++)
+        acc[i % GRAIN_LANES] += kernel::lookup<SampleFormat::INT16, T>(carrier, cmask, cphase[i]) * window[i] * ampl[i];
+    }
+    return kernel::reduce(acc);
+  }
+
+  namespace kernel {
+
+    /*!\brief renderWindowed() with a linearly interpolated carrier
+     */
+    template <typename T>
+    inline void renderWindowedLinear(T* out, const T* carrier, long cmask, const double* cphase, const T* window, T ampl,
+                                     size_t n)
+    {
+      for (size_t i=0; i<n; i++)
+        out[i] += lookup(carrier, cmask, cphase[i]) * window[i] * ampl;
+    }
+
+#if defined(__AVX2__)
+
+    template <>
+    inline void renderWindowedLinear<float>(float* out, const float* carrier, long cmask, const double* cphase,
+                                            const float* window, float ampl, size_t n)
+    {
+      __m128i vcmask = _mm_set1_epi32(cmask);
+      __m256 vampl = _mm256_set1_ps(ampl);
+      size_t i = 0;
+      for (; i + 8 <= n; i += 8) {
+        __m256 c = _mm256_set_m128(lookup4(carrier, vcmask, _mm256_loadu_pd(cphase + i + 4)),
+                                   lookup4(carrier, vcmask, _mm256_loadu_pd(cphase + i)));
+        __m256 w = _mm256_loadu_ps(window + i);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(_mm256_mul_ps(c, w), vampl)));
+      }
+      for (; i<n; i++)
+        out[i] += lookup(carrier, cmask, cphase[i]) * window[i] * ampl;
+    }
+
+#elif defined(__SSE2__)
+
+    template <>
+    inline void renderWindowedLinear<float>(float* out, const float* carrier, long cmask, const double* cphase,
+                                            const float* window, float ampl, size_t n)
+    {
+      const float* carriers[4] = {carrier, carrier, carrier, carrier};
+      __m128 vampl = _mm_set1_ps(ampl);
+      size_t i = 0;
+      for (; i + 4 <= n; i += 4) {
+        __m128 c = lookup4(carriers, cmask, cphase + i);
+        __m128 w = _mm_loadu_ps(window + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_mul_ps(c, w), vampl)));
+      }
+      for (; i<n; i++)
+        out[i] += lookup(carrier, cmask, cphase[i]) * window[i] * ampl;
+    }
+
+#endif
+
+  }  // kernel
+
+  /*!\brief Adds a single grain whose shape has already been computed to a span of frames
+   *
+   * Each frame's value is computed exactly as it is in sumWindowed().
+   *
+   * \param window The shape of the grain on each frame
+   */
+  template <typename T>
+  inline void renderWindowed(T* out, const T* carrier, long cmask, InterpType cinterp, const double* cphase,
+                             const T* window, T ampl, size_t n)
+  {
+    if (cinterp == InterpType::LINEAR) {
+      kernel::renderWindowedLinear(out, carrier, cmask, cphase, window, ampl, n);
+      return;
+    }
+    for (size_t i=0; i<n; i++)
+      out[i] += kernel::lookup(carrier, cmask, cphase[i], cinterp) * window[i] * ampl;
+  }
+
+  /*!\brief Adds a single grain that reads a carrier of 16-bit samples, and whose shape has already been computed, to a
+   *        span of frames
+   */
+  template <typename T>
+  inline void renderWindowed(T* out, const uint16_t* carrier, SampleFormat format, long cmask, const double* cphase,
+                             const T* window, T ampl, size_t n)
+  {
+    if (format == SampleFormat::HALF) {
+      for (size_t i=0; i<n; i++)
+        out[i] += kernel::lookup<SampleFormat::HALF, T>(carrier, cmask, cphase[i]) * window[i] * ampl;
+    }
+    else {
+      for (size_t i=0; i<n; i++)
+        out[i] += kernel::lookup<SampleFormat::INT16, T>(carrier, cmask, cphase[i]) * window[i] * ampl;
+    }
+  }
+
+  /*!\brief Returns the sum of a set of grains that read one channel of an interleaved carrier, and whose shapes have
+   *        already been computed
+   *
+   * This is sumWindowed() for a single carrier whose frames are cstride samples apart, which is always read by
+   * kernel::interpolate().
+   */
+  template <typename T>
+  inline T sumStrided(const T* carrier, size_t cstride, long cmask, InterpType cinterp, const double* cphase,
+                      const T* window, const T* ampl, size_t n)
+  {
+    T acc[GRAIN_LANES] = {0};
+    for (size_t i=0; i<n; i++)
+      acc[i % GRAIN_LANES] += kernel::lookup(carrier, cstride, cmask, cphase[i], cinterp) * window[i] * ampl[i];
+    return kernel::reduce(acc);
+  }
+
+  /*!\brief Adds a single grain that reads one channel of an interleaved carrier, and whose shape has already been
+   *        computed, to a span of frames
+   *
+   * Each frame's value is computed exactly as it is in sumStrided().
+   */
+  template <typename T>
+  inline void renderStrided(T* out, const T* carrier, size_t cstride, long cmask, InterpType cinterp,
+                            const double* cphase, const T* window, T ampl, size_t n)
+  {
+    for (size_t i=0; i<n; i++)
+      out[i] += kernel::lookup(carrier, cstride, cmask, cphase[i], cinterp) * window[i] * ampl;
+  }
+
+  /*!\brief Returns the sum of a set of grains whose carriers and shapes have already been computed
+   *
+   * Each grain's value is carrier*shape*ampl, accumulated into the same lanes as sumGrains().
+   */
+  template <typename T>
+  inline T sumComputed(const T* carrier, const T* shape, const T* ampl, size_t n)
+  {
+    T acc[GRAIN_LANES] = {0};
+    for (size_t i=0; i<n; i++)
+      acc[i % GRAIN_LANES] += carrier[i] * shape[i] * ampl[i];
+    return kernel::reduce(acc);
+  }
+
+  /*!\brief Adds a single grain whose carrier and shape have already been computed to a span of frames
+   *
+   * Each frame's value is computed exactly as it is in sumComputed().
+   */
+  template <typename T>
+  inline void renderComputed(T* out, const T* carrier, const T* shape, T ampl, size_t n)
+  {
+    for (size_t i=0; i<n; i++)
+      out[i] += carrier[i] * shape[i] * ampl;
+  }
+
+  namespace kernel {
+
+    /*!\brief Rotates a single rotator by a step (see rotateGrains())
+     */
+    inline void rotate(double& re, double& im, double dre, double dim)
+    {
+      double r = re*dre - im*dim;
+      im = im*dre + re*dim;
+      re = r;
+    }
+
+  }  // kernel
+
+  /*!\brief Rotates the carriers of a set of grains by one step each (see SineCarrier)
+   *
+   * Each rotator re+i*im is multiplied by its step dre+i*dim. Every version computes each rotator with the same
+   * operations, so the SIMD and scalar versions return bit-identical results.
+   */
+  inline void rotateGrains(double* re, double* im, const double* dre, const double* dim, size_t n)
+  {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+      __m256d a = _mm256_loadu_pd(re + i);
+      __m256d b = _mm256_loadu_pd(im + i);
+      __m256d c = _mm256_loadu_pd(dre + i);
+      __m256d d = _mm256_loadu_pd(dim + i);
+      _mm256_storeu_pd(re + i, _mm256_sub_pd(_mm256_mul_pd(a, c), _mm256_mul_pd(b, d)));
+      _mm256_storeu_pd(im + i, _mm256_add_pd(_mm256_mul_pd(b, c), _mm256_mul_pd(a, d)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+      __m128d a = _mm_loadu_pd(re + i);
+      __m128d b = _mm_loadu_pd(im + i);
+      __m128d c = _mm_loadu_pd(dre + i);
+      __m128d d = _mm_loadu_pd(dim + i);
+      _mm_storeu_pd(re + i, _mm_sub_pd(_mm_mul_pd(a, c), _mm_mul_pd(b, d)));
+      _mm_storeu_pd(im + i, _mm_add_pd(_mm_mul_pd(b, c), _mm_mul_pd(a, d)));
+    }
+#endif
+    for (; i<n; i++)
+      kernel::rotate(re[i], im[i], dre[i], dim[i]);
+  }
+
+  /*!\brief Advances the phases of a set of grains
+   *
+   * The shape phases are simply incremented by their rates. The carrier phases are incremented and then cycled back
+   * into [front,back] if they leave it, just like a cycling Phasor.
+   */
+  inline void advanceGrains(double* cphase, const double* crate, const double* front, const double* back,
+                            double* sphase, const double* srate, size_t n)
+  {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+      __m256d next = _mm256_add_pd(_mm256_loadu_pd(cphase + i), _mm256_loadu_pd(crate + i));
+      __m256d out = _mm256_or_pd(_mm256_cmp_pd(next, _mm256_loadu_pd(back + i), _CMP_GT_OQ),
+                                 _mm256_cmp_pd(next, _mm256_loadu_pd(front + i), _CMP_LT_OQ));
+      _mm256_storeu_pd(cphase + i, next);
+      _mm256_storeu_pd(sphase + i, _mm256_add_pd(_mm256_loadu_pd(sphase + i), _mm256_loadu_pd(srate + i)));
+      int wrap = _mm256_movemask_pd(out);
+      // Cycling is rare, so those lanes are fixed up one at a time
+      for (size_t j=i; wrap; j++, wrap >>= 1) {
+        if (!(wrap & 1))
+          continue;
+        cphase[j] = kernel::cycle(cphase[j], front[j], back[j]);
+      }
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2) {
+      __m128d next = _mm_add_pd(_mm_loadu_pd(cphase + i), _mm_loadu_pd(crate + i));
+      __m128d out = _mm_or_pd(_mm_cmpgt_pd(next, _mm_loadu_pd(back + i)), _mm_cmplt_pd(next, _mm_loadu_pd(front + i)));
+      _mm_storeu_pd(cphase + i, next);
+      _mm_storeu_pd(sphase + i, _mm_add_pd(_mm_loadu_pd(sphase + i), _mm_loadu_pd(srate + i)));
+      int wrap = _mm_movemask_pd(out);
+      for (size_t j=i; wrap; j++, wrap >>= 1) {
+        if (!(wrap & 1))
+          continue;
+        cphase[j] = kernel::cycle(cphase[j], front[j], back[j]);
+      }
+    }
+#endif
+    for (; i<n; i++) {
+      cphase[i] = kernel::cycle(cphase[i] + crate[i], front[i], back[i]);
+      sphase[i] += srate[i];
+    }
+  }
+
+}  // audioelectric
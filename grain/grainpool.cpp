@@ -0,0 +1,490 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include <cmath>
+#include <utility>
+
+#include "grainpool.hpp"
+#include "grainkernel.hpp"
+#include "phasor.hpp"
+
+namespace audioelectric {
+
+#define POOL_CHUNK_SIZE 64
+
+  template <typename T>
+  GrainPool<T>::GrainPool(const Waveform<T>& carrier, const Waveform<T>& shape, size_t capacity) :
+    _carrier(carrier), _shape(shape), _size(0), _fixed(false),
+    _cphase(capacity), _crate(capacity), _front(capacity), _back(capacity), _sphase(capacity), _srate(capacity),
+    _ampl(capacity), _clevel(capacity), _wstate(capacity),
+    _rre(capacity), _rim(capacity), _rdre(capacity), _rdim(capacity), _rphase(capacity), _rleft(capacity),
+    _fcphase(capacity), _fcrate(capacity), _ffront(capacity), _fback(capacity), _fsphase(capacity), _fsrate(capacity),
+    _frphase(capacity), _ctable(capacity), _wvalue(capacity), _cvalue(capacity)
+  {
+    _wrapCarrier();
+  }
+
+  template <typename T>
+  bool GrainPool<T>::add(double crate, double srate, T ampl, double front, double back, double phase)
+  {
+    if (_size == capacity())
+      return false;
+    double end = _carrierEnd();
+    front = front > 0 ? front : 0;
+    back = back >= 0 && back < end ? back : end;
+    // A grain that cycles over the whole of a periodic carrier has a period of size() (see Phasor)
+    if (front == 0 && back == end && _carrierPeriodic())
+      back = _carrierSize();
+    size_t i = _size++;
+    _cphase[i] = phase < front ? front : (phase > back ? back : phase);
+    _crate[i] = crate;
+    _front[i] = front;
+    _back[i] = back;
+    _sphase[i] = 0;
+    _srate[i] = srate;
+    _ampl[i] = ampl;
+    _clevel[i] = _mipmap.levels() ? _mipmap.levelFor(crate) : 0;
+    if (_fixed)
+      _storeFixed(i);
+    if (_window.size() > 0)
+      _window.start(_wstate[i], 0, srate);
+    if (_sine.size() > 0)
+      _startSine(i);
+    return true;
+  }
+
+  template <typename T>
+  T GrainPool<T>::value(void) const
+  {
+    if (_size == 0)
+      return 0;
+    if (_carrierStrided()) {
+      // Channel 0 of an interleaved carrier is read with its frames apart, so the shapes are computed first
+      const T* sdata = _shape.data();
+      for (size_t i=0; i<_size; i++)
+        _wvalue[i] = _window.size() > 0 ? _window.value(_wstate[i], _sphase[i]) : kernel::lookup(sdata, -1, _sphase[i]);
+      return sumStrided(_carrier.data(), _carrier.frameStride(), _carrierMask(), _carrier.getInterpType(),
+                        _cphase.data(), _wvalue.data(), _ampl.data(), _size);
+    }
+    if (_sine.size() > 0) {
+      const T* sdata = _shape.data();
+      for (size_t i=0; i<_size; i++) {
+        _cvalue[i] = _rim[i];
+        _wvalue[i] = _window.size() > 0 ? _window.value(_wstate[i], _sphase[i]) : kernel::lookup(sdata, -1, _sphase[i]);
+      }
+      return sumComputed(_cvalue.data(), _wvalue.data(), _ampl.data(), _size);
+    }
+    if (_window.size() > 0) {
+      for (size_t i=0; i<_size; i++)
+        _wvalue[i] = _window.value(_wstate[i], _sphase[i]);
+      if (_compact.size() > 0)
+        return sumWindowed(_compact.data(), _compact.format(), _carrierMask(), _cphase.data(), _wvalue.data(),
+                           _ampl.data(), _size);
+      for (size_t i=0; i<_size; i++)
+        _ctable[i] = _carrierTable(i).data();
+      return sumWindowed(_ctable.data(), _carrierMask(), _carrier.getInterpType(), _cphase.data(), _wvalue.data(),
+                         _ampl.data(), _size);
+    }
+    if (_compact.size() > 0)
+      return sumGrains(_compact.data(), _compact.format(), _carrierMask(), _cphase.data(), _shape.data(),
+                       _sphase.data(), _ampl.data(), _size);
+    for (size_t i=0; i<_size; i++)
+      _ctable[i] = _carrierTable(i).data();
+    return sumGrains(_ctable.data(), _carrierMask(), _carrier.getInterpType(), _cphase.data(), _shape.data(),
+                     _sphase.data(), _ampl.data(), _size);
+  }
+
+  template <typename T>
+  void GrainPool<T>::increment(void)
+  {
+    if (_size == 0)
+      return;
+    if (_fixed)
+      _advanceFixed();
+    else
+      advanceGrains(_cphase.data(), _crate.data(), _front.data(), _back.data(), _sphase.data(), _srate.data(), _size);
+    if (_window.size() > 0) {
+      for (size_t i=0; i<_size; i++)
+        _window.step(_wstate[i], _sphase[i], _srate[i]);
+    }
+    if (_sine.size() > 0) {
+      rotateGrains(_rre.data(), _rim.data(), _rdre.data(), _rdim.data(), _size);
+      // A rotator whose phase has been cycled (or which is due to be renormalized) is restarted at its new phase
+      for (size_t i=0; i<_size; i++) {
+        bool cycled = _fixed ? (_frphase[i] += _fcrate[i]) != _fcphase[i] : (_rphase[i] += _crate[i]) != _cphase[i];
+        if (--_rleft[i] == 0 || cycled)
+          _startSine(i);
+      }
+    }
+
+    // Remove the grains whose shapes have finished
+    double send = _shapeEnd();
+    size_t i = 0;
+    while (i < _size) {
+      if (_sphase[i] < 0 || _sphase[i] > send)
+        _remove(i);
+      else
+        i++;
+    }
+  }
+
+  template <typename T>
+  void GrainPool<T>::process(T* out, size_t frames, size_t channels, size_t stride)
+  {
+    size_t i = 0;
+    while (i < _size) {
+      if (_render(i, out, frames, channels, stride))
+        i++;
+      else
+        _remove(i);
+    }
+  }
+
+  template <typename T>
+  void GrainPool<T>::process(T* out, size_t frames, size_t channels, size_t stride, const GrainEvent<T>* events,
+                             size_t nevents)
+  {
+    process(out, frames, channels, stride);
+    for (size_t e=0; e<nevents; e++) {
+      const GrainEvent<T>& grain = events[e];
+      if (!add(grain))
+        continue;
+      if (!_render(_size-1, out + grain.offset, frames - grain.offset, channels, stride))
+        _remove(_size-1);
+    }
+  }
+
+  template <typename T>
+  bool GrainPool<T>::_render(size_t i, T* out, size_t frames, size_t channels, size_t stride)
+  {
+    // The mode is chosen once per grain, so that laying out the grain's phases doesn't check it on every frame
+    bool sine = _sine.size() > 0;
+    if (_fixed) {
+      return sine ? _renderWith<true, true>(i, out, frames, channels, stride)
+                  : _renderWith<true, false>(i, out, frames, channels, stride);
+    }
+    return sine ? _renderWith<false, true>(i, out, frames, channels, stride)
+                : _renderWith<false, false>(i, out, frames, channels, stride);
+  }
+
+  template <typename T>
+  template <bool FIXED, bool SINE>
+  bool GrainPool<T>::_renderWith(size_t i, T* out, size_t frames, size_t channels, size_t stride)
+  {
+    double cpos[POOL_CHUNK_SIZE];
+    double spos[POOL_CHUNK_SIZE];
+    T win[POOL_CHUNK_SIZE];
+    T cval[POOL_CHUNK_SIZE];
+    double cphase = _cphase[i];
+    double sphase = _sphase[i];
+    const double crate = _crate[i];
+    const double srate = _srate[i];
+    const double front = _front[i];
+    const double back = _back[i];
+    const double send = _shapeEnd();
+    const bool windowed = _window.size() > 0;
+    WindowState& wstate = _wstate[i];
+    double re = _rre[i], im = _rim[i], dre = _rdre[i], dim = _rdim[i];
+    size_t left = _rleft[i];
+    int64_t fcphase = _fcphase[i], fsphase = _fsphase[i];
+    const int64_t fcrate = _fcrate[i], fsrate = _fsrate[i], ffront = _ffront[i], fback = _fback[i];
+    const double sstep = FIXED ? fsrate/PHASE_ONE : srate;     // What the shape phase is actually advanced by
+    const long cmask = _carrierMask();
+    const InterpType cinterp = _carrier.getInterpType();
+    // Output channel c reads channel c % cchannels of the carrier, straight from the carrier's data
+    const Waveform<T>& ctable = _carrierTable(i);
+    const T* cdata = ctable.data();
+    const size_t cchannels = ctable.channels();
+    const size_t cchstride = ctable.channelStride();
+    const size_t cfstride = _carrierStrided() ? ctable.frameStride() : 1;
+    const uint16_t* cpacked = _compact.data();
+    const T* sdata = std::as_const(_shape).data();     // Reading through a const Waveform never copies the data
+    // A grain is finished once its shape phase leaves the shape. Until then, each chunk is as many frames as the shape
+    // phase can't leave it in, so that the frames don't need checking.
+    while (frames > 0 && sphase >= 0 && sphase <= send) {
+      size_t chunk = frames < POOL_CHUNK_SIZE ? frames : POOL_CHUNK_SIZE;
+      size_t n = kernel::safeSteps(sphase, sstep, 0, send, chunk - 1) + 1;
+
+      // Lay out the phases. The carrier phase is advanced without checks as long as it can't leave [front,back] (and a
+      // sine's rotator isn't due to be restarted), and only the frame after that is cycled. A rotator's phase only parts
+      // from its carrier phase on a frame where the carrier phase is cycled, which restarts it, so it isn't tracked here.
+      size_t k = 0;
+      while (k < n) {
+        size_t run = FIXED ? kernel::safeSteps(fcphase, fcrate, ffront, fback, n - k)
+                           : kernel::safeSteps(cphase, crate, front, back, n - k);
+        if constexpr (SINE) {
+          run = run < left - 1 ? run : left - 1;
+          left -= run;
+        }
+        for (size_t end = k + run; k < end; k++) {
+          cpos[k] = cphase;
+          spos[k] = sphase;
+          if constexpr (SINE) {
+            cval[k] = im;
+            kernel::rotate(re, im, dre, dim);
+          }
+          if constexpr (FIXED) {
+            fcphase += fcrate;
+            fsphase += fsrate;
+            cphase = (double)fcphase/PHASE_ONE;
+            sphase = (double)fsphase/PHASE_ONE;
+          }
+          else {
+            cphase += crate;
+            sphase += srate;
+          }
+        }
+        if (k == n)
+          break;
+        cpos[k] = cphase;
+        spos[k] = sphase;
+        bool cycled;
+        if constexpr (FIXED) {
+          int64_t next = fcphase + fcrate;
+          fcphase = kernel::cycleFixed(next, ffront, fback);
+          cycled = fcphase != next;
+          fsphase += fsrate;
+          cphase = (double)fcphase/PHASE_ONE;
+          sphase = (double)fsphase/PHASE_ONE;
+        }
+        else {
+          double next = cphase + crate;
+          cphase = kernel::cycle(next, front, back);
+          cycled = cphase != next;
+          sphase += srate;
+        }
+        if constexpr (SINE) {
+          cval[k] = im;
+          kernel::rotate(re, im, dre, dim);
+          if (--left == 0 || cycled) {
+            _sine.start(cphase, crate, re, im, dre, dim);
+            left = SINE_RESTART_FRAMES;
+          }
+        }
+        k++;
+      }
+
+      if (windowed) {
+        _window.fill(wstate, spos, sphase, srate, win, n);
+      }
+      else if (SINE || cfstride > 1) {
+        for (k=0; k<n; k++)
+          win[k] = kernel::lookup(sdata, -1, spos[k]);
+      }
+
+      // The phases and the shape are laid out once, and only the carrier is read for each output channel
+      for (size_t c=0; c<channels; c++) {
+        T* cout = out + c*stride;
+        const T* cchan = cdata + (c % cchannels)*cchstride;
+        if (SINE)
+          renderComputed(cout, cval, win, _ampl[i], n);
+        else if (cfstride > 1)
+          renderStrided(cout, cchan, cfstride, cmask, cinterp, cpos, win, _ampl[i], n);
+        else if (windowed && cpacked)
+          renderWindowed(cout, cpacked, _compact.format(), cmask, cpos, win, _ampl[i], n);
+        else if (windowed)
+          renderWindowed(cout, cchan, cmask, cinterp, cpos, win, _ampl[i], n);
+        else if (cpacked)
+          renderGrain(cout, cpacked, _compact.format(), cmask, cpos, sdata, spos, _ampl[i], n);
+        else
+          renderGrain(cout, cchan, cmask, cinterp, cpos, sdata, spos, _ampl[i], n);
+      }
+      out += n;
+      frames -= n;
+    }
+    _cphase[i] = cphase;
+    _sphase[i] = sphase;
+    if constexpr (FIXED) {
+      _fcphase[i] = fcphase;
+      _fsphase[i] = fsphase;
+    }
+    if constexpr (SINE) {
+      _rre[i] = re;
+      _rim[i] = im;
+      _rdre[i] = dre;
+      _rdim[i] = dim;
+      _rphase[i] = cphase;
+      _frphase[i] = fcphase;
+      _rleft[i] = left;
+    }
+    return sphase >= 0 && sphase <= send;
+  }
+
+  template <typename T>
+  void GrainPool<T>::setCarrier(const Waveform<T>& carrier)
+  {
+    size_t oldsize = _carrierSize();
+    _carrier = carrier;
+    _compact = CompactWaveform<T>();
+    _sine = SineCarrier();
+    _wrapCarrier();
+    _fitCarrier(oldsize);
+  }
+
+  template <typename T>
+  void GrainPool<T>::setCarrier(const CompactWaveform<T>& carrier)
+  {
+    size_t oldsize = _carrierSize();
+    _carrier = Waveform<T>();
+    _compact = carrier;
+    _sine = SineCarrier();
+    _fitCarrier(oldsize);
+  }
+
+  template <typename T>
+  void GrainPool<T>::setCarrier(const SineCarrier& carrier)
+  {
+    size_t oldsize = _carrierSize();
+    _carrier = Waveform<T>();
+    _compact = CompactWaveform<T>();
+    _sine = carrier;
+    _fitCarrier(oldsize);
+    for (size_t i=0; i<_size; i++)
+      _startSine(i);
+  }
+
+  template <typename T>
+  void GrainPool<T>::_fitCarrier(size_t oldsize)
+  {
+    if (_carrierSize() == oldsize)
+      return;
+    // The kernels don't check bounds, so every carrier phase must stay within the new carrier
+    double end = _carrierPeriodic() ? _carrierSize() : _carrierEnd();
+    for (size_t i=0; i<_size; i++) {
+      _front[i] = _front[i] < end ? _front[i] : end;
+      _back[i] = _back[i] < end ? _back[i] : end;
+      _cphase[i] = _cphase[i] < _front[i] ? _front[i] : (_cphase[i] > _back[i] ? _back[i] : _cphase[i]);
+      if (_fixed)
+        _storeFixed(i);
+    }
+  }
+
+  template <typename T>
+  void GrainPool<T>::setShape(const Waveform<T>& shape)
+  {
+    _shape = shape;
+    _window = GrainWindow();
+    _fitShape();
+  }
+
+  template <typename T>
+  void GrainPool<T>::setShape(const GrainWindow& window)
+  {
+    _shape = Waveform<T>();
+    _window = window;
+    _fitShape();
+  }
+
+  template <typename T>
+  void GrainPool<T>::_fitShape(void)
+  {
+    double send = _shapeEnd();
+    size_t i = 0;
+    while (i < _size) {
+      if (_sphase[i] > send) {
+        _remove(i);
+        continue;
+      }
+      if (_window.size() > 0)
+        _window.start(_wstate[i], _sphase[i], _srate[i]);
+      i++;
+    }
+  }
+
+  template <typename T>
+  void GrainPool<T>::_startSine(size_t i)
+  {
+    _sine.start(_cphase[i], _crate[i], _rre[i], _rim[i], _rdre[i], _rdim[i]);
+    _rphase[i] = _cphase[i];
+    _frphase[i] = _fcphase[i];
+    _rleft[i] = SINE_RESTART_FRAMES;
+  }
+
+  template <typename T>
+  void GrainPool<T>::setFixedPoint(bool fixed)
+  {
+    // The floating-point phases are kept up to date in fixed point, so switching back needs no conversion
+    if (fixed && !_fixed) {
+      for (size_t i=0; i<_size; i++)
+        _storeFixed(i);
+    }
+    _fixed = fixed;
+  }
+
+  template <typename T>
+  void GrainPool<T>::_storeFixed(size_t i)
+  {
+    _fcphase[i] = std::llround(_cphase[i]*PHASE_ONE);
+    _fcrate[i] = std::llround(_crate[i]*PHASE_ONE);
+    _ffront[i] = std::llround(_front[i]*PHASE_ONE);
+    _fback[i] = std::llround(_back[i]*PHASE_ONE);
+    _fsphase[i] = std::llround(_sphase[i]*PHASE_ONE);
+    _fsrate[i] = std::llround(_srate[i]*PHASE_ONE);
+    _frphase[i] = std::llround(_rphase[i]*PHASE_ONE);
+  }
+
+  template <typename T>
+  void GrainPool<T>::_advanceFixed(void)
+  {
+    for (size_t i=0; i<_size; i++) {
+      _fcphase[i] = kernel::cycleFixed(_fcphase[i] + _fcrate[i], _ffront[i], _fback[i]);
+      _fsphase[i] += _fsrate[i];
+      _cphase[i] = (double)_fcphase[i]/PHASE_ONE;
+      _sphase[i] = (double)_fsphase[i]/PHASE_ONE;
+    }
+  }
+
+  template <typename T>
+  void GrainPool<T>::_wrapCarrier(void)
+  {
+    if (_carrier.powerOfTwo() && _carrier.guard() != Guard::WRAPPED)
+      _carrier.setGuard(Guard::WRAPPED);
+  }
+
+  template <typename T>
+  const Waveform<T>& GrainPool<T>::_carrierTable(size_t i) const
+  {
+    if (_mipmap.levels() == 0)
+      return _carrier;
+    // The Wavetable may have been replaced by one with fewer levels since the grain started
+    size_t lvl = _clevel[i] < _mipmap.levels() ? _clevel[i] : _mipmap.levels() - 1;
+    return _mipmap.level(lvl);
+  }
+
+  template <typename T>
+  void GrainPool<T>::_remove(size_t i)
+  {
+    size_t last = --_size;
+    _cphase[i] = _cphase[last];
+    _crate[i] = _crate[last];
+    _front[i] = _front[last];
+    _back[i] = _back[last];
+    _sphase[i] = _sphase[last];
+    _srate[i] = _srate[last];
+    _ampl[i] = _ampl[last];
+    _clevel[i] = _clevel[last];
+    _wstate[i] = _wstate[last];
+    _rre[i] = _rre[last];
+    _rim[i] = _rim[last];
+    _rdre[i] = _rdre[last];
+    _rdim[i] = _rdim[last];
+    _rphase[i] = _rphase[last];
+    _rleft[i] = _rleft[last];
+    _fcphase[i] = _fcphase[last];
+    _fcrate[i] = _fcrate[last];
+    _ffront[i] = _ffront[last];
+    _fback[i] = _fback[last];
+    _fsphase[i] = _fsphase[last];
+    _fsrate[i] = _fsrate[last];
+    _frphase[i] = _frphase[last];
+  }
+
+  template class GrainPool<double>;
+  template class GrainPool<float>;
+
+}  // audioelectric
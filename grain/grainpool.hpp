@@ -0,0 +1,345 @@
+/* \file grainpool.hpp
+ * \brief Defines the GrainPool class
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "compact.hpp"
+#include "grainwindow.hpp"
+#include "sinecarrier.hpp"
+#include "waveform.hpp"
+#include "wavetable.hpp"
+
+#define DEFAULT_GRAIN_CAPACITY 256
+
+namespace audioelectric {
+
+  /*!\brief Describes a grain that starts partway through a block
+   */
+  template <typename T>
+  struct GrainEvent {
+    size_t offset;      //!< The frame of the block on which the grain starts
+    double crate;       //!< The carrier rate
+    double srate;       //!< The shape rate
+    T ampl;             //!< The amplitude of the grain
+    double front;       //!< The front phase of the carrier
+    double back;        //!< The back phase of the carrier
+    double phase = -1;  //!< The carrier phase to start at (negative to start at the front, see GrainPool::add())
+  };
+
+  /*!\brief A fixed-capacity set of active grains
+   *
+   * The pool plays the same role as a list of Grain objects, but the state of each grain is split into contiguous arrays
+   * (one per parameter) so that iterating over the grains walks linearly through memory. Every grain in the pool shares
+   * the same carrier and shape waveforms. A carrier behaves like a cycling Phasor over [front,back] (including the
+   * periodic case of a power-of-two carrier) and a shape behaves like a non-cycling Phasor over the whole shape
+   * waveform. A grain is finished as soon as its shape phase leaves the shape waveform, at which point it is removed by
+   * swapping the last grain into its place.
+   *
+   * If the pool is given a band-limited Wavetable of the carrier (see setMipmap()), each grain reads its carrier from the
+   * Wavetable level that suits its carrier rate, so fast grains don't alias.
+   *
+   * The carriers are interpolated with the carrier waveform's interpolation type (see Waveform::setInterpType()), and
+   * the shape is always interpolated linearly.
+   *
+   * The carrier may instead be a CompactWaveform, whose 16-bit samples are converted as the grains read them. A compact
+   * carrier is always interpolated linearly, and the grains read it directly rather than from a Wavetable.
+   *
+   * The carrier may also be a SineCarrier, which each grain computes as it plays with a rotator (see setCarrier()).
+   * Its rotators are kept in their own arrays, so that moving the grains along a frame rotates them together.
+   *
+   * The shape may instead be a GrainWindow, which each grain computes as it plays (see setShape()), so that rendering a
+   * grain reads only its carrier.
+   *
+   * The phases may also be kept in fixed point (see setFixedPoint()), so that long grains advance exactly rather than
+   * accumulating rounding errors.
+   *
+   * A multi-channel carrier is read in place, whatever its layout. value() and the single-channel process() play its
+   * channel 0, and the multi-channel process() plays each of its channels to a separate output. The channels of a
+   * planar carrier are each contiguous, so they're read by the same kernels as a single-channel carrier. The frames of
+   * an interleaved carrier's channels aren't, so those are read one lookup at a time (see renderStrided()).
+   */
+  template <typename T>
+  class GrainPool final {
+  public:
+
+    /*!
+     * \param carrier  The carrier waveform
+     * \param shape    The shape waveform
+     * \param capacity The maximum number of grains that may be active at once
+     */
+    GrainPool(const Waveform<T>& carrier, const Waveform<T>& shape, size_t capacity=DEFAULT_GRAIN_CAPACITY);
+
+    /*!\brief Returns true if there are any active grains
+     */
+    operator bool(void) const {return _size > 0;}
+
+    /*!\brief Returns the number of active grains
+     */
+    size_t size(void) const {return _size;}
+
+    /*!\brief Returns the maximum number of active grains
+     */
+    size_t capacity(void) const {return _ampl.size();}
+
+    /*!\brief Starts a new grain
+     *
+     * \param crate The carrier rate
+     * \param srate The shape rate
+     * \param ampl  The amplitude of the grain
+     * \param front The front phase of the carrier
+     * \param back  The back phase of the carrier. A negative value sets the back at the end of the carrier
+     * \param phase The carrier phase to start at, which is clamped to [front,back]. A negative value starts at the front.
+     *              Grains that read a LiveWaveform start partway through it (see LiveWaveform::phase())
+     * \return False if the pool was full and the grain was not started
+     */
+    bool add(double crate, double srate, T ampl, double front=0, double back=-1, double phase=-1);
+
+    /*!\brief Starts a new grain from an event (the offset is ignored)
+     */
+    bool add(const GrainEvent<T>& grain)
+    {
+      return add(grain.crate, grain.srate, grain.ampl, grain.front, grain.back, grain.phase);
+    }
+
+    /*!\brief Returns the sum of all of the active grains (on channel 0 of the carrier)
+     */
+    T value(void) const;
+
+    /*!\brief Increments all of the active grains and removes those that have finished
+     */
+    void increment(void);
+
+    /*!\brief Adds the next frames values of the active grains to out
+     *
+     * This is the block equivalent of calling value() and increment() for each frame. Rather than visiting every grain on
+     * every frame, each grain is rendered over its whole span of the block before moving on to the next one.
+     */
+    void process(T* out, size_t frames) {process(out, frames, 1, 0);}
+
+    /*!\brief Adds the next frames values of the active grains to a set of output channels
+     *
+     * The outputs are planar: output channel c starts at out + c*stride, and gets channel c % channels() of the carrier.
+     * Each grain's phases and shape are worked out once for all of the outputs.
+     *
+     * \param out      The first output channel
+     * \param frames   The number of frames to generate
+     * \param channels The number of output channels
+     * \param stride   The distance between the output channels (at least frames, unless there's one channel)
+     */
+    void process(T* out, size_t frames, size_t channels, size_t stride);
+
+    /*!\brief Adds the next frames values of the active grains to out, starting new grains partway through the block
+     *
+     * The active grains are rendered first, and then each event's grain is added to the pool and rendered from its offset
+     * to the end of the block.
+     *
+     * \param out     The buffer to add the grains to
+     * \param frames  The number of frames to generate
+     * \param events  The grains that start during this block. Their offsets must be <= frames
+     * \param nevents The number of events
+     */
+    void process(T* out, size_t frames, const GrainEvent<T>* events, size_t nevents)
+    {
+      process(out, frames, 1, 0, events, nevents);
+    }
+
+    void process(T* out, size_t frames, const std::vector<GrainEvent<T>>& events)
+    {
+      process(out, frames, events.data(), events.size());
+    }
+
+    /*!\brief Adds the next frames values of the active grains to a set of output channels, starting new grains partway
+     *        through the block (see the two process() functions above)
+     */
+    void process(T* out, size_t frames, size_t channels, size_t stride, const GrainEvent<T>* events, size_t nevents);
+
+    /*!\brief Removes all of the active grains
+     */
+    void clear(void) {_size = 0;}
+
+    /*!\brief Sets the carrier waveform
+     *
+     * The active grains switch to the new carrier. If it isn't the same size as the old one, their carrier phases are
+     * clamped to it. The pool shares the carrier's data, whatever its channels and layout.
+     */
+    void setCarrier(const Waveform<T>& carrier);
+
+    /*!\brief Sets a carrier of 16-bit samples, in place of the carrier waveform
+     *
+     * The active grains switch to the new carrier just as they do in setCarrier().
+     */
+    void setCarrier(const CompactWaveform<T>& carrier);
+
+    /*!\brief Sets a computed sine carrier, in place of the carrier waveform
+     *
+     * The active grains switch to the new carrier just as they do in setCarrier(), and their rotators are started at
+     * their carrier phases. A sine is periodic, so grains that cycle over the whole of it have a period of its size().
+     */
+    void setCarrier(const SineCarrier& carrier);
+
+    /*!\brief Sets the shape waveform
+     *
+     * The active grains switch to the new shape, and any that are already past its end are removed.
+     */
+    void setShape(const Waveform<T>& shape);
+
+    /*!\brief Sets a computed window in place of the shape waveform
+     *
+     * The active grains switch to the new window just as they do in setShape().
+     */
+    void setShape(const GrainWindow& window);
+
+    /*!\brief Sets a band-limited Wavetable for grains to read their carriers from
+     *
+     * Each new grain picks its level with Wavetable::levelFor() on its carrier rate. Level 0 of the Wavetable must be the
+     * same size as the carrier waveform.
+     *
+     * \param mipmap The Wavetable, or an empty Wavetable to read straight from the carrier waveform
+     */
+    void setMipmap(const Wavetable<T>& mipmap) {_mipmap = mipmap;}
+
+    /*!\brief Sets whether the grains keep their carrier and shape phases in fixed point
+     *
+     * Fixed-point phases, rates, fronts and backs are 32.32 numbers, as in Phasor::setFixedPoint(). Each grain advances
+     * and cycles its phases with integer adds and compares, and the kernels read the carrier and shape at those phases
+     * converted back to samples, so a grain's phases never drift from front + n*rate. The active grains switch over at
+     * their current phases.
+     */
+    void setFixedPoint(bool fixed);
+
+    /*!\brief Returns true if the grains keep their phases in fixed point
+     */
+    bool fixedPoint(void) const {return _fixed;}
+
+  private:
+
+    Waveform<T> _carrier;               //!< The carrier waveform (empty if the carrier is compact)
+    CompactWaveform<T> _compact;        //!< The compact carrier (empty unless the carrier is compact)
+    SineCarrier _sine;                  //!< The sine carrier (empty unless the carrier is a sine)
+    Waveform<T> _shape;                 //!< The shape waveform (empty if the shape is a window)
+    GrainWindow _window;                //!< The shape window (empty unless the shape is a window)
+    Wavetable<T> _mipmap;               //!< The band-limited carrier (empty if there isn't one)
+    size_t _size;                       //!< The number of active grains
+    bool _fixed;                        //!< Whether the phases are kept in fixed point
+
+    std::vector<double> _cphase;        //!< The carrier phases
+    std::vector<double> _crate;         //!< The carrier rates
+    std::vector<double> _front;         //!< The carrier front phases
+    std::vector<double> _back;          //!< The carrier back phases
+    std::vector<double> _sphase;        //!< The shape phases
+    std::vector<double> _srate;         //!< The shape rates
+    std::vector<T> _ampl;               //!< The amplitudes
+    std::vector<size_t> _clevel;        //!< The Wavetable levels of the carriers
+    std::vector<WindowState> _wstate;   //!< The states of the shape windows (unused unless the shape is a window)
+    std::vector<double> _rre;           //!< The cosines of the sine carriers' angles (unused unless the carrier is a sine)
+    std::vector<double> _rim;           //!< The sines of the sine carriers' angles (the carriers' values)
+    std::vector<double> _rdre;          //!< The cosines of the sine carriers' steps
+    std::vector<double> _rdim;          //!< The sines of the sine carriers' steps
+    std::vector<double> _rphase;        //!< The carrier phases that the rotators have been moved to
+    std::vector<size_t> _rleft;         //!< The number of steps left before each rotator is restarted
+    std::vector<int64_t> _fcphase;      //!< The carrier phases in fixed point (unused unless the phases are fixed point)
+    std::vector<int64_t> _fcrate;       //!< The carrier rates in fixed point
+    std::vector<int64_t> _ffront;       //!< The carrier front phases in fixed point
+    std::vector<int64_t> _fback;        //!< The carrier back phases in fixed point
+    std::vector<int64_t> _fsphase;      //!< The shape phases in fixed point
+    std::vector<int64_t> _fsrate;       //!< The shape rates in fixed point
+    std::vector<int64_t> _frphase;      //!< The carrier phases that the rotators have been moved to, in fixed point
+    mutable std::vector<const T*> _ctable;      //!< Scratch space for the carrier data of each grain in value()
+    mutable std::vector<T> _wvalue;             //!< Scratch space for the window of each grain in value()
+    mutable std::vector<T> _cvalue;             //!< Scratch space for the sine carrier of each grain in value()
+
+    /*!\brief Renders the grain at index i over a span of frames of each output channel (see process())
+     *
+     * \return True if the grain is still running at the end of the span
+     */
+    bool _render(size_t i, T* out, size_t frames, size_t channels, size_t stride);
+
+    /*!\brief _render() for grains whose phases are (or aren't) fixed point, and whose carrier is (or isn't) a sine
+     */
+    template <bool FIXED, bool SINE>
+    bool _renderWith(size_t i, T* out, size_t frames, size_t channels, size_t stride);
+
+    /*!\brief Returns the index mask to use for the carrier lookups
+     *
+     * Power-of-two carriers are periodic, so their grains may play up to size() and wrap back to the first sample.
+     */
+    long _carrierMask(void) const {return _carrierPowerOfTwo() ? _carrierSize() - 1 : -1;}
+
+    /*!\brief Returns the size of whichever carrier is set
+     */
+    size_t _carrierSize(void) const
+    {
+      return _sine.size() > 0 ? _sine.size() : (_compact.size() > 0 ? _compact.size() : _carrier.size());
+    }
+
+    /*!\brief Returns the end position of whichever carrier is set
+     */
+    double _carrierEnd(void) const
+    {
+      return _sine.size() > 0 ? _sine.end() : (_compact.size() > 0 ? _compact.end() : _carrier.end());
+    }
+
+    /*!\brief Returns true if whichever carrier is set is a power of two
+     */
+    bool _carrierPowerOfTwo(void) const {return _compact.size() > 0 ? _compact.powerOfTwo() : _carrier.powerOfTwo();}
+
+    /*!\brief Returns true if whichever carrier is set cycles with a period of its size (a sine, or a power of two)
+     */
+    bool _carrierPeriodic(void) const {return _sine.size() > 0 || _carrierPowerOfTwo();}
+
+    /*!\brief Returns true if the grains read an interleaved multi-channel carrier, whose frames aren't next to each other
+     */
+    bool _carrierStrided(void) const
+    {
+      return _sine.size() == 0 && _compact.size() == 0 && _mipmap.levels() == 0 && _carrier.frameStride() > 1;
+    }
+
+    /*!\brief Starts the rotator of the grain at index i at its carrier phase
+     */
+    void _startSine(size_t i);
+
+    /*!\brief Converts the phases, rates, front and back of the grain at index i to fixed point
+     */
+    void _storeFixed(size_t i);
+
+    /*!\brief Increments the fixed-point phases of every grain, and brings their floating-point phases up to date
+     */
+    void _advanceFixed(void);
+
+    /*!\brief Returns the end position of whichever shape is set
+     */
+    double _shapeEnd(void) const {return _window.size() > 0 ? _window.end() : _shape.end();}
+
+    /*!\brief Removes the grains that are past the end of the shape, and starts the windows of the others
+     */
+    void _fitShape(void);
+
+    /*!\brief Clamps the carrier phases of the active grains to a new carrier, if its size has changed
+     */
+    void _fitCarrier(size_t oldsize);
+
+    /*!\brief Makes the guards of a periodic carrier wrap, since the lookups read past its end without masking
+     */
+    void _wrapCarrier(void);
+
+    /*!\brief Returns the carrier waveform that the grain at index i reads from (the carrier, or a level of the Wavetable)
+     */
+    const Waveform<T>& _carrierTable(size_t i) const;
+
+    /*!\brief Removes the grain at index i by moving the last grain into its place
+     */
+    void _remove(size_t i);
+
+  };
+
+}  // audioelectric
@@ -0,0 +1,179 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include "grainrandom.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace audioelectric {
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+  void Philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4])
+  {
+    uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int r=0; r<PHILOX_ROUNDS; r++) {
+      uint64_t p0 = (uint64_t)PHILOX_M0*c0;
+      uint64_t p1 = (uint64_t)PHILOX_M1*c2;
+      uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+      uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+      c1 = (uint32_t)p1;
+      c3 = (uint32_t)p0;
+      c0 = n0;
+      c2 = n2;
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+  }
+
+#if defined(__AVX2__)
+
+  /*!\brief Multiplies eight words by a constant, returning the high and low words of the products
+   */
+  static inline void mulhilo8(__m256i a, __m256i m, __m256i& hi, __m256i& lo)
+  {
+    __m256i even = _mm256_mul_epu32(a, m);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    lo = _mm256_unpacklo_epi32(_mm256_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                               _mm256_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    hi = _mm256_unpacklo_epi32(_mm256_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 3, 1)),
+                               _mm256_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 3, 1)));
+  }
+
+#endif
+
+#if defined(__SSE2__)
+
+  /*!\brief Multiplies four words by a constant, returning the high and low words of the products
+   */
+  static inline void mulhilo4(__m128i a, __m128i m, __m128i& hi, __m128i& lo)
+  {
+    __m128i even = _mm_mul_epu32(a, m);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+    lo = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    hi = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 3, 1)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 3, 1)));
+  }
+
+#endif
+
+  void PhiloxBlocks(const uint32_t key[2], uint64_t first, uint64_t stream, uint32_t* out, size_t n)
+  {
+    size_t i = 0;
+#if defined(__AVX2__)
+    // Each lane runs its own counter, and the two halves of a register hold two groups of four counters
+    const __m256i m0 = _mm256_set1_epi32(PHILOX_M0);
+    const __m256i m1 = _mm256_set1_epi32(PHILOX_M1);
+    for (; i + 8 <= n; i += 8) {
+      alignas(32) uint32_t lo[8], hi[8];
+      for (int j=0; j<8; j++) {
+        uint64_t c = first + i + j;
+        lo[j] = (uint32_t)c;
+        hi[j] = (uint32_t)(c >> 32);
+      }
+      __m256i c0 = _mm256_load_si256((const __m256i*)lo);
+      __m256i c1 = _mm256_load_si256((const __m256i*)hi);
+      __m256i c2 = _mm256_set1_epi32((uint32_t)stream);
+      __m256i c3 = _mm256_set1_epi32((uint32_t)(stream >> 32));
+      uint32_t k0 = key[0], k1 = key[1];
+      for (int r=0; r<PHILOX_ROUNDS; r++) {
+        __m256i hi0, lo0, hi1, lo1;
+        mulhilo8(c0, m0, hi0, lo0);
+        mulhilo8(c2, m1, hi1, lo1);
+        c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32(k0));
+        c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32(k1));
+        c1 = lo1;
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+      }
+      uint32_t* g = out + 4*i;
+      __m256i words[4] = {c0, c1, c2, c3};
+      for (int w=0; w<4; w++) {
+        _mm_storeu_si128((__m128i*)(g + 4*w), _mm256_castsi256_si128(words[w]));
+        _mm_storeu_si128((__m128i*)(g + 16 + 4*w), _mm256_extracti128_si256(words[w], 1));
+      }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i m0s = _mm_set1_epi32(PHILOX_M0);
+    const __m128i m1s = _mm_set1_epi32(PHILOX_M1);
+    for (; i + 4 <= n; i += 4) {
+      uint64_t c[4] = {first + i, first + i + 1, first + i + 2, first + i + 3};
+      __m128i c0 = _mm_setr_epi32((uint32_t)c[0], (uint32_t)c[1], (uint32_t)c[2], (uint32_t)c[3]);
+      __m128i c1 = _mm_setr_epi32(c[0] >> 32, c[1] >> 32, c[2] >> 32, c[3] >> 32);
+      __m128i c2 = _mm_set1_epi32((uint32_t)stream);
+      __m128i c3 = _mm_set1_epi32((uint32_t)(stream >> 32));
+      uint32_t k0 = key[0], k1 = key[1];
+      for (int r=0; r<PHILOX_ROUNDS; r++) {
+        __m128i hi0, lo0, hi1, lo1;
+        mulhilo4(c0, m0s, hi0, lo0);
+        mulhilo4(c2, m1s, hi1, lo1);
+        c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32(k0));
+        c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32(k1));
+        c1 = lo1;
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+      }
+      uint32_t* g = out + 4*i;
+      _mm_storeu_si128((__m128i*)g, c0);
+      _mm_storeu_si128((__m128i*)(g + 4), c1);
+      _mm_storeu_si128((__m128i*)(g + 8), c2);
+      _mm_storeu_si128((__m128i*)(g + 12), c3);
+    }
+#endif
+    for (; i<n; i++) {
+      uint64_t c = first + i;
+      uint32_t ctr[4] = {(uint32_t)c, (uint32_t)(c >> 32), (uint32_t)stream, (uint32_t)(stream >> 32)};
+      uint32_t block[4];
+      Philox4x32(ctr, key, block);
+      uint32_t* g = out + 16*(i/4) + i%4;
+      for (int w=0; w<4; w++)
+        g[4*w] = block[w];
+    }
+  }
+
+  template <typename T>
+  void GrainRandom<T>::seed(uint64_t seed, uint64_t stream)
+  {
+    _key[0] = (uint32_t)seed;
+    _key[1] = (uint32_t)(seed >> 32);
+    _stream = stream;
+    _counter = 0;
+    _next = RANDOM_BATCH;
+  }
+
+  template <typename T>
+  void GrainRandom<T>::_refill(void)
+  {
+    uint32_t bits[RANDOM_BATCH];
+    PhiloxBlocks(_key, _counter, _stream, bits, RANDOM_BATCH/4);
+    _counter += RANDOM_BATCH/4;
+    // Each word is read as a signed fraction, which puts the values on [-1,1)
+    for (size_t i=0; i<RANDOM_BATCH; i++)
+      _values[i] = (T)((int32_t)bits[i]*(1./2147483648.));
+    _next = 0;
+  }
+
+  template class GrainRandom<double>;
+  template class GrainRandom<float>;
+
+}  // audioelectric
@@ -0,0 +1,87 @@
+/* \file grainrandom.hpp
+ * \brief Defines the GrainRandom class and the Philox generator behind it
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*!\brief The number of random values that GrainRandom generates at once (a multiple of 16)
+ */
+#define RANDOM_BATCH 64
+
+namespace audioelectric {
+
+  /*!\brief Computes one block of the Philox4x32-10 counter-based generator
+   *
+   * \param ctr The 128-bit counter
+   * \param key The 64-bit key
+   * \param out Set to the 128 random bits of the block
+   */
+  void Philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]);
+
+  /*!\brief Computes the Philox blocks of consecutive counters
+   *
+   * Counter i is {first + i, stream} (as 64-bit halves). The words are laid out in groups of four counters: word w of
+   * counter 4g+j is written to out[16*g + 4*w + j], which lets the SIMD versions store whole registers. Every version
+   * gives the same bits.
+   *
+   * \param key    The 64-bit key
+   * \param first  The first counter
+   * \param stream The upper half of every counter
+   * \param out    Set to 4*n random words
+   * \param n      The number of counters (a multiple of 4)
+   */
+  void PhiloxBlocks(const uint32_t key[2], uint64_t first, uint64_t stream, uint32_t* out, size_t n);
+
+  /*!\brief A fast, seedable source of uniform random values for the grain parameters
+   *
+   * The values come from the Philox4x32-10 counter-based generator, RANDOM_BATCH at a time (see PhiloxBlocks()), and are
+   * handed out one by one from the batch. The sequence depends only on the seed and the stream, so generators that are
+   * seeded alike draw the same values, and generators with different streams draw independent ones.
+   */
+  template <typename T>
+  class GrainRandom final {
+  public:
+
+    /*!
+     * \param seed   The seed (the generator's key)
+     * \param stream The stream to draw from
+     */
+    GrainRandom(uint64_t seed=0, uint64_t stream=0) {this->seed(seed, stream);}
+
+    /*!\brief Restarts the generator at the beginning of a stream
+     */
+    void seed(uint64_t seed, uint64_t stream=0);
+
+    /*!\brief Returns the next value, uniformly distributed on [-1,1]
+     */
+    T operator()(void)
+    {
+      if (_next == RANDOM_BATCH)
+        _refill();
+      return _values[_next++];
+    }
+
+  private:
+
+    uint32_t _key[2];
+    uint64_t _stream;
+    uint64_t _counter;          //!< The counter of the next batch
+    size_t _next;               //!< The index of the next value in the batch
+    T _values[RANDOM_BATCH];
+
+    /*!\brief Generates the next batch of values
+     */
+    void _refill(void);
+
+  };
+
+}  // audioelectric
@@ -0,0 +1,102 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include <cmath>
+
+#include "grainwindow.hpp"
+#include "waveform.hpp"
+
+namespace audioelectric {
+
+  #define PI M_PI
+
+  GrainWindow::GrainWindow(WindowType type, size_t len, double param) :
+    _type(type), _size(len), _param(param), _scale(1./(len - 1.)), _k0(0), _k1(0), _k2(0), _k3(0)
+  {
+    if (len < 2)
+      throw WaveformError("A grain window must stand in for at least 2 samples");
+    switch (type) {
+    case WindowType::GAUSSIAN:
+      if (!(param > 0))
+        throw WaveformError("The width of a Gaussian window must be positive");
+      _k0 = exp(-0.125/(param*param));
+      _k1 = 1./(1. - _k0);
+      break;
+    case WindowType::HANN:
+      break;
+    case WindowType::TUKEY:
+      if (!(param > 0 && param <= 1))
+        throw WaveformError("The tapers of a Tukey window must take up a fraction of it in (0,1]");
+      _k0 = param/2;
+      _k1 = 1 - param/2;
+      _k2 = cos(2*PI/param);
+      _k3 = sin(2*PI/param);
+      break;
+    case WindowType::TRAPEZOID:
+      if (!(param > 0 && param <= 0.5))
+        throw WaveformError("The ramps of a trapezoid window must each take up a fraction of it in (0,0.5]");
+      _k0 = param;
+      _k1 = 1 - param;
+      _k2 = 1/param;
+      break;
+    }
+  }
+
+  double GrainWindow::operator()(double phase) const
+  {
+    double x = phase*_scale;
+    switch (_type) {
+    case WindowType::GAUSSIAN:
+      return (exp(-(x - 0.5)*(x - 0.5)/(2*_param*_param)) - _k0)*_k1;
+    case WindowType::HANN:
+      return 0.5 - 0.5*cos(2*PI*x);
+    case WindowType::TUKEY:
+      if (x < _k0)
+        return 0.5 - 0.5*cos(2*PI*x/_param);
+      if (x > _k1)
+        return 0.5 - 0.5*cos(2*PI*(1 - x)/_param);
+      return 1;
+    case WindowType::TRAPEZOID:
+      if (x < _k0)
+        return x*_k2;
+      if (x > _k1)
+        return (1 - x)*_k2;
+      return 1;
+    }
+    return 0;
+  }
+
+  void GrainWindow::start(WindowState& state, double phase, double rate) const
+  {
+    double x = phase*_scale;
+    double dx = rate*_scale;
+    state = {0, 0, 0, 0, WINDOW_RESTART_FRAMES};
+    switch (_type) {
+    case WindowType::GAUSSIAN: {
+      double h = 1/(2*_param*_param);
+      double u = x - 0.5;
+      state.a = exp(-u*u*h);
+      state.b = exp(-(2*u*dx + dx*dx)*h);
+      state.c = exp(-2*dx*dx*h);
+      break;
+    }
+    case WindowType::HANN:
+    case WindowType::TUKEY: {
+      double w = _type == WindowType::HANN ? 2*PI : 2*PI/_param;
+      state.a = cos(w*x);
+      state.b = sin(w*x);
+      state.c = cos(w*dx);
+      state.d = sin(w*dx);
+      break;
+    }
+    case WindowType::TRAPEZOID:
+      break;
+    }
+  }
+
+}  // audioelectric
@@ -0,0 +1,304 @@
+/* \file grainwindow.hpp
+ * \brief Defines the GrainWindow class
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#define WINDOW_RESTART_FRAMES 1024
+
+namespace audioelectric {
+
+  /*!\brief The windows that a GrainWindow computes
+   */
+  enum class WindowType {
+    GAUSSIAN,           //!< A Gaussian with a width (sigma) of param, offset and scaled to go from 0 to 1 and back
+    HANN,               //!< A raised cosine (param is unused)
+    TUKEY,              //!< Raised cosine tapers that together take up a fraction param of the window, with 1 between
+    TRAPEZOID,          //!< Linear ramps that each take up a fraction param of the window, with 1 between
+  };
+
+  /*!\brief The running state of one grain's window (see GrainWindow)
+   */
+  struct WindowState {
+    double a;   //!< GAUSSIAN: the window before the offset. HANN and TUKEY: the cosine of the taper's angle
+    double b;   //!< GAUSSIAN: the ratio to the next value of a. HANN and TUKEY: the sine of the taper's angle
+    double c;   //!< GAUSSIAN: the ratio to the next value of b. HANN and TUKEY: the cosine of the angle's step
+    double d;   //!< HANN and TUKEY: the sine of the angle's step
+    size_t left;        //!< The number of steps left before the state is restarted
+  };
+
+  /*!\brief A grain shape that is computed as the grains play rather than read from a table
+   *
+   * A GrainWindow stands in for a shape Waveform of size() samples: a grain's shape phase goes from 0 to end() just as
+   * it would over the Waveform, but the window is computed at each phase instead of being interpolated from a table, so
+   * rendering a grain reads nothing but its carrier. Each grain keeps a WindowState, which start() sets up for its phase
+   * and rate and step() moves along to the next frame, so that the window is computed with a handful of multiplies per
+   * frame (a running product for GAUSSIAN, and a rotating phasor for HANN and TUKEY) rather than with exp() or cos().
+   *
+   * The recurrences are kept in double precision, and step() restarts them from the exact window every
+   * WINDOW_RESTART_FRAMES frames, so they never drift from it by more than a small fraction of a float's resolution.
+   */
+  class GrainWindow final {
+  public:
+
+    /*!\brief Creates an empty window, which stands for no window at all
+     */
+    GrainWindow(void) : _type(WindowType::HANN), _size(0), _param(0), _scale(0), _k0(0), _k1(0), _k2(0), _k3(0) {}
+
+    /*!
+     * \param type  The window
+     * \param len   The size of the shape Waveform that the window stands in for (at least 2)
+     * \param param The parameter of the window (see WindowType). A GAUSSIAN's must be positive, a TUKEY's must be in
+     *              (0,1] and a TRAPEZOID's must be in (0,0.5]
+     * \throw WaveformError if len or param is out of range
+     */
+    GrainWindow(WindowType type, size_t len, double param=0);
+
+    /*!\brief Returns the window
+     */
+    WindowType type(void) const {return _type;}
+
+    /*!\brief Returns the parameter of the window
+     */
+    double param(void) const {return _param;}
+
+    /*!\brief Returns the size of the Waveform that the window stands in for, or 0 if it's empty
+     */
+    size_t size(void) const {return _size;}
+
+    /*!\brief Returns the last shape phase of a grain
+     */
+    double end(void) const {return _size - 1.;}
+
+    /*!\brief Returns the window at a shape phase, computed directly
+     */
+    double operator()(double phase) const;
+
+    /*!\brief Sets up the state of a grain at a shape phase
+     *
+     * \param state The grain's state
+     * \param phase The grain's shape phase
+     * \param rate  The grain's shape rate
+     */
+    void start(WindowState& state, double phase, double rate) const;
+
+    /*!\brief Returns the window of a grain
+     *
+     * \param state The grain's state
+     * \param phase The grain's shape phase (which must be the phase that its state has been moved to)
+     */
+    inline double value(const WindowState& state, double phase) const;
+
+    /*!\brief Moves the state of a grain along to its next frame
+     *
+     * \param state The grain's state
+     * \param phase The grain's shape phase on the next frame
+     * \param rate  The grain's shape rate
+     */
+    inline void step(WindowState& state, double phase, double rate) const;
+
+    /*!\brief Writes the window of a grain over a run of frames, moving its state along after each one
+     *
+     * This is the block equivalent of calling value() followed by step() for each frame. The window is chosen once for
+     * the run rather than on every frame, and a TUKEY or TRAPEZOID window finds where the run crosses between its
+     * tapers (or ramps) and its top up front, rather than comparing every phase.
+     *
+     * \param state The grain's state
+     * \param phase The grain's shape phases over the run (the phases of a grain only ever move one way)
+     * \param next  The grain's shape phase on the frame after the run
+     * \param rate  The grain's shape rate
+     * \param out   The buffer to write the window to
+     * \param n     The number of frames in the run
+     */
+    template <typename T>
+    void fill(WindowState& state, const double* phase, double next, double rate, T* out, size_t n) const;
+
+  private:
+
+    WindowType _type;
+    size_t _size;
+    double _param;
+    double _scale;      //!< Converts a shape phase to a position in [0,1]
+    double _k0;         //!< GAUSSIAN: the offset. TUKEY and TRAPEZOID: the end of the first taper or ramp
+    double _k1;         //!< GAUSSIAN: the scale. TUKEY and TRAPEZOID: the start of the last taper or ramp
+    double _k2;         //!< TUKEY: the cosine of the angle at the end of the window. TRAPEZOID: the slope of the ramps
+    double _k3;         //!< TUKEY: the sine of the angle at the end of the window
+
+    /*!\brief fill() for one window
+     */
+    template <WindowType W, typename T>
+    void _fill(WindowState& state, const double* phase, double next, double rate, T* out, size_t n) const;
+
+    /*!\brief Writes the window over n frames in which the state isn't due to be restarted, moving the state along
+     */
+    template <WindowType W, typename T>
+    inline void _fillRun(WindowState& state, const double* phase, double rate, T* out, size_t n) const;
+
+  };
+
+  inline double GrainWindow::value(const WindowState& state, double phase) const
+  {
+    double x = phase*_scale;
+    switch (_type) {
+    case WindowType::GAUSSIAN:
+      return (state.a - _k0)*_k1;
+    case WindowType::HANN:
+      return 0.5 - 0.5*state.a;
+    case WindowType::TUKEY:
+      if (x < _k0)
+        return 0.5 - 0.5*state.a;
+      if (x > _k1)      // The last taper is the first one played backwards from the end of the window
+        return 0.5 - 0.5*(_k2*state.a + _k3*state.b);
+      return 1;
+    case WindowType::TRAPEZOID:
+      if (x < _k0)
+        return x*_k2;
+      if (x > _k1)
+        return (1 - x)*_k2;
+      return 1;
+    }
+    return 0;
+  }
+
+  inline void GrainWindow::step(WindowState& state, double phase, double rate) const
+  {
+    if (--state.left == 0) {
+      start(state, phase, rate);
+      return;
+    }
+    switch (_type) {
+    case WindowType::GAUSSIAN:
+      state.a *= state.b;
+      state.b *= state.c;
+      break;
+    case WindowType::HANN:
+    case WindowType::TUKEY: {
+      double a = state.a*state.c - state.b*state.d;
+      state.b = state.b*state.c + state.a*state.d;
+      state.a = a;
+      break;
+    }
+    case WindowType::TRAPEZOID:
+      break;
+    }
+  }
+
+  template <typename T>
+  void GrainWindow::fill(WindowState& state, const double* phase, double next, double rate, T* out, size_t n) const
+  {
+    switch (_type) {
+    case WindowType::GAUSSIAN:
+      _fill<WindowType::GAUSSIAN>(state, phase, next, rate, out, n);
+      break;
+    case WindowType::HANN:
+      _fill<WindowType::HANN>(state, phase, next, rate, out, n);
+      break;
+    case WindowType::TUKEY:
+      _fill<WindowType::TUKEY>(state, phase, next, rate, out, n);
+      break;
+    case WindowType::TRAPEZOID:
+      _fill<WindowType::TRAPEZOID>(state, phase, next, rate, out, n);
+      break;
+    }
+  }
+
+  template <WindowType W, typename T>
+  void GrainWindow::_fill(WindowState& state, const double* phase, double next, double rate, T* out, size_t n) const
+  {
+    size_t k = 0;
+    while (k < n) {
+      // The recurrence runs unchecked up to the frame that restarts it, and that frame is stepped on its own
+      size_t run = n - k < state.left - 1 ? n - k : state.left - 1;
+      _fillRun<W>(state, phase + k, rate, out + k, run);
+      state.left -= run;
+      k += run;
+      if (k < n) {
+        out[k] = value(state, phase[k]);
+        step(state, k + 1 < n ? phase[k + 1] : next, rate);
+        k++;
+      }
+    }
+  }
+
+  template <WindowType W, typename T>
+  inline void GrainWindow::_fillRun(WindowState& state, const double* phase, double rate, T* out, size_t n) const
+  {
+    auto rotate = [&state](void) {
+      double a = state.a*state.c - state.b*state.d;
+      state.b = state.b*state.c + state.a*state.d;
+      state.a = a;
+    };
+    if constexpr (W == WindowType::GAUSSIAN) {
+      for (size_t k=0; k<n; k++) {
+        out[k] = (state.a - _k0)*_k1;
+        state.a *= state.b;
+        state.b *= state.c;
+      }
+    }
+    else if constexpr (W == WindowType::HANN) {
+      for (size_t k=0; k<n; k++) {
+        out[k] = 0.5 - 0.5*state.a;
+        rotate();
+      }
+    }
+    else {
+      // The window over each region of the run, which are the first taper (or ramp), the top and the last one
+      auto first = [&](size_t from, size_t to) {
+        for (size_t k=from; k<to; k++) {
+          if constexpr (W == WindowType::TUKEY) {
+            out[k] = 0.5 - 0.5*state.a;
+            rotate();
+          }
+          else {
+            out[k] = phase[k]*_scale*_k2;
+          }
+        }
+      };
+      auto top = [&](size_t from, size_t to) {
+        for (size_t k=from; k<to; k++) {
+          out[k] = 1;
+          if constexpr (W == WindowType::TUKEY)
+            rotate();
+        }
+      };
+      auto last = [&](size_t from, size_t to) {
+        for (size_t k=from; k<to; k++) {
+          if constexpr (W == WindowType::TUKEY) {
+            out[k] = 0.5 - 0.5*(_k2*state.a + _k3*state.b);
+            rotate();
+          }
+          else {
+            out[k] = (1 - phase[k]*_scale)*_k2;
+          }
+        }
+      };
+      // The phases only move one way, so the run crosses each boundary between the regions at most once
+      auto inFirst = [this](double p) {return p*_scale < _k0;};
+      auto inLast = [this](double p) {return p*_scale > _k1;};
+      if (rate >= 0) {
+        size_t a = std::partition_point(phase, phase + n, inFirst) - phase;
+        size_t b = std::partition_point(phase + a, phase + n, [&](double p) {return !inLast(p);}) - phase;
+        first(0, a);
+        top(a, b);
+        last(b, n);
+      }
+      else {
+        size_t a = std::partition_point(phase, phase + n, inLast) - phase;
+        size_t b = std::partition_point(phase + a, phase + n, [&](double p) {return !inFirst(p);}) - phase;
+        last(0, a);
+        top(a, b);
+        first(b, n);
+      }
+    }
+  }
+
+}  // audioelectric
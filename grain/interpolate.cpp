@@ -0,0 +1,69 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include <cmath>
+
+#include "interpolate.hpp"
+
+namespace audioelectric {
+
+  namespace kernel {
+
+    #define PI M_PI
+    #define SINC_BETA 7.0       //!< The Kaiser window's beta, which trades the main lobe's width for sidelobe rejection
+
+    /*!\brief The zeroth-order modified Bessel function of the first kind, from its power series
+     */
+    static double bessel0(double x)
+    {
+      double sum = 1, term = 1;
+      for (int k=1; k<32; k++) {
+        term *= (x/(2*k))*(x/(2*k));
+        sum += term;
+      }
+      return sum;
+    }
+
+    double kaiser(double r, double beta)
+    {
+      return r*r < 1 ? bessel0(beta*sqrt(1 - r*r))/bessel0(beta) : 0;
+    }
+
+    template <typename T>
+    const SincTable<T>& SincTable<T>::instance(void)
+    {
+      static const SincTable<T> table;
+      return table;
+    }
+
+    template <typename T>
+    SincTable<T>::SincTable(void)
+    {
+      const double half = SINC_TAPS/2;
+      for (size_t j=0; j<=SINC_PHASES; j++) {
+        double frac = (double)j/SINC_PHASES;
+        double coefs[SINC_TAPS];
+        double sum = 0;
+        for (size_t k=0; k<SINC_TAPS; k++) {
+          // Tap k reads the sample k-3 frames from the frame, which is k-3-frac samples from the position
+          double x = (double)k - 3 - frac;
+          double s = x == 0 ? 1 : sin(PI*x)/(PI*x);
+          coefs[k] = s*kaiser(x/half, SINC_BETA);
+          sum += coefs[k];
+        }
+        for (size_t k=0; k<SINC_TAPS; k++)
+          _coefs[j*SINC_TAPS + k] = coefs[k]/sum;
+      }
+    }
+
+    template class SincTable<double>;
+    template class SincTable<float>;
+
+  }  // kernel
+
+}  // audioelectric
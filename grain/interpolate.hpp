@@ -0,0 +1,188 @@
+/* \file interpolate.hpp
+ * \brief Defines the interpolation types and the kernels that interpolate between the samples of a Waveform
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ *
+ * Every kernel reads a fixed number of neighbouring samples around the frame it's given and never checks bounds, so it
+ * relies on the guard frames that surround a Waveform's data (see WAVEFORM_GUARD). The samples of a frame are stride
+ * samples apart, which lets the same kernels read mono, planar and interleaved data. The SIMD version of sinc() sums its
+ * taps in the same order as the scalar version, so the two return bit-identical results.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define SINC_TAPS 8             //!< The number of samples that the windowed-sinc kernel reads
+#define SINC_PHASES 256         //!< The number of fractional positions that the sinc coefficients are computed for
+
+namespace audioelectric {
+
+  /*!\brief Different types of interpolation
+   */
+  enum class InterpType {
+    LINEAR,     //!< Linear interpolation between the two nearest samples
+    CUBIC,      //!< Cubic Hermite (Catmull-Rom) interpolation of the four nearest samples
+    SINC,       //!< Kaiser-windowed sinc interpolation of the SINC_TAPS nearest samples
+  };
+
+  namespace kernel {
+
+    /*!\brief Returns the Kaiser window at a position r in [-1,1] (it's 0 outside of that)
+     *
+     * \param r    The position, relative to the half-width of the window
+     * \param beta The shape of the window. Larger values reject more of the sidelobes, at the cost of a wider main lobe
+     */
+    double kaiser(double r, double beta);
+
+    /*!\brief The polyphase coefficients of the windowed-sinc kernel
+     *
+     * Row j holds the SINC_TAPS coefficients for a fractional position of j/SINC_PHASES, applied to the samples from 3
+     * before the frame to 4 after it. There is one more row than there are phases, so that a position between two rows
+     * can always blend a row with the next one. Each row is normalized to a gain of 1 at DC.
+     */
+    template <typename T>
+    class SincTable final {
+    public:
+
+      /*!\brief Returns the table, which is computed the first time it's needed
+       */
+      static const SincTable& instance(void);
+
+      /*!\brief Returns the coefficients of a row
+       */
+      const T* row(size_t j) const {return _coefs + j*SINC_TAPS;}
+
+    private:
+
+      alignas(32) T _coefs[(SINC_PHASES + 1)*SINC_TAPS];
+
+      SincTable(void);
+
+    };
+
+    /*!\brief Linear interpolation between a sample and the next one
+     */
+    template <typename T, typename W>
+    inline T linear(const T* d, long stride, W diff)
+    {
+      T a = d[0];
+      T b = d[stride];
+      return (b-a)*diff + a;
+    }
+
+    /*!\brief Catmull-Rom interpolation between a sample and the next one, using the samples on either side of them
+     */
+    template <typename T, typename W>
+    inline T hermite(const T* d, long stride, W diff)
+    {
+      T xm1 = d[-stride];
+      T x0 = d[0];
+      T x1 = d[stride];
+      T x2 = d[2*stride];
+      T c1 = T(0.5)*(x1 - xm1);
+      T c2 = xm1 - T(2.5)*x0 + T(2)*x1 - T(0.5)*x2;
+      T c3 = T(0.5)*(x2 - xm1) + T(1.5)*(x0 - x1);
+      return ((c3*diff + c2)*diff + c1)*diff + x0;
+    }
+
+    /*!\brief Windowed-sinc interpolation, one tap at a time
+     *
+     * The coefficients for the position are blended from the two nearest rows of the SincTable, and the products are
+     * summed pairwise: tap k with tap k+4 first, then those sums two apart, then the last two.
+     */
+    template <typename T, typename W>
+    inline T sincScalar(const T* d, long stride, W diff)
+    {
+      double pos = diff*SINC_PHASES;
+      size_t j = pos;
+      T w = pos - j;
+      const T* c0 = SincTable<T>::instance().row(j);
+      const T* c1 = c0 + SINC_TAPS;
+      const T* x = d - 3*stride;
+      T p[SINC_TAPS];
+      for (size_t k=0; k<SINC_TAPS; k++)
+        p[k] = x[k*stride] * (c0[k] + (c1[k]-c0[k])*w);
+      T s0 = p[0] + p[4];
+      T s1 = p[1] + p[5];
+      T s2 = p[2] + p[6];
+      T s3 = p[3] + p[7];
+      s0 += s2;
+      s1 += s3;
+      return s0 + s1;
+    }
+
+    /*!\brief Windowed-sinc interpolation between a sample and the next one
+     */
+    template <typename T, typename W>
+    inline T sinc(const T* d, long stride, W diff)
+    {
+      return sincScalar(d, stride, diff);
+    }
+
+#if defined(__SSE2__)
+
+    /*!\brief Windowed-sinc interpolation of float data, with the taps in two SSE registers
+     */
+    template <typename W>
+    inline float sinc(const float* d, long stride, W diff)
+    {
+      double pos = diff*SINC_PHASES;
+      size_t j = pos;
+      __m128 w = _mm_set1_ps(pos - j);
+      const float* c0 = SincTable<float>::instance().row(j);
+      const float* c1 = c0 + SINC_TAPS;
+      const float* x = d - 3*stride;
+      __m128 xlo, xhi;
+      if (stride == 1) {
+        xlo = _mm_loadu_ps(x);
+        xhi = _mm_loadu_ps(x + 4);
+      }
+      else {
+        xlo = _mm_setr_ps(x[0], x[stride], x[2*stride], x[3*stride]);
+        xhi = _mm_setr_ps(x[4*stride], x[5*stride], x[6*stride], x[7*stride]);
+      }
+      __m128 clo = _mm_load_ps(c0);
+      __m128 chi = _mm_load_ps(c0 + 4);
+      clo = _mm_add_ps(clo, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(c1), clo), w));
+      chi = _mm_add_ps(chi, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(c1 + 4), chi), w));
+      __m128 s = _mm_add_ps(_mm_mul_ps(xlo, clo), _mm_mul_ps(xhi, chi));
+      s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+      s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+      return _mm_cvtss_f32(s);
+    }
+
+#endif
+
+    /*!\brief Interpolates between a sample and the next one with an interpolation type
+     *
+     * \param d      The sample at the integer part of the position
+     * \param stride The distance between consecutive frames of the data
+     * \param diff   The fractional part of the position, in [0,1)
+     * \param it     The interpolation type
+     */
+    template <typename T, typename W>
+    inline T interpolate(const T* d, long stride, W diff, InterpType it)
+    {
+      switch (it) {
+      case InterpType::CUBIC:
+        return hermite(d, stride, diff);
+      case InterpType::SINC:
+        return sinc(d, stride, diff);
+      default:
+        return linear(d, stride, diff);
+      }
+    }
+
+  }  // kernel
+
+}  // audioelectric
@@ -0,0 +1,68 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include <cstring>
+
+#include "livewaveform.hpp"
+
+namespace audioelectric {
+
+  /*!\brief Returns the smallest power of two that is at least len and WAVEFORM_GUARD
+   */
+  static size_t roundCapacity(size_t len)
+  {
+    size_t cap = WAVEFORM_GUARD;
+    while (cap < len)
+      cap <<= 1;
+    return cap;
+  }
+
+  template <typename T>
+  LiveWaveform<T>::LiveWaveform(size_t capacity, T sr) :
+    _buffer(roundCapacity(capacity), sr), _mask(roundCapacity(capacity) - 1), _written(0)
+  {
+    _buffer.setGuard(Guard::WRAPPED);
+    _data = _buffer.data();
+  }
+
+  template <typename T>
+  void LiveWaveform<T>::write(const T* in, size_t frames)
+  {
+    const size_t cap = _mask + 1;
+    uint64_t head = _written.load(std::memory_order_relaxed);
+    if (frames > cap) {
+      in += frames - cap;
+      head += frames - cap;
+      frames = cap;
+    }
+    size_t start = head & _mask;
+    size_t first = frames < cap - start ? frames : cap - start;
+    memcpy(_data + start, in, first*sizeof(T));
+    memcpy(_data, in + first, (frames - first)*sizeof(T));
+    // Keep the wrapped guards in step with the frames that they copy
+    for (size_t k=0; k<WAVEFORM_GUARD; k++) {
+      if (((k - start) & _mask) < frames)
+        _data[cap + k] = _data[k];
+      size_t end = cap - WAVEFORM_GUARD + k;
+      if (((end - start) & _mask) < frames)
+        _data[(long)k - WAVEFORM_GUARD] = _data[end];
+    }
+    _written.store(head + frames, std::memory_order_release);
+  }
+
+  template <typename T>
+  double LiveWaveform<T>::phase(double delay) const
+  {
+    double pos = (double)(written() & _mask) - delay;
+    return pos < 0 ? pos + (_mask + 1) : pos;
+  }
+
+  template class LiveWaveform<double>;
+  template class LiveWaveform<float>;
+
+}  // audioelectric
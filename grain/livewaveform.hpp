@@ -0,0 +1,101 @@
+/* \file livewaveform.hpp
+ * \brief Defines the LiveWaveform class
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "waveform.hpp"
+
+namespace audioelectric {
+
+  /*!\brief A circular Waveform that one thread records into while any number of others read from it
+   *
+   * The data is a power-of-two Waveform with wrapped guards, so Phasors and grains cycle over it with a bitmask just as
+   * they do over any other periodic Waveform (see Waveform::cyclic()), and copies of it (see waveform()) share the data
+   * that's being recorded rather than copying it. A single writer (typically the audio input callback) appends frames at
+   * the write head with write(), which never blocks and never allocates, and publishes them by advancing the head
+   * atomically. Readers never lock either: they find the part of the buffer they want relative to the write head with
+   * phase(), and read it through their own copy of the Waveform.
+   *
+   * Nothing stops the writer from overwriting frames that are being read, so readers must keep to the frames that the
+   * writer won't reach while they read them. A frame d frames behind the head (its delay) is safe as long as d is at
+   * least the number of frames that the interpolation reads past a position (1 for LINEAR, 2 for CUBIC, 4 for SINC) and
+   * d plus the number of frames written before the read is over (a block or two, for grains) stays within the capacity
+   * minus the 3 frames that interpolation reads before a position. A grain that plays faster than 1 catches up with the
+   * head, and a slower one falls behind, so the grain's length and rate decide which delays it can start at.
+   *
+   * Only one channel is recorded. A multi-channel input can be recorded into one LiveWaveform per channel.
+   */
+  template <typename T>
+  class LiveWaveform final {
+  public:
+
+    /*!\brief Creates a silent buffer
+     *
+     * \param capacity The number of frames to keep. It's rounded up to a power of two (of at least WAVEFORM_GUARD)
+     * \param sr       The sample rate of the recording
+     */
+    LiveWaveform(size_t capacity, T sr=0);
+
+    LiveWaveform(const LiveWaveform&) = delete;
+    LiveWaveform& operator=(const LiveWaveform&) = delete;
+
+    /*!\brief Returns the number of frames that the buffer keeps
+     */
+    size_t capacity(void) const {return _mask + 1;}
+
+    /*!\brief Appends frames at the write head
+     *
+     * Only one thread may write. If more than capacity() frames are written at once, only the last capacity() are kept.
+     *
+     * \param in     The frames to record
+     * \param frames The number of frames
+     */
+    void write(const T* in, size_t frames);
+
+    /*!\brief Returns the number of frames that have been written since the buffer was created
+     *
+     * The write head is at written() modulo capacity(), and every frame before it has been published to the thread
+     * that calls this.
+     */
+    uint64_t written(void) const {return _written.load(std::memory_order_acquire);}
+
+    /*!\brief Returns the phase of the buffer that is a number of frames behind the write head
+     *
+     * \param delay The number of frames behind the write head, in [0,capacity()]
+     * \return The phase, in [0,capacity())
+     */
+    double phase(double delay) const;
+
+    /*!\brief Returns the interpolated value a number of frames behind the write head
+     *
+     * \param delay The number of frames behind the write head (see the class description for the safe delays)
+     */
+    T read(double delay) const {return _buffer.cyclic(phase(delay));}
+
+    /*!\brief Returns the buffer, to be read by Phasors and grains
+     *
+     * Copies of the buffer keep seeing what's recorded into it as long as nothing writes to them, since writing to a
+     * Waveform gives it its own copy of the data.
+     */
+    const Waveform<T>& waveform(void) const {return _buffer;}
+
+  private:
+
+    Waveform<T> _buffer;                //!< The recording
+    T* _data;                           //!< The data of the recording, which the writer writes to directly
+    size_t _mask;                       //!< capacity()-1
+    std::atomic<uint64_t> _written;     //!< The number of frames written, which is the write head before the modulo
+
+  };
+
+}  // audioelectric
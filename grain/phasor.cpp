@@ -7,38 +7,135 @@ namespace audioelectric {
 
   template<typename T>
   Phasor<T>::Phasor(const Waveform<T>& wf, double rate, bool cycle, double start, double front, double back) :
-    // Remove the const so we can copy the reference. This is a little dangerous, but the phasor does not change the Waveform
-    _wf(const_cast<Waveform<T>&>(wf)), _cycle(cycle)
+    _cycle(cycle), _wf(wf), _mipmap(nullptr), _table(&_wf), _mask(0), _fixed(false), _frame(wf.channels())
   {
     setParameters(rate, start, front, back);
   }
 
+  template<typename T>
+  Phasor<T>::Phasor(const Wavetable<T>& wt, double rate, bool cycle, double start, double front, double back) :
+    Phasor(wt.level(0), rate, cycle, start, front, back)
+  {
+    _mipmap = &wt;
+    _selectLevel();
+  }
+
   template<typename T>
   Phasor<T>::Phasor(const Phasor& other) :
-    _wf(other._wf), _phase(other._phase), _rate(other._rate), _front(other._front), _cycle(other._cycle), _back(other._back)
+    _rate(other._rate), _phase(other._phase), _front(other._front), _back(other._back), _cycle(other._cycle),
+    _wf(other._wf), _mipmap(other._mipmap), _table(other._table == &other._wf ? &_wf : other._table), _mask(other._mask),
+    _fixed(other._fixed), _fphase(other._fphase), _frate(other._frate), _ffront(other._ffront), _fback(other._fback),
+    _frame(other._frame)
   {
-    _phase_good = _checkPhase(_phase);
+    // _phase is stale in a fixed-point Phasor, so it can't be checked here
+    _phase_good = other._phase_good;
   }
 
   template<typename T>
   T Phasor<T>::value(void) const
   {
-    if (_phase_good)
-      return _wf.waveform(_phase);
-    return 0;
+    if (_fixed) {
+      if (!_mask && !_phase_good)
+        return 0;
+      T frac = (T)(_fphase & PHASE_FRAC_MASK) * (T)(1./PHASE_ONE);
+      return _table->interpFixed((long)(_fphase >> PHASE_FRAC_BITS), frac, _mask ? _mask : -1);
+    }
+    if (_mask)
+      return _table->cyclic(_phase);
+    // The phase is kept within [front,back] while it's good, so there's no need for waveform()'s bounds check
+    return _phase_good ? _table->interp(_phase) : 0;
   }
 
   template<typename T>
   bool Phasor<T>::generate(T **outputs, int frames, int chans)
   {
+    // The scratch frame is sized whenever the waveform is set, so generating never allocates
+    size_t wfchans = _table->channels();
     for (int frame=0; frame<frames; frame++) {
+      _table->frame(getPhase(), _frame.data());
       for (int chan=0; chan<chans; chan++)
-        outputs[chan][frame] = _wf.waveform(_phase,chan);
+        outputs[chan][frame] = _frame[chan % wfchans];
       this->increment();
     }
     return *this;
   }
 
+  template<typename T>
+  void Phasor<T>::process(T* out, size_t frames)
+  {
+    if (_fixed)
+      _processFixed(out, frames);
+    else if (_mask)
+      _processPeriodic(out, frames);
+    else
+      _processBounded(out, frames);
+  }
+
+  template<typename T>
+  void Phasor<T>::_processFixed(T* out, size_t frames)
+  {
+    const Waveform<T>& table = *_table;
+    if (_mask) {
+      // A periodic phase wraps with its mask, so it never needs checking
+      int64_t wrap = (int64_t(_mask + 1) << PHASE_FRAC_BITS) - 1;
+      for (size_t i=0; i<frames; i++) {
+        T frac = (T)(_fphase & PHASE_FRAC_MASK) * (T)(1./PHASE_ONE);
+        out[i] = table.interpFixed((long)(_fphase >> PHASE_FRAC_BITS), frac, _mask);
+        _fphase = (_fphase + _frate) & wrap;
+      }
+      return;
+    }
+    size_t i = 0;
+    while (i < frames) {
+      size_t run = _phase_good ? kernel::safeSteps(_fphase, _frate, _ffront, _fback, frames - i) : 0;
+      for (size_t end = i + run; i < end; i++) {
+        T frac = (T)(_fphase & PHASE_FRAC_MASK) * (T)(1./PHASE_ONE);
+        out[i] = table.interpFixed((long)(_fphase >> PHASE_FRAC_BITS), frac);
+        _fphase += _frate;
+      }
+      if (i < frames) {
+        out[i++] = value();
+        _incrementFixed();
+      }
+    }
+  }
+
+  template<typename T>
+  void Phasor<T>::_processPeriodic(T* out, size_t frames)
+  {
+    const Waveform<T>& table = *_table;
+    size_t i = 0;
+    while (i < frames) {
+      size_t run = kernel::safeSteps(_phase, _rate, 0., (double)(_mask + 1), frames - i);
+      for (size_t end = i + run; i < end; i++) {
+        out[i] = table.cyclic(_phase);
+        _phase += _rate;
+      }
+      if (i < frames) {
+        out[i++] = table.cyclic(_phase);
+        increment();
+      }
+    }
+  }
+
+  template<typename T>
+  void Phasor<T>::_processBounded(T* out, size_t frames)
+  {
+    const Waveform<T>& table = *_table;
+    size_t i = 0;
+    while (i < frames) {
+      size_t run = _phase_good ? kernel::safeSteps(_phase, _rate, _front, _back, frames - i) : 0;
+      for (size_t end = i + run; i < end; i++) {
+        out[i] = table.interp(_phase);
+        _phase += _rate;
+      }
+      if (i < frames) {
+        out[i++] = value();
+        increment();
+      }
+    }
+  }
+
   template<typename T>
   Phasor<T>::operator bool(void) const
   {
@@ -48,6 +145,15 @@ namespace audioelectric {
   template<typename T>
   void Phasor<T>::increment(void)
   {
+    if (_fixed) {
+      _incrementFixed();
+      return;
+    }
+    if (_mask) {
+      _phase += _rate;
+      _wrapPhase();
+      return;
+    }
     double nextphase = _phase+_rate;
     bool good = _checkPhase(nextphase);
     if (_cycle && !good) {
@@ -65,10 +171,34 @@ namespace audioelectric {
 
   }
 
+  template <typename T>
+  void Phasor<T>::_incrementFixed(void)
+  {
+    int64_t nextphase = _fphase + _frate;
+    if (_mask) {
+      // Two's complement makes the mask wrap negative phases as well
+      _fphase = nextphase & ((int64_t(_mask + 1) << PHASE_FRAC_BITS) - 1);
+      return;
+    }
+    bool good = nextphase <= _fback && nextphase >= _ffront;
+    if (_cycle && !good) {
+      if (_frate > 0)
+        _fphase = (nextphase - _ffront) % (_fback - _ffront) + _ffront;
+      else
+        _fphase = _fback - (_fback - nextphase) % (_fback - _ffront);
+      _phase_good = true;
+    }
+    else {
+      _fphase = nextphase;
+      _phase_good = good;
+    }
+  }
+
   template <typename T>
   void Phasor<T>::reset(void)
   {
     _phase = _front;
+    _fphase = _ffront;
     _phase_good = true;
   }
 
@@ -76,7 +206,7 @@ namespace audioelectric {
   template<typename T>
   bool Phasor<T>::operator==(const Phasor& other) const
   {
-    return _phase==other._phase;
+    return getPhase() == other.getPhase();
   }
 
   template<typename T>
@@ -88,25 +218,25 @@ namespace audioelectric {
   template<typename T>
   bool Phasor<T>::operator<(const Phasor& other) const
   {
-    return _phase < other._phase;
+    return getPhase() < other.getPhase();
   }
 
   template<typename T>
   bool Phasor<T>::operator>(const Phasor& other) const
   {
-    return _phase > other._phase;
+    return getPhase() > other.getPhase();
   }
 
   template<typename T>
   bool Phasor<T>::operator<=(const Phasor& other) const
   {
-    return _phase <= other._phase;
+    return getPhase() <= other.getPhase();
   }
 
   template<typename T>
   bool Phasor<T>::operator>=(const Phasor& other) const
   {
-    return _phase >= other._phase;
+    return getPhase() >= other.getPhase();
   }
 
   template <typename T>
@@ -114,24 +244,33 @@ namespace audioelectric {
   {
     _rate = rate;
     _phase = phase;
+    _fphase = std::llround(phase*PHASE_ONE);
     setFront(front);
     setBack(back);
     // if (!_phase_good)   // _phase_good was checked by setBack()
     //   _phase = _front;
     _phase_good = true;
+    _updateMask();
+    _storeFixed();
+    _selectLevel();
   }
   
   template<typename T>
   void Phasor<T>::setRate(double rate)
   {
     _rate = rate;
+    _frate = std::llround(rate*PHASE_ONE);
+    _selectLevel();
   }
 
   template<typename T>
   void Phasor<T>::setFront(double front)
   {
+    _loadFixed();
     _front = front > 0 ? front : 0;
     _phase_good = _checkPhase(_phase);
+    _updateMask();
+    _storeFixed();
   }
 
   template<typename T>
@@ -139,22 +278,50 @@ namespace audioelectric {
   {
     _phase = phase;
     _phase_good = _checkPhase(_phase);
+    _wrapPhase();
+    _storeFixed();
   }
 
   template<typename T>
   void Phasor<T>::setBack(double back)
   {
+    _loadFixed();
     if (back>=0)
       _back = back < _wf.end() ? back : _wf.end();
     else
       _back = (double)(_wf.end());
     _phase_good = _checkPhase(_phase);
+    _updateMask();
+    _storeFixed();
   }
 
   template <typename T>
   void Phasor<T>::setCycle(bool cycle)
   {
+    _loadFixed();
     _cycle = cycle;
+    _updateMask();
+    _storeFixed();
+  }
+
+  template <typename T>
+  void Phasor<T>::setWaveform(const Waveform<T>& wf)
+  {
+    _wf = wf;
+    _mipmap = nullptr;
+    _table = &_wf;
+    _frame.resize(wf.channels());
+    _loadFixed();
+    _updateMask();
+    _storeFixed();
+  }
+
+  template <typename T>
+  void Phasor<T>::setFixedPoint(bool fixed)
+  {
+    _loadFixed();
+    _fixed = fixed;
+    _storeFixed();
   }
 
   template<typename T>
@@ -164,8 +331,20 @@ namespace audioelectric {
       return *this;
     _rate = other._rate;
     _phase = other._phase;
+    _front = other._front;
+    _back = other._back;
+    _cycle = other._cycle;
     _wf = other._wf;
+    _mipmap = other._mipmap;
+    _table = other._table == &other._wf ? &_wf : other._table;
     _phase_good = other._phase_good;
+    _mask = other._mask;
+    _fixed = other._fixed;
+    _fphase = other._fphase;
+    _frate = other._frate;
+    _ffront = other._ffront;
+    _fback = other._fback;
+    _frame = other._frame;
     return *this;
   }
 
@@ -175,6 +354,59 @@ namespace audioelectric {
     return phase <= _back && phase>=_front;
   }
 
+  template <typename T>
+  void Phasor<T>::_updateMask(void)
+  {
+    if (_cycle && _front == 0 && _back == _wf.end() && _wf.powerOfTwo()) {
+      _mask = _wf.size() - 1;
+      // Periodic reads interpolate into the guards past the end, so they must wrap. Generated cycles and Wavetable levels
+      // already do, so this rarely copies anything.
+      if (_wf.guard() != Guard::WRAPPED)
+        _wf.setGuard(Guard::WRAPPED);
+      _wrapPhase();
+    }
+    else {
+      _mask = 0;
+    }
+  }
+
+  template <typename T>
+  void Phasor<T>::_wrapPhase(void)
+  {
+    if (!_mask)
+      return;
+    if (_phase < 0 || _phase >= _mask + 1) {
+      double whole = floor(_phase);
+      _phase = (double)((long)whole & _mask) + (_phase - whole);
+    }
+    _phase_good = true;
+  }
+
+  template <typename T>
+  void Phasor<T>::_selectLevel(void)
+  {
+    if (_mipmap)
+      _table = &_mipmap->level(_mipmap->levelFor(_rate));
+  }
+
+  template <typename T>
+  void Phasor<T>::_loadFixed(void)
+  {
+    if (_fixed)
+      _phase = (double)_fphase/PHASE_ONE;
+  }
+
+  template <typename T>
+  void Phasor<T>::_storeFixed(void)
+  {
+    if (!_fixed)
+      return;
+    _fphase = std::llround(_phase*PHASE_ONE);
+    _frate = std::llround(_rate*PHASE_ONE);
+    _ffront = std::llround(_front*PHASE_ONE);
+    _fback = std::llround(_back*PHASE_ONE);
+  }
+
   template class Phasor<double>;
   template class Phasor<float>;
 
@@ -1,10 +1,49 @@
 
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include "waveform.hpp"
+#include "wavetable.hpp"
+
+#define PHASE_FRAC_BITS 32                                          //!< Fractional bits of a fixed-point phase
+#define PHASE_FRAC_MASK ((int64_t(1) << PHASE_FRAC_BITS) - 1)       //!< Masks the fraction of a fixed-point phase
+#define PHASE_ONE ((double)(int64_t(1) << PHASE_FRAC_BITS))         //!< One sample in fixed-point units
 
 namespace audioelectric {
 
+  namespace kernel {
+
+    /*!\brief Returns how many times a phase can be advanced by a rate without leaving [lo,hi], up to most
+     *
+     * Block readers advance a phase that many times without checking it, and check it again on the next advance. The
+     * count is one short, so that the rounding of a phase that is advanced by repeated adds can't carry it past a bound.
+     */
+    inline size_t safeSteps(double phase, double rate, double lo, double hi, size_t most)
+    {
+      if (rate == 0)
+        return phase >= lo && phase <= hi ? most : 0;
+      double steps = (rate > 0 ? (hi - phase)/rate : (phase - lo)/-rate) - 1;
+      return steps >= most ? most : (steps > 0 ? (size_t)steps : 0);
+    }
+
+    /*!\brief Returns how many times a fixed-point phase can be advanced by a rate without leaving [lo,hi], up to most
+     *
+     * Fixed-point phases are advanced exactly, so the count is exact.
+     */
+    inline size_t safeSteps(int64_t phase, int64_t rate, int64_t lo, int64_t hi, size_t most)
+    {
+      if (phase < lo || phase > hi)
+        return 0;
+      if (rate == 0)
+        return most;
+      uint64_t steps = rate > 0 ? (hi - phase)/rate : (phase - lo)/-rate;
+      return steps >= most ? most : steps;
+    }
+
+  }  // kernel
+
   /*!\brief An iterator-like class that increments the phase of the waveform at a certain rate
    * 
    * The Phasor provides access to interpolated, modulated, or otherwise mathematically complex Waveforms with a simple,
@@ -39,17 +78,49 @@ namespace audioelectric {
      *              set to front.
      * \param front The front phase in the Wavetable. Values before this in the wavetable will not be played.
      * \param back  The back phase in the Wavetable. A negative value sets the back at the last sample of the waveform.
+     *
+     * If the waveform's size is a power of two and the Phasor cycles over the whole waveform, the waveform is treated as
+     * one period of a periodic signal (see Waveform::cyclic()), and the Phasor's copy of it gets wrapped guards.
      */
     Phasor(const Waveform<T>& wf, double rate, bool cycle=false, double start=0, double front=0, double back=-1);
 
+    /*!\brief Constructs a Phasor over a band-limited Wavetable
+     *
+     * The Phasor reads from the Wavetable level that has no harmonics above Nyquist at its rate, and it changes levels
+     * whenever the rate is changed. The phase, front and back are the same as for a Phasor over wt.level(0). The
+     * Wavetable must outlive the Phasor.
+     */
+    Phasor(const Wavetable<T>& wt, double rate, bool cycle=false, double start=0, double front=0, double back=-1);
+
     Phasor(const Phasor& other);
 
     /*!\brief Returns the value of the Waveform at the current phase
      */
     T value(void) const;
 
+    /*!\brief Writes the next frames values of each channel of the Waveform to a set of outputs
+     *
+     * Every channel of a frame is interpolated at once (see Waveform::frame()). Output channel c gets channel
+     * c % channels() of the Waveform, so a mono Waveform is copied to every output.
+     *
+     * \param outputs  One buffer per output channel (each must hold at least frames values)
+     * \param frames   The number of frames to generate
+     * \param channels The number of output channels
+     * \return True if the phasor is still running
+     */
     bool generate(T **outputs, int frames, int channels=1);
 
+    /*!\brief Writes the next frames values of the Phasor to out, incrementing the phase after each one
+     *
+     * This is the block equivalent of calling value() followed by increment() for each frame. The way the Phasor reads
+     * (fixed point, periodic or neither) is chosen once for the block, and the phase is only checked against its bounds
+     * on the frames where it might leave them.
+     *
+     * \param out    The buffer to write to (must hold at least frames values)
+     * \param frames The number of frames to generate
+     */
+    void process(T* out, size_t frames);
+
     /*!\brief Returns true if the phasor is still running
      * 
      * A phasor will still be running if its phase is between the front phase and the back phase. A cycling phasor
@@ -68,7 +139,12 @@ namespace audioelectric {
     bool operator<=(const Phasor& other) const;
     bool operator>=(const Phasor& other) const;
 
-    void setWaveform(const Waveform<T>& wf) {_wf = wf;}
+    /*!\brief Sets the waveform (this stops the Phasor from reading from a Wavetable)
+     *
+     * The Phasor shares the waveform's data, so later changes to wf (which copy its data on write) don't affect the
+     * Phasor.
+     */
+    void setWaveform(const Waveform<T>& wf);
 
     /*!\brief Sets all of the paramters of the waveorm
      *
@@ -103,9 +179,22 @@ namespace audioelectric {
 
     void setCycle(bool cycle);
 
+    /*!\brief Sets whether the Phasor keeps its phase in fixed point
+     *
+     * A fixed-point Phasor keeps its phase, rate, front and back as 32.32 fixed-point numbers. The integer part of the
+     * phase indexes the waveform and the fraction is the interpolation weight, so incrementing is an integer add and a
+     * periodic Phasor wraps with a mask on the phase itself. The rate is rounded to 2^-32 samples per iteration and phases
+     * are limited to 2^31 samples, so fixed point suits short, dense grains better than long sample playback.
+     */
+    void setFixedPoint(bool fixed);
+
+    /*!\brief Returns true if the Phasor keeps its phase in fixed point
+     */
+    bool fixedPoint(void) const {return _fixed;}
+
     /*!\brief Returns the current phase of the Phasor
      */
-    double getPhase(void) const {return _phase;}
+    double getPhase(void) const {return _fixed ? (double)_fphase/PHASE_ONE : _phase;}
 
     /*!\brief Increments the phase
      */
@@ -122,13 +211,63 @@ namespace audioelectric {
     double _front;      //!< The start of the wavetable in iterations (the units of the phase)
     double _back;        //!< The back of the wavetable in iterations (the units of the phase)
     bool _cycle;        //!< Whether to cycle the Waveform
-    Waveform<T>& _wf;   //!< The waveform that we're phasing
+    Waveform<T> _wf;    //!< The waveform that we're phasing (which shares its data with the one we were given)
+    const Wavetable<T>* _mipmap;        //!< The Wavetable that we're phasing, if any (_wf is its level 0)
+    const Waveform<T>* _table;          //!< The waveform that values are read from (_wf or a level of _mipmap)
 
     bool _phase_good;   //!< Whether the phase is between front and back
+    long _mask;         //!< The mask used to wrap the phase of a periodic Phasor (0 if the Phasor isn't periodic)
+
+    bool _fixed;        //!< Whether the phase is kept in fixed point (the fixed-point members below are only used if so)
+    int64_t _fphase;    //!< The current phase in fixed point
+    int64_t _frate;     //!< The rate in fixed point
+    int64_t _ffront;    //!< The front in fixed point
+    int64_t _fback;     //!< The back in fixed point
+    std::vector<T> _frame;      //!< Scratch space for one frame of every channel in generate()
 
     /*!\brief Checks whether the given phase is within the start and stop bounds
      */
     inline bool _checkPhase(double phase) const;
+
+    /*!\brief Decides whether the Phasor is periodic
+     *
+     * A Phasor is periodic when it cycles over the whole of a power-of-two waveform. A periodic Phasor has a period of
+     * size() samples (rather than end()), interpolates from the last sample back to the first, and wraps its phase with a
+     * bitmask rather than with fmod.
+     */
+    void _updateMask(void);
+
+    /*!\brief Wraps the phase of a periodic Phasor back into [0,size())
+     */
+    inline void _wrapPhase(void);
+
+    /*!\brief Picks the level of the Wavetable to read from at the current rate
+     */
+    void _selectLevel(void);
+
+    /*!\brief Increments the phase of a fixed-point Phasor
+     */
+    inline void _incrementFixed(void);
+
+    /*!\brief process() for a fixed-point Phasor
+     */
+    void _processFixed(T* out, size_t frames);
+
+    /*!\brief process() for a periodic Phasor
+     */
+    void _processPeriodic(T* out, size_t frames);
+
+    /*!\brief process() for any other Phasor
+     */
+    void _processBounded(T* out, size_t frames);
+
+    /*!\brief Brings _phase up to date with the fixed-point phase (does nothing unless the Phasor is fixed point)
+     */
+    void _loadFixed(void);
+
+    /*!\brief Converts the phase, rate, front and back to fixed point (does nothing unless the Phasor is fixed point)
+     */
+    void _storeFixed(void);
     
   };
 
@@ -0,0 +1,96 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include "renderpool.hpp"
+
+namespace audioelectric {
+
+  RenderPool::RenderPool(unsigned threads) :
+    _task(nullptr), _tasks(0), _next(0), _generation(0), _pending(0), _stop(false)
+  {
+    for (unsigned i=1; i<threads; i++)
+      _workers.emplace_back(&RenderPool::_work, this);
+  }
+
+  RenderPool::~RenderPool(void)
+  {
+    std::lock_guard<std::mutex> running(_run_mutex);
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _start.notify_all();
+    for (auto& worker : _workers)
+      worker.join();
+  }
+
+  void RenderPool::run(size_t n, const std::function<void(size_t)>& task)
+  {
+    if (n == 0)
+      return;
+    std::lock_guard<std::mutex> running(_run_mutex);
+    if (_workers.empty() || n == 1) {
+      for (size_t i=0; i<n; i++)
+        task(i);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _task = &task;
+      _tasks = n;
+      _next.store(0, std::memory_order_relaxed);
+      _pending.store(_workers.size(), std::memory_order_relaxed);
+      _generation.fetch_add(1, std::memory_order_release);
+    }
+    _start.notify_all();
+    _drain();
+
+    // Every task has been taken, so the workers that are still busy should be done soon
+    for (int i=0; i<RENDERPOOL_SPIN && _pending.load(std::memory_order_acquire) != 0; i++)
+      std::this_thread::yield();
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this] {return _pending.load(std::memory_order_acquire) == 0;});
+    _task = nullptr;
+  }
+
+  void RenderPool::_work(void)
+  {
+    uint64_t seen = 0;
+    while (true) {
+      uint64_t generation = _generation.load(std::memory_order_acquire);
+      for (int i=0; i<RENDERPOOL_SPIN && generation == seen; i++) {
+        std::this_thread::yield();
+        generation = _generation.load(std::memory_order_acquire);
+      }
+      if (generation == seen) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _start.wait(lock, [&] {
+            generation = _generation.load(std::memory_order_acquire);
+            return _stop || generation != seen;
+          });
+        if (_stop)
+          return;
+      }
+      seen = generation;
+      _drain();
+      if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // Taking the lock makes sure that run() is either waiting for the notification or hasn't checked _pending yet
+        std::lock_guard<std::mutex> lock(_mutex);
+        _done.notify_one();
+      }
+    }
+  }
+
+  void RenderPool::_drain(void)
+  {
+    for (size_t i=_next.fetch_add(1, std::memory_order_relaxed); i<_tasks;
+         i=_next.fetch_add(1, std::memory_order_relaxed))
+      (*_task)(i);
+  }
+
+}  // audioelectric
@@ -0,0 +1,85 @@
+/* \file renderpool.hpp
+ * \brief Defines the RenderPool class
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define RENDERPOOL_SPIN 2048    //!< The number of times an idle thread checks for work before it sleeps
+
+namespace audioelectric {
+
+  /*!\brief A set of threads that stay alive between blocks to run the independent tasks of each block
+   *
+   * run() hands out the tasks of one block one at a time from a shared counter, so whichever thread is free takes the
+   * next task, and a thread that gets a slow task doesn't hold up the rest. The calling thread takes tasks too, so a pool
+   * of n threads starts n - 1 of its own.
+   *
+   * Blocks are short and come one right after another, so a thread that runs out of tasks spins for a while (see
+   * RENDERPOOL_SPIN) before it goes to sleep, and so does the caller while it waits for the last tasks to finish. Only
+   * one run() is in progress at a time; others wait for it to return.
+   */
+  class RenderPool final {
+  public:
+
+    /*!\brief Starts the threads of the pool
+     *
+     * \param threads The number of threads to run the tasks on, counting the one that calls run()
+     */
+    RenderPool(unsigned threads);
+
+    RenderPool(const RenderPool&) = delete;
+    RenderPool& operator=(const RenderPool&) = delete;
+
+    /*!\brief Stops the threads, once they've finished the run() in progress (if there is one)
+     */
+    ~RenderPool(void);
+
+    /*!\brief Returns the number of threads that run the tasks, counting the one that calls run()
+     */
+    unsigned threads(void) const {return _workers.size() + 1;}
+
+    /*!\brief Calls task once with each of 0 through n - 1, across the threads of the pool, and returns once they've all
+     * returned
+     *
+     * The tasks run in no particular order, and task must not throw.
+     */
+    void run(size_t n, const std::function<void(size_t)>& task);
+
+  private:
+
+    std::vector<std::thread> _workers;          //!< The threads that the pool started
+    std::mutex _run_mutex;                      //!< Held for the whole of each run()
+    std::mutex _mutex;                          //!< Guards the sleeping and waking of the threads
+    std::condition_variable _start;             //!< Wakes the workers when there are tasks
+    std::condition_variable _done;              //!< Wakes run() when every worker has finished with the tasks
+    const std::function<void(size_t)>* _task;   //!< The task of the run() in progress
+    size_t _tasks;                              //!< The number of tasks in the run() in progress
+    std::atomic<size_t> _next;                  //!< The next task to take
+    std::atomic<uint64_t> _generation;          //!< The number of run()s that have handed tasks to the workers
+    std::atomic<unsigned> _pending;             //!< The number of workers that haven't finished with the tasks
+    bool _stop;                                 //!< Whether the workers should exit (guarded by _mutex)
+
+    /*!\brief The loop of each worker
+     */
+    void _work(void);
+
+    /*!\brief Takes and runs tasks until there are none left
+     */
+    void _drain(void);
+  };
+
+}  // audioelectric
@@ -0,0 +1,316 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "resample.hpp"
+
+namespace audioelectric {
+
+  #define PI M_PI
+  #define RESAMPLE_BETA 9.0     //!< The Kaiser window's beta (about 90dB of stopband rejection)
+  #define HASH_CHUNK 65536      //!< The number of bytes of a file that are hashed at a time
+  #define WRITE_CHUNK 4096      //!< The number of frames that are written to a cache file at a time
+
+  /*********************** Resampler *******************************/
+
+  template <typename T>
+  Resampler<T>::Resampler(double from, double to) : _ratio(from/to)
+  {
+    // The cutoff is relative to the input's Nyquist frequency, and the filter widens as it narrows
+    double cutoff = _ratio > 1 ? 1/_ratio : 1;
+    _half = ceil(RESAMPLE_ZEROS/cutoff);
+    long taps = 2*_half;
+    _coefs.resize((RESAMPLE_PHASES + 1)*taps);
+    for (size_t j=0; j<=RESAMPLE_PHASES; j++) {
+      double frac = (double)j/RESAMPLE_PHASES;
+      std::vector<double> row(taps);
+      double sum = 0;
+      for (long k=0; k<taps; k++) {
+        // Tap k reads the sample k-_half+1 frames from the position's frame
+        double x = (double)(k - _half + 1) - frac;
+        double s = x == 0 ? 1 : sin(PI*cutoff*x)/(PI*cutoff*x);
+        row[k] = s*kernel::kaiser(x/_half, RESAMPLE_BETA);
+        sum += row[k];
+      }
+      for (long k=0; k<taps; k++)
+        _coefs[j*taps + k] = row[k]/sum;
+    }
+  }
+
+  template <typename T>
+  size_t Resampler<T>::length(size_t len) const
+  {
+    return len == 0 ? 0 : (size_t)((len - 1)/_ratio) + 1;
+  }
+
+  template <typename T>
+  Waveform<T> Resampler<T>::process(const Waveform<T>& in, unsigned threads) const
+  {
+    size_t len = length(in.size());
+    Waveform<T> out(len, in.channels(), in.layout(), in.samplerate()/_ratio, in.getInterpType());
+    process(in, out, threads);
+    return out;
+  }
+
+  template <typename T>
+  void Resampler<T>::process(const Waveform<T>& in, Waveform<T>& out, unsigned threads) const
+  {
+    if (in.channels() != out.channels())
+      throw WaveformError("A Waveform can only be resampled into one with the same number of channels");
+    size_t frames = out.size();
+    size_t channels = in.channels();
+    if (frames == 0)
+      return;
+    long istride = in.layout() == ChannelLayout::PLANAR ? 1 : channels;
+    long ostride = out.layout() == ChannelLayout::PLANAR ? 1 : channels;
+    // Take the pointers to the channels up front, so that out copies its data (if it's shared) before any thread starts
+    std::vector<const T*> ichan(channels);
+    std::vector<T*> ochan(channels);
+    for (size_t c=0; c<channels; c++) {
+      ichan[c] = &in.sample(0, c);
+      ochan[c] = &out.sample(0, c);
+    }
+    auto convert = [&](size_t begin, size_t end) {
+      for (size_t c=0; c<channels; c++)
+        _process(ichan[c], in.size(), istride, ochan[c], ostride, begin, end);
+    };
+
+    if (threads == 0)
+      threads = std::thread::hardware_concurrency();
+    size_t most = frames / RESAMPLE_MIN_CHUNK;
+    if (threads > most)
+      threads = most;
+    if (threads <= 1) {
+      convert(0, frames);
+      return;
+    }
+    std::vector<std::thread> workers;
+    size_t chunk = (frames + threads - 1) / threads;
+    for (size_t begin=chunk; begin<frames; begin+=chunk)
+      workers.emplace_back(convert, begin, begin + chunk < frames ? begin + chunk : frames);
+    convert(0, chunk);
+    for (auto& worker : workers)
+      worker.join();
+  }
+
+  template <typename T>
+  void Resampler<T>::_process(const T* in, size_t len, long stride, T* out, long ostride, size_t begin,
+                              size_t end) const
+  {
+    const long taps = 2*_half;
+    for (size_t n=begin; n<end; n++) {
+      double x = n*_ratio;
+      long p = x;
+      double pos = (x - p)*RESAMPLE_PHASES;
+      size_t j = pos;
+      T w = pos - j;
+      const T* c0 = _coefs.data() + j*taps;
+      const T* c1 = c0 + taps;
+      long first = p - _half + 1;
+      T sum = 0;
+      if (first >= 0 && first + taps <= (long)len) {
+        const T* d = in + first*stride;
+        for (long k=0; k<taps; k++)
+          sum += d[k*stride] * (c0[k] + (c1[k]-c0[k])*w);
+      }
+      else {
+        // Near the ends, the taps that fall outside of the input are silent
+        long kbegin = first < 0 ? -first : 0;
+        long kend = (long)len - first < taps ? (long)len - first : taps;
+        for (long k=kbegin; k<kend; k++)
+          sum += in[(first + k)*stride] * (c0[k] + (c1[k]-c0[k])*w);
+      }
+      out[n*ostride] = sum;
+    }
+  }
+
+  template class Resampler<double>;
+  template class Resampler<float>;
+
+  /*********************** Resample cache *******************************/
+
+  static std::mutex cache_mutex;
+
+  /*!\brief Returns the resample cache directory, which starts out as the default one
+   */
+  static std::string& cacheDir(void)
+  {
+    static std::string dir = [] {
+      if (const char* env = getenv("GRANULAR_CACHE"))
+        return std::string(env);
+      if (const char* xdg = getenv("XDG_CACHE_HOME"))
+        return std::string(xdg) + "/granular";
+      if (const char* home = getenv("HOME"))
+        return std::string(home) + "/.cache/granular";
+      return std::string();
+    }();
+    return dir;
+  }
+
+  void SetResampleCache(std::string dir)
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cacheDir() = dir;
+  }
+
+  std::string ResampleCache(void)
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return cacheDir();
+  }
+
+  /*!\brief Folds bytes into a 64-bit FNV-1a hash
+   */
+  static void hashBytes(const void* bytes, size_t len, uint64_t& hash)
+  {
+    const unsigned char* b = static_cast<const unsigned char*>(bytes);
+    for (size_t i=0; i<len; i++)
+      hash = (hash ^ b[i]) * 1099511628211ull;
+  }
+
+  /*!\brief Computes the cache key of a file, which is a hash of its contents
+   *
+   * The file is streamed through the hash HASH_CHUNK bytes at a time, so hashing a long file doesn't hold it in memory.
+   *
+   * \return False if the file couldn't be read
+   */
+  static bool fileKey(const std::string& afile, uint64_t& hash)
+  {
+    FILE* f = fopen(afile.c_str(), "rb");
+    if (!f)
+      return false;
+    hash = 14695981039346656037ull;
+    std::vector<unsigned char> buf(HASH_CHUNK);
+    size_t nread;
+    while ((nread = fread(buf.data(), 1, HASH_CHUNK, f)) > 0)
+      hashBytes(buf.data(), nread, hash);
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+  }
+
+  /*!\brief Reads the sample rate of an audio file from its header
+   *
+   * \return False if the file couldn't be opened
+   */
+  static bool fileRate(const std::string& afile, double& rate)
+  {
+    SF_INFO info{};
+    SNDFILE* f = sf_open(afile.c_str(), SFM_READ, &info);
+    if (!f)
+      return false;
+    rate = info.samplerate;
+    sf_close(f);
+    return true;
+  }
+
+  /*!\brief Creates a directory and any of its parents that don't exist
+   */
+  static bool makeDirs(const std::string& dir)
+  {
+    for (size_t slash = dir.find('/', 1); ; slash = dir.find('/', slash + 1)) {
+      std::string part = dir.substr(0, slash);
+      if (mkdir(part.c_str(), 0755) != 0 && errno != EEXIST)
+        return false;
+      if (slash == std::string::npos)
+        return true;
+    }
+  }
+
+  /*!\brief Writes a Waveform to a WAV file of native samples
+   *
+   * The file is written under a temporary name and then renamed, so that a reader never sees a partial file. The
+   * temporary name is unique to the process and the write, so threads and processes that convert the same section at
+   * once don't write to the same file.
+   */
+  template <typename T>
+  static void writeCache(const std::string& path, const Waveform<T>& wf)
+  {
+    static std::atomic<uint64_t> writes(0);
+    std::string tmp = path + "." + std::to_string(getpid()) + "." + std::to_string(writes++) + ".tmp";
+    SF_INFO info{};
+    info.samplerate = wf.samplerate();
+    info.channels = wf.channels();
+    info.format = SF_FORMAT_WAV | (std::is_same<T, float>::value ? SF_FORMAT_FLOAT : SF_FORMAT_DOUBLE);
+    SNDFILE* f = sf_open(tmp.c_str(), SFM_WRITE, &info);
+    if (!f)
+      return;
+    // Write a chunk of interleaved frames at a time
+    std::vector<T> frames(WRITE_CHUNK*wf.channels());
+    for (size_t begin=0; begin<wf.size(); begin+=WRITE_CHUNK) {
+      size_t n = wf.size() - begin < WRITE_CHUNK ? wf.size() - begin : WRITE_CHUNK;
+      for (size_t i=0; i<n; i++) {
+        for (size_t c=0; c<wf.channels(); c++)
+          frames[i*wf.channels() + c] = wf.sample(begin + i, c);
+      }
+      if constexpr (std::is_same<T, double>::value)
+        sf_writef_double(f, frames.data(), n);
+      else if constexpr (std::is_same<T, float>::value)
+        sf_writef_float(f, frames.data(), n);
+    }
+    sf_close(f);
+    if (rename(tmp.c_str(), path.c_str()) != 0)
+      unlink(tmp.c_str());
+  }
+
+  template <typename T>
+  Waveform<T> LoadWaveform(std::string afile, T samplerate, size_t begin, size_t end, InterpType it,
+                           ChannelLayout layout)
+  {
+    // The header and the key are enough to find a cached conversion, so the file is only decoded if there isn't one
+    double rate;
+    if (fileRate(afile, rate) && rate == samplerate)
+      return Waveform<T>(afile, begin, end, it, layout);
+
+    std::string dir = ResampleCache();
+    std::string cached;
+    uint64_t hash;
+    if (!dir.empty() && fileKey(afile, hash)) {
+      char name[128];
+      snprintf(name, sizeof(name), "%016llx-%zu-%zu-%g-%s-%s.wav", (unsigned long long)hash, begin, end,
+               (double)samplerate, layout == ChannelLayout::MIXDOWN ? "mono" : "multi",
+               std::is_same<T, float>::value ? "f32" : "f64");
+      cached = dir + "/" + name;
+      if (access(cached.c_str(), R_OK) == 0) {
+        try {
+          Waveform<T> hit(cached, 0, 0, it, layout);
+          if (hit.samplerate() == samplerate)
+            return hit;
+        }
+        catch (WaveformError&) {
+          // A cache file that can't be read is simply replaced
+        }
+      }
+    }
+
+    Waveform<T> wf(afile, begin, end, it, layout);
+    if (wf.samplerate() == samplerate)
+      return wf;
+    Waveform<T> out = Resampler<T>(wf.samplerate(), samplerate).process(wf);
+    if (!cached.empty() && makeDirs(dir))
+      writeCache(cached, out);
+    return out;
+  }
+
+  template Waveform<double> LoadWaveform<double>(std::string, double, size_t, size_t, InterpType, ChannelLayout);
+  template Waveform<float> LoadWaveform<float>(std::string, float, size_t, size_t, InterpType, ChannelLayout);
+
+}  // audioelectric
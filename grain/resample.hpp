@@ -0,0 +1,115 @@
+/* \file resample.hpp
+ * \brief Defines the Resampler class and the loading of audio files at the engine's sample rate
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "waveform.hpp"
+
+#define RESAMPLE_ZEROS 16               //!< The zero crossings of the resampling filter on each side of its center
+#define RESAMPLE_PHASES 256             //!< The number of fractional positions that the filter is computed for
+#define RESAMPLE_MIN_CHUNK 16384        //!< The fewest output frames that are worth giving to a thread of their own
+
+namespace audioelectric {
+
+  /*!\brief A polyphase windowed-sinc sample-rate converter
+   *
+   * The Resampler computes a bank of Kaiser-windowed sinc filters once, for RESAMPLE_PHASES+1 fractional positions
+   * between two input samples, and each output frame blends the two filters nearest to its position and takes a single
+   * dot product with the input around it. When converting down, the filters' cutoff is lowered to the output's Nyquist
+   * frequency (and they're widened to match), so nothing above it aliases.
+   *
+   * Every output frame is independent of the others, so long conversions are split across threads.
+   */
+  template <typename T>
+  class Resampler final {
+  public:
+
+    /*!\brief Creates a Resampler that converts from one sample rate to another
+     *
+     * \param from The sample rate of the input
+     * \param to   The sample rate of the output
+     */
+    Resampler(double from, double to);
+
+    /*!\brief Returns the number of input samples read for each output frame
+     */
+    double ratio(void) const {return _ratio;}
+
+    /*!\brief Returns the number of output frames that cover an input of len frames
+     */
+    size_t length(size_t len) const;
+
+    /*!\brief Converts a Waveform
+     *
+     * \param in      The Waveform to convert
+     * \param threads The number of threads to use, or 0 to use one per core. Short conversions use fewer
+     * \return A new Waveform of length(in.size()) frames with the same channels and layout, at the output rate
+     */
+    Waveform<T> process(const Waveform<T>& in, unsigned threads=0) const;
+
+    /*!\brief Converts a Waveform into another one, filling all of its frames
+     *
+     * Frame n of out is read from position n*ratio() of in, and positions past the end of in are silent.
+     *
+     * \param in      The Waveform to convert
+     * \param out     The Waveform to write to. It must have as many channels as in
+     * \param threads The number of threads to use, or 0 to use one per core. Short conversions use fewer
+     */
+    void process(const Waveform<T>& in, Waveform<T>& out, unsigned threads=0) const;
+
+  private:
+
+    double _ratio;              //!< The input samples per output frame
+    long _half;                 //!< Half of the number of taps in each filter
+    std::vector<T> _coefs;      //!< The filters, one row of 2*_half taps per fractional position
+
+    /*!\brief Converts frames [begin,end) of one channel
+     */
+    void _process(const T* in, size_t len, long stride, T* out, long ostride, size_t begin, size_t end) const;
+
+  };
+
+  /*!\brief Sets the directory that resampled audio files are cached in
+   *
+   * The directory is created when the first file is cached. An empty path disables the cache. By default, the cache is
+   * in $GRANULAR_CACHE if it's set, and otherwise in $XDG_CACHE_HOME/granular or ~/.cache/granular.
+   */
+  void SetResampleCache(std::string dir);
+
+  /*!\brief Returns the directory that resampled audio files are cached in (empty if the cache is disabled)
+   */
+  std::string ResampleCache(void);
+
+  /*!\brief Loads a section of an audio file, converted to a sample rate
+   *
+   * A file that's already at the sample rate is loaded just as the Waveform constructor would load it. Any other file
+   * is converted with a Resampler, and the result is saved in the resample cache (see SetResampleCache()), keyed by a
+   * hash of the file's contents, the section, the sample rate and the channel layout. Loading the same section at the
+   * same rate again reads the cached file instead of decoding and converting the source (the source is only streamed
+   * through the hash), and since the cache holds WAV files of native samples, a Waveform<float> maps it rather than
+   * reading it.
+   *
+   * \throw WaveformError under the same conditions as the Waveform constructor
+   *
+   * \param afile      Path to the audio file to read
+   * \param samplerate The sample rate to convert to
+   * \param begin      Beginning frame of the audio file section (at the file's rate)
+   * \param end        Ending frame of the audio file section (at the file's rate). If end==0 then read to the last frame
+   * \param it         Interpolation type
+   * \param layout     How to store the channels of a multi-channel file
+   */
+  template <typename T>
+  Waveform<T> LoadWaveform(std::string afile, T samplerate, size_t begin=0, size_t end=0,
+                           InterpType it=InterpType::LINEAR, ChannelLayout layout=ChannelLayout::MIXDOWN);
+
+}  // audioelectric
@@ -0,0 +1,144 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include <chrono>
+
+#include "samplelibrary.hpp"
+#include "resample.hpp"
+
+namespace audioelectric {
+
+  template <typename T>
+  SampleLibrary<T>::SampleLibrary(size_t budget) : _budget(budget), _usage(0)
+  {
+
+  }
+
+  template <typename T>
+  SampleLibrary<T>& SampleLibrary<T>::instance(void)
+  {
+    static SampleLibrary<T> library;
+    return library;
+  }
+
+  template <typename T>
+  Waveform<T> SampleLibrary<T>::load(std::string afile, size_t begin, size_t end, T samplerate, InterpType it,
+                                     ChannelLayout layout, bool cyclic)
+  {
+    std::string key = afile + ":" + std::to_string(begin) + ":" + std::to_string(end) + ":" +
+      std::to_string(samplerate) + ":" + std::to_string((int)layout) + (cyclic ? ":cyclic" : "");
+    std::shared_future<Waveform<T>> pending;
+    std::promise<Waveform<T>> promise;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto found = _entries.find(key);
+      if (found != _entries.end()) {
+        _lru.splice(_lru.begin(), _lru, found->second.lru);
+        pending = found->second.wf;
+      }
+      else {
+        _lru.push_front(key);
+        _entries[key] = {promise.get_future().share(), _lru.begin(), 0};
+      }
+    }
+
+    if (!pending.valid()) {
+      // This thread loads the section, while any others that ask for it wait
+      try {
+        Waveform<T> wf = samplerate == 0 ? Waveform<T>(afile, begin, end, it, layout) :
+          LoadWaveform<T>(afile, samplerate, begin, end, it, layout);
+        // Players that cycle over a power-of-two Waveform wrap its guards (see Phasor and GrainPool), which would give
+        // each of them its own copy if the library didn't wrap them first
+        if (cyclic && wf.powerOfTwo())
+          wf.setGuard(Guard::WRAPPED);
+        promise.set_value(wf);
+        std::lock_guard<std::mutex> lock(_mutex);
+        Entry& entry = _entries[key];
+        entry.bytes = wf.size()*wf.channels()*sizeof(T);
+        _usage += entry.bytes;
+        pending = entry.wf;
+        _evict(_budget);
+      }
+      catch (...) {
+        // The entry goes before the failure is published, so that _evict() never finds a failed entry
+        std::lock_guard<std::mutex> lock(_mutex);
+        promise.set_exception(std::current_exception());
+        _lru.erase(_entries[key].lru);
+        _entries.erase(key);
+        throw;
+      }
+    }
+
+    Waveform<T> wf = pending.get();
+    wf.setInterpType(it);
+    return wf;
+  }
+
+  template <typename T>
+  void SampleLibrary<T>::setBudget(size_t budget)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _budget = budget;
+    _evict(_budget);
+  }
+
+  template <typename T>
+  size_t SampleLibrary<T>::budget(void) const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _budget;
+  }
+
+  template <typename T>
+  size_t SampleLibrary<T>::usage(void) const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _usage;
+  }
+
+  template <typename T>
+  size_t SampleLibrary<T>::size(void) const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+  }
+
+  template <typename T>
+  void SampleLibrary<T>::trim(void)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _evict(_budget);
+  }
+
+  template <typename T>
+  void SampleLibrary<T>::clear(void)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _evict(0);
+  }
+
+  template <typename T>
+  void SampleLibrary<T>::_evict(size_t budget)
+  {
+    auto key = _lru.end();
+    while (_usage > budget && key != _lru.begin()) {
+      --key;
+      Entry& entry = _entries[*key];
+      // Sections that are still loading, or that are shared with anything outside of the library, are in use
+      if (entry.wf.wait_for(std::chrono::seconds(0)) != std::future_status::ready || entry.wf.get().shared())
+        continue;
+      _usage -= entry.bytes;
+      _entries.erase(*key);
+      key = _lru.erase(key);
+    }
+  }
+
+  template class SampleLibrary<double>;
+  template class SampleLibrary<float>;
+
+}  // audioelectric
@@ -0,0 +1,124 @@
+/* \file samplelibrary.hpp
+ * \brief Defines the SampleLibrary class
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+#pragma once
+
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "waveform.hpp"
+
+#define DEFAULT_LIBRARY_BUDGET (size_t(1) << 30)        //!< The default memory budget of a SampleLibrary (1GiB)
+
+namespace audioelectric {
+
+  /*!\brief Loads sections of audio files once and shares them between everything that plays them
+   *
+   * Every request for the same section of the same file (at the same sample rate and with the same channel layout) gets
+   * a Waveform that shares one copy of the samples, no matter how many instruments ask for it or from which threads. If
+   * several threads ask for a section that isn't loaded yet, one of them loads it while the others wait for it.
+   *
+   * The library keeps each section it has loaded until it needs the memory back. It has a budget for the memory that
+   * its sections use, and whenever a load takes it over budget, it forgets the sections that nothing else is using,
+   * least recently requested first. A section that's still in use is never evicted, since forgetting it wouldn't free
+   * anything, so the library can stay over budget for as long as those sections are in use.
+   *
+   * The Waveforms are shared rather than copied, so they should be treated as read-only. Writing to one gives it its
+   * own copy of the data (see Waveform), which works, but takes it out of the library's accounting.
+   */
+  template <typename T>
+  class SampleLibrary final {
+  public:
+
+    /*!\brief Creates an empty library
+     *
+     * \param budget The number of bytes of samples that the library may keep without evicting anything
+     */
+    SampleLibrary(size_t budget=DEFAULT_LIBRARY_BUDGET);
+
+    SampleLibrary(const SampleLibrary&) = delete;
+    SampleLibrary& operator=(const SampleLibrary&) = delete;
+
+    /*!\brief Returns the process-wide library
+     */
+    static SampleLibrary& instance(void);
+
+    /*!\brief Returns a section of an audio file, loading it if the library doesn't have it
+     *
+     * \throw WaveformError under the same conditions as the Waveform constructor
+     *
+     * \param afile      Path to the audio file to read
+     * \param begin      Beginning frame of the audio file section
+     * \param end        Ending frame of the audio file section. If end==0 then read to the last frame
+     * \param samplerate The sample rate to convert the section to (see LoadWaveform()), or 0 to keep the file's rate
+     * \param it         Interpolation type of the returned Waveform (this doesn't affect the shared samples)
+     * \param layout     How to store the channels of a multi-channel file
+     * \param cyclic     Whether the section will be cycled over, as a grain carrier is. A cycled power-of-two section
+     *                   gets wrapped guards, which players that cycle over it would otherwise wrap in their own copies
+     *                   (see GrainPool). One-shot sections keep zero guards, so the first and last frames don't
+     *                   interpolate from the other end. The two are kept as separate sections
+     */
+    Waveform<T> load(std::string afile, size_t begin=0, size_t end=0, T samplerate=0,
+                     InterpType it=InterpType::LINEAR, ChannelLayout layout=ChannelLayout::MIXDOWN, bool cyclic=false);
+
+    /*!\brief Sets the memory budget, and evicts unused sections until the library is within it
+     */
+    void setBudget(size_t budget);
+
+    /*!\brief Returns the memory budget in bytes
+     */
+    size_t budget(void) const;
+
+    /*!\brief Returns the number of bytes of samples that the library holds
+     */
+    size_t usage(void) const;
+
+    /*!\brief Returns the number of sections that the library holds
+     */
+    size_t size(void) const;
+
+    /*!\brief Evicts unused sections until the library is within its budget
+     *
+     * This happens on every load, but sections that were in use then may not be now.
+     */
+    void trim(void);
+
+    /*!\brief Evicts every section that isn't in use
+     */
+    void clear(void);
+
+  private:
+
+    /*!\brief A section that has been loaded, or that is being loaded
+     */
+    struct Entry {
+      std::shared_future<Waveform<T>> wf;       //!< The section (ready once it has been loaded)
+      std::list<std::string>::iterator lru;     //!< The section's place in _lru
+      size_t bytes;                             //!< The size of the section's samples (0 until it's loaded)
+    };
+
+    mutable std::mutex _mutex;                  //!< Guards everything below
+    size_t _budget;                             //!< The memory budget in bytes
+    size_t _usage;                              //!< The bytes of samples held
+    std::unordered_map<std::string, Entry> _entries;    //!< The sections, by their key
+    std::list<std::string> _lru;                //!< The keys of the sections, most recently requested first
+
+    /*!\brief Evicts unused sections, least recently requested first, until the usage is within a budget
+     *
+     * _mutex must be held.
+     */
+    void _evict(size_t budget);
+
+  };
+
+}  // audioelectric
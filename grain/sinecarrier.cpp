@@ -0,0 +1,37 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include <cmath>
+
+#include "sinecarrier.hpp"
+#include "waveform.hpp"
+
+namespace audioelectric {
+
+  #define PI M_PI
+
+  SineCarrier::SineCarrier(size_t len) : _size(len), _scale(2*PI/len)
+  {
+    if (len < 2)
+      throw WaveformError("A sine carrier must stand in for at least 2 samples");
+  }
+
+  double SineCarrier::operator()(double phase) const
+  {
+    return sin(phase*_scale);
+  }
+
+  void SineCarrier::start(double phase, double rate, double& re, double& im, double& dre, double& dim) const
+  {
+    re = cos(phase*_scale);
+    im = sin(phase*_scale);
+    dre = cos(rate*_scale);
+    dim = sin(rate*_scale);
+  }
+
+}  // audioelectric
@@ -0,0 +1,74 @@
+/* \file sinecarrier.hpp
+ * \brief Defines the SineCarrier class
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+#pragma once
+
+#include <cstddef>
+
+#define SINE_RESTART_FRAMES 4096
+
+namespace audioelectric {
+
+  /*!\brief A sine carrier that is computed as the grains play rather than read from a table
+   *
+   * A SineCarrier stands in for a sine Waveform of size() samples (see GenerateSin()): a grain's carrier phase cycles
+   * just as it would over the Waveform, and the carrier is sin(2*pi*phase/size()). Each grain keeps a rotator, the
+   * cosine and sine of its carrier's angle, which start() sets up along with the rotation that a step of the grain's
+   * rate makes. Moving a grain to its next frame is then a single complex multiply (see rotateGrains()), rather than a
+   * lookup and an interpolation.
+   *
+   * The rotators are kept in double precision, and are restarted from the exact angle whenever a grain's phase is
+   * cycled back into [front,back] and every SINE_RESTART_FRAMES frames, so their magnitude and angle never drift from
+   * the exact sine by more than a small fraction of a float's resolution.
+   */
+  class SineCarrier final {
+  public:
+
+    /*!\brief Creates an empty carrier, which stands for no carrier at all
+     */
+    SineCarrier(void) : _size(0), _scale(0) {}
+
+    /*!
+     * \param len The size of the sine Waveform that the carrier stands in for (at least 2)
+     * \throw WaveformError if len is too small
+     */
+    SineCarrier(size_t len);
+
+    /*!\brief Returns the size of the Waveform that the carrier stands in for (its period), or 0 if it's empty
+     */
+    size_t size(void) const {return _size;}
+
+    /*!\brief Returns the last sample position of the carrier
+     */
+    double end(void) const {return _size - 1.;}
+
+    /*!\brief Returns the carrier at a phase, computed directly
+     */
+    double operator()(double phase) const;
+
+    /*!\brief Sets up the rotator of a grain at a carrier phase
+     *
+     * \param phase The grain's carrier phase
+     * \param rate  The grain's carrier rate
+     * \param re    Set to the cosine of the carrier's angle
+     * \param im    Set to the sine of the carrier's angle (which is the carrier's value)
+     * \param dre   Set to the cosine of the angle of one step
+     * \param dim   Set to the sine of the angle of one step
+     */
+    void start(double phase, double rate, double& re, double& im, double& dre, double& dim) const;
+
+  private:
+
+    size_t _size;
+    double _scale;      //!< Converts a carrier phase to an angle
+
+  };
+
+}  // audioelectric
@@ -0,0 +1,93 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include "bakedtables.hpp"
+#include "tablecache.hpp"
+
+namespace audioelectric {
+
+  template <typename T>
+  TableCache<T>& TableCache<T>::instance(void)
+  {
+    static TableCache<T> cache;
+    return cache;
+  }
+
+  template <typename T>
+  Waveform<T> TableCache<T>::table(TableType type, size_t len, T param)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _table(Key(type, len, type == TableType::SIN ? 0 : param));
+  }
+
+  template <typename T>
+  Wavetable<T> TableCache<T>::wavetable(TableType type, size_t len, T param)
+  {
+    Key key(type, len, type == TableType::SIN ? 0 : param);
+    // Generating while holding the lock means that concurrent requests for a new table wait for it, rather than
+    // generating it again
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _wavetables.find(key);
+    if (found != _wavetables.end())
+      return found->second;
+    return _wavetables.emplace(key, Wavetable<T>(_table(key))).first->second;
+  }
+
+  template <typename T>
+  size_t TableCache<T>::size(void) const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _tables.size() + _wavetables.size();
+  }
+
+  template <typename T>
+  void TableCache<T>::clear(void)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _tables.clear();
+    _wavetables.clear();
+  }
+
+  template <typename T>
+  const Waveform<T>& TableCache<T>::_table(const Key& key)
+  {
+    auto found = _tables.find(key);
+    if (found != _tables.end())
+      return found->second;
+    Waveform<T> wf;
+    T param = std::get<2>(key);
+    if (const double* baked = BakedTable(std::get<0>(key), std::get<1>(key), param)) {
+      // The library already holds this table, so it only needs converting to T
+      wf = Waveform<T>(std::get<1>(key));
+      T* data = wf.data();
+      for (size_t i=0; i<wf.size(); i++)
+        data[i] = baked[i];
+      wf.setGuard(Guard::WRAPPED);
+      return _tables.emplace(key, wf).first->second;
+    }
+    switch (std::get<0>(key)) {
+    case TableType::GAUSSIAN:
+      GenerateGaussian(wf, std::get<1>(key), param);
+      break;
+    case TableType::SIN:
+      GenerateSin(wf, std::get<1>(key));
+      break;
+    case TableType::TRIANGLE:
+      GenerateTriangle(wf, std::get<1>(key), param);
+      break;
+    case TableType::SQUARE:
+      GenerateSquare(wf, std::get<1>(key), param);
+      break;
+    }
+    return _tables.emplace(key, wf).first->second;
+  }
+
+  template class TableCache<double>;
+  template class TableCache<float>;
+
+}  // audioelectric
@@ -0,0 +1,91 @@
+/* \file tablecache.hpp
+ * \brief Defines the TableCache class
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "waveform.hpp"
+#include "wavetable.hpp"
+
+namespace audioelectric {
+
+  /*!\brief The generator functions whose tables a TableCache holds
+   */
+  enum class TableType {
+    GAUSSIAN,   //!< GenerateGaussian(), whose parameter is sigma
+    SIN,        //!< GenerateSin(), which has no parameter
+    TRIANGLE,   //!< GenerateTriangle(), whose parameter is the slant
+    SQUARE,     //!< GenerateSquare(), whose parameter is the width
+  };
+
+  /*!\brief Generates each table once and shares it with everything that asks for it
+   *
+   * Tables are keyed by their generator, length and parameter, and the first request for a key generates the table (and,
+   * for wavetable(), builds its band-limited levels). Every later request gets a Waveform that shares the same data, so
+   * any number of Clouds with the same shapes and carriers hold a single copy of each table. Requests may come from any
+   * thread. The tables are small, so they're kept until clear() is called. The standard carrier tables are baked into
+   * the library (see BakedTable()), so generating one of those only converts it to T.
+   *
+   * The tables are shared rather than copied, so they should be treated as read-only. Writing to one gives it its own
+   * copy of the data (see Waveform), leaving the cached table alone.
+   */
+  template <typename T>
+  class TableCache final {
+  public:
+
+    TableCache(void) {}
+
+    TableCache(const TableCache&) = delete;
+    TableCache& operator=(const TableCache&) = delete;
+
+    /*!\brief Returns the process-wide cache
+     */
+    static TableCache& instance(void);
+
+    /*!\brief Returns a generated table
+     *
+     * \param type  The generator
+     * \param len   The length of the table
+     * \param param The generator's parameter (ignored for SIN)
+     */
+    Waveform<T> table(TableType type, size_t len, T param=0);
+
+    /*!\brief Returns the band-limited levels of a generated table (see Wavetable)
+     *
+     * \throw WaveformError if len is not a power of two
+     */
+    Wavetable<T> wavetable(TableType type, size_t len, T param=0);
+
+    /*!\brief Returns the number of tables and wavetables held
+     */
+    size_t size(void) const;
+
+    /*!\brief Forgets every table (tables that are still in use stay valid)
+     */
+    void clear(void);
+
+  private:
+
+    typedef std::tuple<TableType, size_t, T> Key;
+
+    mutable std::mutex _mutex;                  //!< Guards the maps
+    std::map<Key, Waveform<T>> _tables;         //!< The generated tables
+    std::map<Key, Wavetable<T>> _wavetables;    //!< The band-limited levels of generated tables
+
+    /*!\brief Returns a generated table, generating it if needed. _mutex must be held
+     */
+    const Waveform<T>& _table(const Key& key);
+
+  };
+
+}  // audioelectric
@@ -11,8 +11,9 @@
 namespace audioelectric {
 
   template <typename T>
-  Voice<T>::Voice(Waveform<T>& shape, Waveform<T>& carrier) :
-    _graingen(shape, carrier), _env1_mult(0, 0, 0, 0, 0, 0), _env2_mult(0, 0, 0, 0, 0, 0)
+  Voice<T>::Voice(const Waveform<T>& shape, const Waveform<T>& carrier) :
+    _graingen(shape, carrier), _env1_mult(0, 0, 0, 0, 0, 0), _env2_mult(0, 0, 0, 0, 0, 0),
+    _control_frames(VOICE_CONTROL_FRAMES), _control_left(0)
   {
 
   }
@@ -20,17 +21,24 @@ namespace audioelectric {
   template <typename T>
   void Voice<T>::increment(void)
   {
-    /* Note: if we need to switch using a control rate for the controls then we can divide the length of all envelope
-     * parameters by the control rate, and then only do the parameter calculations and the envelope increments on every
-     * nth increment.
-     */
-    _env1.increment();
-    _env2.increment();
-    GrainParams<T> params = _base_params;
-    GrainParams<T> mod = _env1.value()*_env2_mult + _env2.value()*_env2_mult;
-    params.modulate(mod);
-    _graingen.applyInputs(params);
+    if (_control_left == 0)
+      _control();
     _graingen.increment();
+    _control_left--;
+  }
+
+  template <typename T>
+  void Voice<T>::process(T* out, size_t frames, size_t channels, size_t stride)
+  {
+    while (frames > 0) {
+      if (_control_left == 0)
+        _control();
+      size_t n = frames < _control_left ? frames : _control_left;
+      _graingen.process(out, n, channels, stride);
+      _control_left -= n;
+      out += n;
+      frames -= n;
+    }
   }
 
   template <typename T>
@@ -39,6 +47,9 @@ namespace audioelectric {
     _base_params = params;
     _env1.gate(true);
     _env2.gate(true);
+    // The note starts from its unramped parameters, and ramps from the next frame on
+    _graingen.applyInputs(_modulatedParams());
+    _control_left = 0;
   }
 
   template <typename T>
@@ -48,6 +59,28 @@ namespace audioelectric {
     _env2.gate(false);
   }
 
+  template <typename T>
+  GrainParams<T> Voice<T>::_modulatedParams(void) const
+  {
+    GrainParams<T> params = _base_params;
+    GrainParams<T> mod = _env1.value()*_env2_mult + _env2.value()*_env2_mult;
+    params.modulate(mod);
+    return params;
+  }
+
+  template <typename T>
+  void Voice<T>::_control(void)
+  {
+    _env1.increment(_control_frames);
+    _env2.increment(_control_frames);
+    // A period of 1 evaluates the parameters on every frame, so they're applied at once rather than ramped to
+    if (_control_frames == 1)
+      _graingen.applyInputs(_modulatedParams());
+    else
+      _graingen.rampInputs(_modulatedParams(), _control_frames);
+    _control_left = _control_frames;
+  }
+
   template class Voice<double>;
   template class Voice<float>;
 
@@ -13,6 +13,10 @@
 #include "graingenerator.hpp"
 #include "envelope.hpp"
 
+/*!\brief The default number of frames between updates of the envelope modulation (see Voice::setControlRate())
+ */
+#define VOICE_CONTROL_FRAMES 64
+
 namespace audioelectric {
 
   template <typename T> class Cloud;
@@ -22,6 +26,13 @@ namespace audioelectric {
    * A voice controls the output of a note from beginning to end. Once the voice is triggered, it will evaluate to true
    * until the note has been released and all envelopes and grains have completed. At that point it may be safely removed
    * from the set of active voices.
+   *
+   * The envelopes and the grain parameters are evaluated at a control rate rather than on every frame. At each control
+   * point the envelopes are advanced by a whole control period and the grain parameters ramp linearly to their modulated
+   * values over the period (see GrainGenerator::rampInputs()), so the modulation is smooth but lags by one period. A
+   * control period of 1 evaluates them on every frame instead, applying the parameters on the frame they're evaluated
+   * for, just as a Voice did before it had a control rate. Either way, process() and increment() evaluate them on the
+   * same frames.
    */
   template <typename T>
   class Voice final {
@@ -30,7 +41,7 @@ namespace audioelectric {
     
   public:
 
-    Voice(Waveform<T>& shape, Waveform<T>& carrier);
+    Voice(const Waveform<T>& shape, const Waveform<T>& carrier);
 
     /*!\brief Evaluates to true if the voice is active and false otherwise
      */
@@ -40,6 +51,22 @@ namespace audioelectric {
 
     void increment(void);
 
+    /*!\brief Adds the next frames values of the voice to out
+     *
+     * This is the block equivalent of calling value() and increment() for each frame. The block is split at the control
+     * points.
+     *
+     * \param out    The buffer to add the voice to
+     * \param frames The number of frames to generate
+     */
+    void process(T* out, size_t frames) {process(out, frames, 1, 0);}
+
+    /*!\brief Adds the next frames values of the voice to a set of planar output channels
+     *
+     * Output channel c starts at out + c*stride, and gets channel c % channels of the carrier (see GrainPool::process()).
+     */
+    void process(T* out, size_t frames, size_t channels, size_t stride);
+
     /*!\brief Starts the voice
      *
      * \param params The "base" parameters of the note (which may get modulated by the envelopes)
@@ -50,6 +77,21 @@ namespace audioelectric {
      */
     void release(void);
 
+    /*!\brief Sets the number of frames between control points
+     *
+     * \param frames The control period (e.g. 16, 32 or 64). A period of 1 evaluates the envelopes and the grain
+     *               parameters on every frame, without ramping
+     */
+    void setControlRate(size_t frames) {_control_frames = frames > 0 ? frames : 1;}
+
+    /*!\brief Returns the number of frames between control points
+     */
+    size_t controlRate(void) const {return _control_frames;}
+
+    /*!\brief Restarts the random number generator of the voice's grains (see GrainGenerator::setSeed())
+     */
+    void setSeed(uint64_t seed, uint64_t stream=0) {_graingen.setSeed(seed, stream);}
+
   private:
 
     Envelope<T> _env1;                  //!< Envelope 1
@@ -58,6 +100,16 @@ namespace audioelectric {
     GrainParams<T> _env2_mult;          //!< Multipliers for envelope 2
     GrainGenerator<T> _graingen;        //!< The grain generator
     GrainParams<T> _base_params;        //!< The base parameters
+    size_t _control_frames;             //!< The number of frames between control points
+    size_t _control_left;               //!< The number of frames left until the next control point
+
+    /*!\brief Returns the base parameters modulated by the envelopes
+     */
+    GrainParams<T> _modulatedParams(void) const;
+
+    /*!\brief Advances the envelopes by a control period and ramps the grain parameters to their new modulated values
+     */
+    void _control(void);
   };
   
 }
@@ -4,8 +4,13 @@
 #include <type_traits>
 #include <utility>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "waveform.hpp"
-#include "phasor.hpp"
+#include "resample.hpp"
 
 namespace audioelectric {
 
@@ -19,13 +24,17 @@ namespace audioelectric {
   /*********************** Public Waveform *******************************/
 
   template<typename T>
-  Waveform<T>::Waveform(void) : _interptype(InterpType::LINEAR), _data(nullptr), _size(0), _end(0), _samplerate(0)
+  Waveform<T>::Waveform(void) :
+    _interptype(InterpType::LINEAR), _size(0), _end(0), _channels(1), _layout(ChannelLayout::INTERLEAVED), _stride(1),
+    _chstride(1), _guard(Guard::ZEROS), _data(nullptr), _samplerate(0), _mapped(false)
   {
     
   }
 
   template<typename T>
-  Waveform<T>::Waveform(std::size_t len, T sr, InterpType it) : _interptype(it), _data(nullptr), _size(0), _end(0)
+  Waveform<T>::Waveform(std::size_t len, T sr, InterpType it) :
+    _interptype(it), _size(0), _end(0), _channels(1), _layout(ChannelLayout::INTERLEAVED), _stride(1), _chstride(1),
+    _guard(Guard::ZEROS), _data(nullptr), _mapped(false)
   {
     alloc(len);
     memset(_data, 0, sizeof(T)*len);
@@ -36,7 +45,22 @@ namespace audioelectric {
   }
 
   template<typename T>
-  Waveform<T>::Waveform(T* data, std::size_t len, T sr, InterpType it) : _interptype(it), _data(nullptr), _size(len), _end(len-1)
+  Waveform<T>::Waveform(std::size_t len, std::size_t channels, ChannelLayout layout, T sr, InterpType it) :
+    _interptype(it), _size(0), _end(0), _channels(1), _layout(ChannelLayout::INTERLEAVED), _stride(1), _chstride(1),
+    _guard(Guard::ZEROS), _data(nullptr), _mapped(false)
+  {
+    alloc(len, channels, layout);
+    memset(_data, 0, sizeof(T)*len*channels);
+    if (sr == 0)
+      _samplerate = len;
+    else
+      _samplerate = sr;
+  }
+
+  template<typename T>
+  Waveform<T>::Waveform(T* data, std::size_t len, T sr, InterpType it) :
+    _interptype(it), _size(len), _end(len-1), _channels(1), _layout(ChannelLayout::INTERLEAVED), _stride(1),
+    _chstride(1), _guard(Guard::ZEROS), _data(nullptr), _mapped(false)
   {
     alloc(len);
     memcpy(_data, data, sizeof(T)*len);
@@ -47,7 +71,9 @@ namespace audioelectric {
   }
 
   template<typename T>
-  Waveform<T>::Waveform(std::initializer_list<T> init, T sr, InterpType it) : _interptype(it), _data(nullptr), _size(0), _end(0)
+  Waveform<T>::Waveform(std::initializer_list<T> init, T sr, InterpType it) :
+    _interptype(it), _size(0), _end(0), _channels(1), _layout(ChannelLayout::INTERLEAVED), _stride(1), _chstride(1),
+    _guard(Guard::ZEROS), _data(nullptr), _mapped(false)
   {
     alloc(init.size());
     T* p = _data;
@@ -60,8 +86,9 @@ namespace audioelectric {
   }
 
   template<typename T>
-  Waveform<T>::Waveform(std::string afile, size_t begin, size_t end, InterpType it) :
-    _interptype(it), _data(nullptr), _size(0), _end(0)
+  Waveform<T>::Waveform(std::string afile, size_t begin, size_t end, InterpType it, ChannelLayout layout, bool map) :
+    _interptype(it), _size(0), _end(0), _channels(1), _layout(ChannelLayout::INTERLEAVED), _stride(1), _chstride(1),
+    _guard(Guard::ZEROS), _data(nullptr), _mapped(false)
   {
   
     SF_INFO info;
@@ -75,13 +102,23 @@ namespace audioelectric {
       throw WaveformError("Ending frame of an audio file waveform must be greater than the beginning frame");
     else if (begin >= info.frames)
       throw WaveformError("Beginning frame was greater than the number of frames in the audio file");
-    alloc(end-begin);
+    _samplerate = info.samplerate;
+    if (map && mapFile(afile, info, begin, end, layout)) {
+      sf_close(f);
+      return;
+    }
 
-    if (info.channels == 1)
+    if (info.channels == 1) {
+      alloc(end-begin);
       readOneChannelFile(f, &info, begin, end);
-    else
-      readMultiChannelFile(f, &info, begin, end);
-    _samplerate = info.samplerate;
+    }
+    else {
+      if (layout == ChannelLayout::MIXDOWN)
+        alloc(end-begin);
+      else
+        alloc(end-begin, info.channels, layout);
+      readMultiChannelFile(f, &info, begin, end, layout);
+    }
     sf_close(f);
   }
 
@@ -111,11 +148,12 @@ namespace audioelectric {
   }
 
   template <typename T>
-  void Waveform<T>::readMultiChannelFile(SNDFILE* f, SF_INFO* info, size_t begin, size_t end)
+  void Waveform<T>::readMultiChannelFile(SNDFILE* f, SF_INFO* info, size_t begin, size_t end, ChannelLayout layout)
   {
     sf_seek(f, begin, SEEK_SET);
     T* rdbuf = new T[info->channels*RDSIZE];
     T* buf = _data;
+    size_t frame = 0;
     while (begin < end) {
       size_t toread;
       if (end - begin >= RDSIZE)
@@ -129,17 +167,31 @@ namespace audioelectric {
       else if constexpr (std::is_same<T, float>::value)
         nread = sf_readf_float(f, rdbuf, toread);
 
-      // Now, we sum (well, really we average) all of the channels
-      // TODO: write a better summing algorithm
       T* p = rdbuf;
-      for (size_t i=0; i<nread; i++) {
-        *buf = 0;
-        for (int c=0; c<info->channels; c++) {
-          *buf += *p++;
+      if (layout == ChannelLayout::INTERLEAVED) {
+        // The file is already interleaved
+        memcpy(buf, rdbuf, sizeof(T)*nread*info->channels);
+        buf += nread*info->channels;
+      }
+      else if (layout == ChannelLayout::PLANAR) {
+        for (size_t i=0; i<nread; i++) {
+          for (int c=0; c<info->channels; c++)
+            _data[c*_chstride + frame + i] = *p++;
+        }
+      }
+      else {
+        // Now, we sum (well, really we average) all of the channels
+        // TODO: write a better summing algorithm
+        for (size_t i=0; i<nread; i++) {
+          *buf = 0;
+          for (int c=0; c<info->channels; c++) {
+            *buf += *p++;
+          }
+          *buf /= info->channels;
+          buf++;
         }
-        *buf /= info->channels;
-        buf++;
       }
+      frame += nread;
       if (nread < toread) break; // This will happen if info.frames < end
       begin += nread;
     }
@@ -149,7 +201,8 @@ namespace audioelectric {
 
   template<typename T>
   Waveform<T>::Waveform(T (*generator)(size_t), size_t len, T sr, InterpType it) :
-    _interptype(it), _data(nullptr), _size(0), _end(0)
+    _interptype(it), _size(0), _end(0), _channels(1), _layout(ChannelLayout::INTERLEAVED), _stride(1), _chstride(1),
+    _guard(Guard::ZEROS), _data(nullptr), _mapped(false)
   {
     generate(generator, len);
     if (sr == 0)
@@ -160,26 +213,30 @@ namespace audioelectric {
 
   template<typename T>
   Waveform<T>::Waveform(const Waveform<T>& other, double rate, std::size_t len, InterpType it) :
-    _interptype(it), _data(nullptr), _size(0), _end(0), _samplerate(other._samplerate)
+    _interptype(it), _size(0), _end(0), _channels(1), _layout(ChannelLayout::INTERLEAVED), _stride(1), _chstride(1),
+    _guard(Guard::ZEROS), _data(nullptr), _samplerate(other._samplerate), _mapped(false)
   {
-    alloc(len);
-    auto phs = Phasor<T>(other, rate);
-    T* p = _data;
-    phs.generate(&_data, len, 1);
+    if (rate <= 0)
+      throw WaveformError("The rate of a resampled waveform must be positive");
+    alloc(len, other._channels, other._layout);
+    Resampler<T>(rate, 1).process(other, *this);
   }
 
   template <typename T>
   Waveform<T>::Waveform(const Waveform<T>& other) :
-    _interptype(other._interptype), _data(nullptr), _size(0), _end(0), _samplerate(other._samplerate)
+    _interptype(other._interptype), _size(other._size), _end(other._end), _channels(other._channels),
+    _layout(other._layout), _stride(other._stride), _chstride(other._chstride), _guard(other._guard),
+    _data(other._data), _samplerate(other._samplerate), _storage(other._storage), _mapped(other._mapped)
   {
-    alloc(other.size());
-    memcpy(_data, other._data, _size);
+    
   }
 
   template <typename T>
   Waveform<T>::Waveform(Waveform<T>&& other) :
-    _interptype(other._interptype), _data(std::exchange(other._data, nullptr)),
-    _size(std::exchange(other._size, 0)), _end(std::exchange(other._end, 0)), _samplerate(other._samplerate)
+    _interptype(other._interptype), _size(std::exchange(other._size, 0)), _end(std::exchange(other._end, 0)),
+    _channels(other._channels), _layout(other._layout), _stride(other._stride), _chstride(other._chstride),
+    _guard(other._guard), _data(std::exchange(other._data, nullptr)), _samplerate(other._samplerate),
+    _storage(std::move(other._storage)), _mapped(std::exchange(other._mapped, false))
   {
     
   }
@@ -197,83 +254,241 @@ namespace audioelectric {
     for (size_t i=0; i<len; i++) {
       _data[i] = generator(i);
     }
-  }
-
-  template<typename T>
-  T Waveform<T>::waveform(double pos, int channel) const
-  {
-    if (pos < 0 || pos > _end)
-      return 0;
-    return interpLinear(pos);
+    fillGuards();
   }
 
   template<typename T>
   Waveform<T>& Waveform<T>::operator=(const Waveform<T>& other)
   {
-    alloc(other._size);
+    if (this == &other)
+      return *this;
     _interptype = other._interptype;
-    memcpy(_data,other._data,sizeof(T)*_size);
+    _data = other._data;
+    _size = other._size;
+    _end = other._end;
+    _samplerate = other._samplerate;
+    _storage = other._storage;
+    _mapped = other._mapped;
+    _channels = other._channels;
+    _layout = other._layout;
+    _stride = other._stride;
+    _chstride = other._chstride;
+    _guard = other._guard;
     return *this;
   }
 
   template <typename T>
   Waveform<T>& Waveform<T>::operator=(Waveform<T> &&other)
   {
+    if (this == &other)
+      return *this;
+    dealloc();
     _interptype = other._interptype;
     _data = std::exchange(other._data, nullptr);
     _size = std::exchange(other._size, 0);
     _end = std::exchange(other._end, 0);
     _samplerate = other._samplerate;
+    _storage = std::move(other._storage);
+    _mapped = std::exchange(other._mapped, false);
+    _channels = other._channels;
+    _layout = other._layout;
+    _stride = other._stride;
+    _chstride = other._chstride;
+    _guard = other._guard;
     return *this;
   }
 
   template<typename T>
   typename Waveform<T>::iterator Waveform<T>::ibegin(void)
   {
+    unshare();
     return iterator(_data);
   }
 
   template<typename T>
   typename Waveform<T>::iterator Waveform<T>::iend(void)
   {
-    return iterator(_data+_size);
+    unshare();
+    return iterator(_data+_size*_channels);
   }
 
   template<typename T>
   void Waveform<T>::resize(std::size_t len) {
-    if (len == _size)
+    // Shared data is left to its other owners rather than copied, since it is about to be cleared
+    if (len == _size && !shared())
       return;
-    alloc(len);
+    alloc(len, _channels, _layout);
+  }
+
+  template<typename T>
+  void Waveform<T>::unshare(void)
+  {
+    if (!shared())
+      return;
+    T* base = new T[allocSize()];
+    memcpy(base, _data - WAVEFORM_GUARD*_stride, sizeof(T)*allocSize());
+    _storage.reset(base, std::default_delete<T[]>());
+    _data = base + WAVEFORM_GUARD*_stride;
+    _mapped = false;
+  }
+
+  template<typename T>
+  void Waveform<T>::setGuard(Guard guard)
+  {
+    _guard = guard;
+    updateGuards();
+  }
+
+  template<typename T>
+  void Waveform<T>::updateGuards(void)
+  {
+    if (!_data)
+      return;
+    unshare();
+    fillGuards();
   }
 
   /*********************** Private Waveform *******************************/
 
   template<typename T>
-  void Waveform<T>::alloc(std::size_t len)
+  void Waveform<T>::alloc(std::size_t len, std::size_t channels, ChannelLayout layout)
   {
     dealloc();
-    _data = new T[len];
     _size = len;
     _end = len-1;
+    _channels = channels;
+    _layout = layout;
+    // Each channel of a planar Waveform has its own guards
+    _stride = layout == ChannelLayout::PLANAR ? 1 : channels;
+    _chstride = layout == ChannelLayout::PLANAR ? len + 2*WAVEFORM_GUARD : 1;
+    T* base = new T[allocSize()];
+    _storage.reset(base, std::default_delete<T[]>());
+    _data = base + WAVEFORM_GUARD*_stride;
+    // The data is about to be filled, so only the guards are zeroed (wrapped guards are filled once the data is)
+    Guard guard = _guard;
+    _guard = Guard::ZEROS;
+    fillGuards();
+    _guard = guard;
+  }
+
+  template<typename T>
+  void Waveform<T>::fillGuards(void)
+  {
+    long len = _size;
+    for (size_t c=0; c<_channels; c++) {
+      T* d = _data + c*_chstride;
+      for (long g=1; g<=WAVEFORM_GUARD; g++) {
+        if (_guard == Guard::WRAPPED && len > 0) {
+          d[-g*(long)_stride] = d[((len - g%len) % len)*_stride];
+          d[(len - 1 + g)*_stride] = d[((g - 1) % len)*_stride];
+        }
+        else {
+          d[-g*(long)_stride] = 0;
+          d[(len - 1 + g)*_stride] = 0;
+        }
+      }
+    }
   }
 
   template<typename T>
   void Waveform<T>::dealloc(void)
   {
-    if (_data)
-      delete[] _data;
+    // The data itself is freed (or unmapped) along with its last reference
+    _storage.reset();
+    _data = nullptr;
+    _mapped = false;
     _size = 0;
     _end = 0;
   }
 
+  /*!\brief Finds the sample data of a WAV file
+   *
+   * \param fd          The open WAV file
+   * \param[out] offset The byte offset of the sample data
+   * \param[out] length The length of the sample data in bytes
+   * \return False if the file isn't a RIFF WAVE file or has no data chunk
+   */
+  static bool findWavData(int fd, size_t& offset, size_t& length)
+  {
+    char riff[12];
+    if (pread(fd, riff, 12, 0) != 12 || memcmp(riff, "RIFF", 4) || memcmp(riff+8, "WAVE", 4))
+      return false;
+    off_t pos = 12;
+    unsigned char chunk[8];
+    while (pread(fd, chunk, 8, pos) == 8) {
+      size_t len = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((size_t)chunk[7] << 24);
+      if (!memcmp(chunk, "data", 4)) {
+        offset = pos + 8;
+        length = len;
+        return true;
+      }
+      pos += 8 + len + (len & 1);   // Chunks are padded to an even length
+    }
+    return false;
+  }
+
   template<typename T>
-  T Waveform<T>::interpLinear(double pos) const
+  bool Waveform<T>::mapFile(const std::string& afile, const SF_INFO& info, size_t begin, size_t end,
+                            ChannelLayout layout)
   {
-    long p = pos;
-    T a = _data[p];
-    T b = _data[p+1];
-    double diff = pos - (double)p;
-    return (b-a)*diff + a;
+    // Only little-endian float samples can be used without decoding
+    if constexpr (!std::is_same<T, float>::value)
+      return false;
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    return false;
+#endif
+    int endian = info.format & SF_FORMAT_ENDMASK;
+    if ((info.format & SF_FORMAT_TYPEMASK) != SF_FORMAT_WAV || (info.format & SF_FORMAT_SUBMASK) != SF_FORMAT_FLOAT ||
+        (info.channels != 1 && layout != ChannelLayout::INTERLEAVED) ||
+        (endian != SF_ENDIAN_FILE && endian != SF_ENDIAN_LITTLE))
+      return false;
+
+    int fd = open(afile.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    size_t offset, length;
+    struct stat st;
+    long framelen = info.channels*sizeof(T);
+    char* base = (char*)MAP_FAILED;
+    long first = 0, maplen = 0;
+    if (findWavData(fd, offset, length) && offset % sizeof(T) == 0 && length >= end*framelen && fstat(fd, &st) == 0) {
+      // Only map the pages that hold the section and its guard frames. The guards may reach before the start or past
+      // the end of the file, so the whole range is reserved with anonymous (zeroed) pages first, and then the part that
+      // the file covers is mapped over them.
+      long page = sysconf(_SC_PAGESIZE);
+      long lo = offset + begin*framelen - WAVEFORM_GUARD*framelen;
+      long hi = offset + end*framelen + WAVEFORM_GUARD*framelen;
+      first = lo >= 0 ? lo / page * page : -((-lo + page - 1) / page * page);
+      maplen = (hi + page - 1) / page * page - first;
+      base = (char*)mmap(nullptr, maplen, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      long fbegin = first > 0 ? first : 0;
+      long fend = (st.st_size + page - 1) / page * page;
+      fend = fend < first + maplen ? fend : first + maplen;
+      if (base != MAP_FAILED && fend > fbegin &&
+          mmap(base + (fbegin - first), fend - fbegin, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, fbegin)
+          == MAP_FAILED) {
+        munmap(base, maplen);
+        base = (char*)MAP_FAILED;
+      }
+    }
+    close(fd);
+    if (base == MAP_FAILED)
+      return false;
+
+    dealloc();
+    _storage.reset(base, [maplen](void* p) {munmap(p, maplen);});
+    _mapped = true;
+    _data = (T*)(base + (offset + begin*framelen - first));
+    _size = end - begin;
+    _end = _size - 1;
+    _channels = info.channels;
+    _layout = ChannelLayout::INTERLEAVED;
+    _stride = _channels;
+    _chstride = 1;
+    // The mapping is private, so the guard frames (which hold whatever surrounds the section in the file) can be
+    // overwritten without touching the file
+    fillGuards();
+    return true;
   }
 
   /********************* iterator ********************/
@@ -328,6 +543,7 @@ namespace audioelectric {
       mid += 1.0;
       data[i] = norm*(exp(mid*mid/sigma_norm)-offset);
     }
+    wf.updateGuards();
   }
 
   template void GenerateGaussian<double>(Waveform<double>&, std::size_t, double);
@@ -342,6 +558,7 @@ namespace audioelectric {
     for (size_t i=0; i<len; i++) {
       data[i] = sin(i*w);
     }
+    wf.setGuard(Guard::WRAPPED);
   }
 
   template void GenerateSin<double>(Waveform<double>&, std::size_t);
@@ -361,6 +578,7 @@ namespace audioelectric {
       data[i] = i*upslope;
     for (size_t j=0; i<len; i++, j++)
       data[i] = 1.0 - j*dwnslope;
+    wf.setGuard(Guard::WRAPPED);
   }
 
   template void GenerateTriangle<double>(Waveform<double>&, std::size_t, double);
@@ -377,6 +595,7 @@ namespace audioelectric {
       data[i] = 0;
     for (size_t i=rise_time; i<len; i++)
       data[i] = 1.0;
+    wf.setGuard(Guard::WRAPPED);
   }
 
   template void GenerateSquare<double>(Waveform<double>&, std::size_t, double);
@@ -3,17 +3,31 @@
 
 #include <cstdlib>
 #include <initializer_list>
+#include <memory>
 #include <string>
 #include <exception>
 
 #include <sndfile.h>
 
+#include "interpolate.hpp"
+
+#define WAVEFORM_GUARD 8        //!< The number of guard frames before and after the data of every Waveform
+
 namespace audioelectric {
 
-  /*!\brief Different types of interpolation
+  /*!\brief How the channels of a multi-channel Waveform are stored
+   */
+  enum class ChannelLayout {
+    INTERLEAVED,        //!< The channels of each frame are next to each other, and frames follow one another
+    PLANAR,             //!< Each channel is a contiguous block of size() samples, and channels follow one another
+    MIXDOWN,            //!< Only when reading a file: the channels are averaged into a single channel
+  };
+
+  /*!\brief What the guard frames around a Waveform's data hold
    */
-  enum class InterpType {
-    LINEAR,     //!< Linear interpolation
+  enum class Guard {
+    ZEROS,      //!< Silence, for one-shot playback
+    WRAPPED,    //!< Copies of the frames at the other end of the data, for cycling over the data as one period
   };
 
   class WaveformError : public std::exception {
@@ -26,6 +40,21 @@ namespace audioelectric {
 
   /*!\brief Contains and manages a set of audio data. Useful for samples, grains or any other chunk of audio data that needs
    * needs to be stored and manipulated.
+   *
+   * A Waveform is a handle to reference-counted sample data. Copying a Waveform shares the data rather than copying it,
+   * so any number of Phasors, grains, voices and clouds (on any number of threads) can read the same samples from one
+   * copy in memory. The data is copied on write: the non-const accessors (operator[], data(), ibegin() and iend()) first
+   * give the Waveform its own copy of the data if it is shared with any other Waveform. Reading through a const
+   * Waveform never copies.
+   *
+   * A Waveform may hold several channels, stored either interleaved or planar (see ChannelLayout). Positions and sizes
+   * are always in frames, and the single-channel lookups (cyclic(), interpFixed() and waveform() with the default channel)
+   * read channel 0. frame() interpolates every channel of a frame at once.
+   *
+   * The data of every channel is padded with WAVEFORM_GUARD guard frames on each side (see Guard), so interpolation can
+   * read the neighbours of any frame without checking bounds or wrapping indices. The guards hold zeros unless they're
+   * set to wrap with setGuard(). Wrapped guards are copies, so after writing to the first or last frames of a Waveform
+   * with wrapped guards, call updateGuards().
    */
   template<typename T>
   class Waveform final {
@@ -54,6 +83,14 @@ namespace audioelectric {
      */
     Waveform(std::size_t len, T sr=0, InterpType it=InterpType::LINEAR);
 
+    /*!\brief Creates and allocates a multi-channel waveform of len frames with all values set to 0
+     *
+     * \param len      The number of frames
+     * \param channels The number of channels
+     * \param layout   How the channels are stored (INTERLEAVED or PLANAR)
+     */
+    Waveform(std::size_t len, std::size_t channels, ChannelLayout layout, T sr=0, InterpType it=InterpType::LINEAR);
+
     /*!\brief Wraps an array of size len in a Waveform to allow it to be interpolated
      */
     Waveform(T* data, std::size_t len, T sr=0, InterpType it=InterpType::LINEAR);
@@ -63,13 +100,22 @@ namespace audioelectric {
     /*!\brief Construct a waveform from a section of an audio file
      * 
      * If the audio file does not exist, or end <= begin then a WaveformError will be thrown
+     *
+     * A WAV file of 32-bit float samples can be used as is by a Waveform<float>, as long as it is mono or the layout is
+     * INTERLEAVED, so rather than being read, the section is mapped into memory (see mapped()). Pages are only read from
+     * disk as they're played, and they're shared with every other Waveform (in any process) that maps the same file. The
+     * mapping is private, so writing to the Waveform doesn't change the file, but changes made to the file while it is
+     * mapped may show up in the Waveform. Every other format is decoded and read as usual.
      * 
      * \param afile  Path to the audio file to read
      * \param begin  Beginning frame of the audio file section
      * \param end    Ending frame of the audio file section. If end==0 then read to the last frame
      * \param it     Interpolation type
+     * \param layout How to store the channels of a multi-channel file. By default, they are mixed down to one channel
+     * \param map    Whether to map the file if its format allows it. If false, the file is always read
      */
-    Waveform(std::string afile, size_t begin=0, size_t end=0, InterpType it=InterpType::LINEAR);
+    Waveform(std::string afile, size_t begin=0, size_t end=0, InterpType it=InterpType::LINEAR,
+             ChannelLayout layout=ChannelLayout::MIXDOWN, bool map=true);
 
     /*!\brief Creates a new Waveform and fills it with a generator function
      *
@@ -80,7 +126,14 @@ namespace audioelectric {
      */
     Waveform(T (*generator)(size_t), size_t len, T sr=0, InterpType it=InterpType::LINEAR);
 
-    /*!\brief Copies a sample to a new length using interpolation
+    /*!\brief Copies a sample to a new length by resampling it (see Resampler)
+     *
+     * \throw WaveformError if the rate isn't positive
+     *
+     * \param other The waveform to copy
+     * \param rate  The number of samples of other to read for each sample of the new waveform
+     * \param len   The length of the new waveform. Samples past the end of other are silent
+     * \param it    Interpolation type
      */
     Waveform(const Waveform<T>& other, double rate, std::size_t len, InterpType it=InterpType::LINEAR);
 
@@ -120,71 +173,212 @@ namespace audioelectric {
      *
      * The position is a generalized index of the samples in the waveform, such that an integer position will return
      * the same value as that returned by Waveform[], and a non-integer position will return an interpolated value as though
-     * the waveform were continuous.
+     * the waveform were continuous. The interpolation type (see setInterpType()) decides how many neighbouring samples
+     * the value depends on.
      *
      * Positions outside of the waveform -- those less than 0 and greater than the size of the waveform (in samples) -- will
      * return a value of 0. This is done so that a Waveform can be easily mixed with other Waveforms without having to worry
      * about bounds.
      *
      * \param pos The position on the waveform
-     * \param channel The channel to retrieve from (ignored for now)
+     * \param channel The channel to retrieve from
      * \return The interpolated value at pos
      */
-    T waveform(double pos, int channel=0) const;
+    T waveform(double pos, int channel=0) const {
+      if (pos < 0 || pos > _end)
+        return 0;
+      return interp(pos, channel);
+    }
+
+    /*!\brief Returns the interpolated value at a position in the waveform without checking its bounds
+     *
+     * This is waveform() without the bounds check, for readers that already keep their positions within [0,size()].
+     * Between the last frame and size(), the value is interpolated toward the first guard frame, which is zero or (with
+     * wrapped guards) the first frame.
+     *
+     * \param pos The position on the waveform, which must be within [0,size()]
+     * \param channel The channel to retrieve from
+     * \return The interpolated value at pos
+     */
+    T interp(double pos, int channel=0) const {
+      long p = pos;
+      return kernel::interpolate(_data + p*_stride + channel*_chstride, _stride, pos - (double)p, _interptype);
+    }
+
+    /*!\brief Returns the interpolated value of every channel at a position in the waveform
+     *
+     * This is the same as calling waveform() for each channel, but the position is only split into a frame and an
+     * interpolation weight once.
+     *
+     * \param pos      The position on the waveform
+     * \param[out] out The value of each channel (must hold channels() values)
+     */
+    void frame(double pos, T* out) const {
+      if (pos < 0 || pos > _end) {
+        for (size_t c=0; c<_channels; c++)
+          out[c] = 0;
+        return;
+      }
+      long p = pos;
+      const T* d = _data + p*_stride;
+      double diff = pos - (double)p;
+      for (size_t c=0; c<_channels; c++, d+=_chstride)
+        out[c] = kernel::interpolate(d, _stride, diff, _interptype);
+    }
+
+    /*!\brief Returns the interpolated value at a position in a periodic waveform
+     *
+     * The waveform is treated as one cycle of a periodic signal, so positions between the last sample and size() are
+     * interpolated back toward the first sample. The size of the waveform must be a power of two, its guards must be
+     * wrapped (see setGuard()), and pos must be non-negative.
+     *
+     * \param pos The position on the waveform
+     * \return The interpolated value at pos
+     */
+    T cyclic(double pos) const {
+      long p = pos;
+      return kernel::interpolate(_data + (p & (_size - 1))*_stride, _stride, pos - (double)p, _interptype);
+    }
+
+    /*!\brief Returns the interpolated value at a fixed-point position in the waveform
+     *
+     * This is the same interpolation as waveform(), but the position has already been split into its integer and
+     * fractional parts, so no conversion from double is needed. Like interp(), the bounds aren't checked, so the
+     * position must be within [0,size()].
+     *
+     * \param index The integer part of the position
+     * \param frac  The fractional part of the position, in [0,1)
+     * \param mask  A mask applied to the index of a power-of-two waveform with wrapped guards that is being cycled (see
+     *              cyclic()), or -1
+     * \return The interpolated value at index + frac
+     */
+    T interpFixed(long index, T frac, long mask=-1) const {
+      return kernel::interpolate(_data + (index & mask)*_stride, _stride, frac, _interptype);
+    }
 
     Waveform<T>& operator=(const Waveform<T>& other);
 
     Waveform<T>& operator=(Waveform<T>&& other);    
 
-    T& operator[](std::size_t pos) {return _data[pos];}
+    /*!\brief Returns a raw sample (for a multi-channel Waveform, samples are in the order of its layout, and the
+     * channels of a planar Waveform are separated by their guard frames)
+     */
+    T& operator[](std::size_t pos) {unshare(); return _data[pos];}
     const T& operator[](std::size_t pos) const {return _data[pos];}
 
+    /*!\brief Returns the sample of a channel in a frame
+     */
+    T& sample(std::size_t frame, std::size_t channel) {unshare(); return _data[frame*_stride + channel*_chstride];}
+    const T& sample(std::size_t frame, std::size_t channel) const {return _data[frame*_stride + channel*_chstride];}
+
     iterator ibegin(void);
     iterator iend(void);
 
-    /*!\brief Returns the number of samples in the Waveform
+    /*!\brief Returns the number of samples in the Waveform (the number of frames, for a multi-channel Waveform)
      */
     std::size_t size(void) const {return _size;}
 
+    /*!\brief Returns the number of channels
+     */
+    std::size_t channels(void) const {return _channels;}
+
+    /*!\brief Returns how the channels are stored
+     */
+    ChannelLayout layout(void) const {return _layout;}
+
+    /*!\brief Returns the distance between consecutive frames of a channel in the raw data (1 unless it's interleaved)
+     */
+    std::size_t frameStride(void) const {return _stride;}
+
+    /*!\brief Returns the distance between the channels of a frame in the raw data
+     */
+    std::size_t channelStride(void) const {return _chstride;}
+
+    /*!\brief Returns true if the number of samples is a power of two
+     *
+     * Power-of-two waveforms can be cycled with cyclic() and a bitmask rather than with fmod.
+     */
+    bool powerOfTwo(void) const {return _size > 0 && (_size & (_size-1)) == 0;}
+
+    /*!\brief Returns what the guard frames hold
+     */
+    Guard guard(void) const {return _guard;}
+
+    /*!\brief Sets what the guard frames hold and fills them
+     */
+    void setGuard(Guard guard);
+
+    /*!\brief Refills the guard frames from the data (only needed for wrapped guards, after the data has been written)
+     */
+    void updateGuards(void);
+
     /*!\brief Returns the end position of the Waveform
      */
     double end(void) const {return _end;}
 
-    /*!\brief Resizes the Waveform. All data is cleared
+    /*!\brief Resizes the Waveform to len frames, keeping the number of channels and the layout. All data is cleared
      */
     void resize(std::size_t len);
 
     /*!\brief Returns a pointer to the raw data
      */
-    T* data(void) {return _data;}
+    T* data(void) {unshare(); return _data;}
+    const T* data(void) const {return _data;}
+
+    T samplerate(void) const {return _samplerate;}
 
-    T samplerate(void) {return _samplerate;}
+    /*!\brief Returns true if the data is mapped from an audio file rather than allocated
+     */
+    bool mapped(void) const {return _mapped;}
+
+    /*!\brief Returns true if the data is shared with another Waveform
+     */
+    bool shared(void) const {return _storage.use_count() > 1;}
+
+    /*!\brief Gives the Waveform its own copy of its data, if the data is shared
+     */
+    void unshare(void);
 
   private:
 
     InterpType _interptype;     //!< The interpolation type
     size_t _size;               //!< The size of data
     size_t _end;                //!< The last index of _data
+    size_t _channels;           //!< The number of channels
+    ChannelLayout _layout;      //!< How the channels are stored
+    size_t _stride;             //!< The distance between frames in _data
+    size_t _chstride;           //!< The distance between channels in _data
+    Guard _guard;               //!< What the guard frames hold
     T* _data;                   //!< The raw data
     T _samplerate;        //!< The native samplerate of the waveform
+    std::shared_ptr<void> _storage;     //!< Owns the allocation or the mapping that _data points into
+    bool _mapped;               //!< Whether _data is mapped from an audio file
 
-    /*!\brief Allocates a data array of length len
+    /*!\brief Allocates a data array of len frames of a number of channels, along with zeroed guard frames
      */
-    void alloc(std::size_t len);
+    void alloc(std::size_t len, std::size_t channels=1, ChannelLayout layout=ChannelLayout::INTERLEAVED);
 
-    /*!\brief Deallocates _data
+    /*!\brief Releases this Waveform's reference to its data
      */
     void dealloc(void);
 
-    /*!\brief Performs a linear interpolation of the point at pos
+    /*!\brief Maps a section of an audio file into _data, if it holds 32-bit float samples in the right layout
      *
-     * If pos is <0 or >_size-1, this will always return 0
+     * \return False if the file couldn't be mapped, in which case nothing is changed
+     */
+    bool mapFile(const std::string& afile, const SF_INFO& info, size_t begin, size_t end, ChannelLayout layout);
+
+    /*!\brief Returns the number of samples in the data and its guard frames
+     */
+    size_t allocSize(void) const {return (_size + 2*WAVEFORM_GUARD)*_channels;}
+
+    /*!\brief Fills the guard frames according to _guard
      */
-    T interpLinear(double pos) const;
+    void fillGuards(void);
 
     void readOneChannelFile(SNDFILE* f, SF_INFO* info, size_t begin, size_t end);
 
-    void readMultiChannelFile(SNDFILE* f, SF_INFO* info, size_t begin, size_t end);    
+    void readMultiChannelFile(SNDFILE* f, SF_INFO* info, size_t begin, size_t end, ChannelLayout layout);
 
   };
 
@@ -0,0 +1,110 @@
+/* (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+
+#include <cmath>
+#include <complex>
+
+#include "wavetable.hpp"
+
+namespace audioelectric {
+
+  #define PI M_PI
+
+  /*!\brief An in-place radix-2 FFT of a power-of-two number of points
+   *
+   * The inverse transform is not scaled by 1/n.
+   */
+  static void fft(std::vector<std::complex<double>>& x, bool inverse)
+  {
+    size_t n = x.size();
+    // Bit-reversal permutation
+    for (size_t i=1, j=0; i<n; i++) {
+      size_t bit = n >> 1;
+      for (; j & bit; bit >>= 1)
+        j ^= bit;
+      j ^= bit;
+      if (i < j)
+        std::swap(x[i], x[j]);
+    }
+    for (size_t len=2; len<=n; len <<= 1) {
+      double ang = (inverse ? 2 : -2)*PI/len;
+      std::complex<double> wlen(cos(ang), sin(ang));
+      for (size_t i=0; i<n; i+=len) {
+        std::complex<double> w(1);
+        for (size_t j=0; j<len/2; j++) {
+          std::complex<double> u = x[i+j];
+          std::complex<double> v = x[i+j+len/2]*w;
+          x[i+j] = u + v;
+          x[i+j+len/2] = u - v;
+          w *= wlen;
+        }
+      }
+    }
+  }
+
+  template <typename T>
+  Wavetable<T>::Wavetable(const Waveform<T>& cycle)
+  {
+    build(cycle);
+  }
+
+  template <typename T>
+  void Wavetable<T>::build(const Waveform<T>& cycle)
+  {
+    if (!cycle.powerOfTwo())
+      throw WaveformError("The cycle of a Wavetable must have a power-of-two size");
+    size_t n = cycle.size();
+    size_t nlevels = 1;
+    while ((n/2) >> nlevels)
+      nlevels++;
+
+    _levels.clear();
+    _levels.reserve(nlevels);
+    _levels.emplace_back(cycle);
+    // Every level is cycled, so its guards must wrap (this only copies the cycle if its guards don't already)
+    if (cycle.guard() != Guard::WRAPPED)
+      _levels.back().setGuard(Guard::WRAPPED);
+
+    std::vector<std::complex<double>> spectrum(n);
+    for (size_t i=0; i<n; i++)
+      spectrum[i] = cycle[i];
+    fft(spectrum, false);
+
+    std::vector<std::complex<double>> bins(n);
+    for (size_t lvl=1; lvl<nlevels; lvl++) {
+      // Remove every harmonic above the level's limit, along with its negative frequency
+      size_t limit = harmonics(lvl);
+      for (size_t h=limit+1; h<n-limit; h++)
+        spectrum[h] = 0;
+      bins = spectrum;
+      fft(bins, true);
+      _levels.emplace_back(n);
+      T* data = _levels.back().data();
+      for (size_t i=0; i<n; i++)
+        data[i] = bins[i].real()/n;
+      _levels.back().setGuard(Guard::WRAPPED);
+    }
+  }
+
+  template <typename T>
+  size_t Wavetable<T>::levelFor(double rate) const
+  {
+    rate = fabs(rate);
+    if (rate <= 1)
+      return 0;
+    // The level is ceil(log2(rate)), since each level halves the harmonics
+    int exp;
+    double mant = frexp(rate, &exp);
+    size_t lvl = mant == 0.5 ? exp - 1 : exp;
+    return lvl < _levels.size() ? lvl : _levels.size() - 1;
+  }
+
+  template class Wavetable<double>;
+  template class Wavetable<float>;
+
+}  // audioelectric
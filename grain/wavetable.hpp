@@ -0,0 +1,77 @@
+/* \file wavetable.hpp
+ * \brief Defines the Wavetable class
+ *
+ * (c) AudioElectric. All rights reserved.
+ *
+ * Author:             Ayal Lutwak <alutwak@audioelectric.com>
+ * Date:               October 16, 2026
+ * Last Modified By:   Ayal Lutwak <alutwak@audioelectric.com>
+ * Last Modified Date: October 16, 2026
+ */
+#pragma once
+
+#include <vector>
+
+#include "waveform.hpp"
+
+namespace audioelectric {
+
+  /*!\brief A mipmapped, band-limited version of a single-cycle waveform
+   *
+   * A naive waveform with sharp corners (a saw, square or triangle) aliases as soon as it is played back faster than one
+   * sample per frame. A Wavetable removes that aliasing by building a pyramid of progressively band-limited copies of
+   * the cycle once, up front, and letting the reader pick the copy whose harmonics all stay below Nyquist at its rate.
+   *
+   * Level 0 is the original cycle (all of its harmonics, up to size()/2), and each level after that keeps half as many
+   * harmonics as the one before it, down to the fundamental alone. Every level has the same size as the original, so a
+   * phase into one level is a phase into all of them and a reader can switch levels without touching its phase. At a
+   * rate of r samples per frame, level(levelFor(r)) has no harmonics above Nyquist.
+   *
+   * The cycle must have a power-of-two size, and the levels are periodic in the sense of Waveform::cyclic() (their
+   * guards wrap).
+   */
+  template <typename T>
+  class Wavetable final {
+  public:
+
+    /*!\brief Creates an empty Wavetable
+     */
+    Wavetable(void) {}
+
+    /*!\brief Builds the band-limited levels of a single cycle
+     *
+     * \throw WaveformError if the cycle's size is not a power of two
+     */
+    Wavetable(const Waveform<T>& cycle);
+
+    /*!\brief Rebuilds the band-limited levels from a new cycle (see Wavetable(const Waveform<T>&))
+     */
+    void build(const Waveform<T>& cycle);
+
+    /*!\brief Returns the number of levels
+     */
+    size_t levels(void) const {return _levels.size();}
+
+    /*!\brief Returns a level. Level 0 is the original cycle
+     */
+    const Waveform<T>& level(size_t lvl) const {return _levels[lvl];}
+
+    /*!\brief Returns the highest harmonic kept in a level
+     */
+    size_t harmonics(size_t lvl) const {return (_levels[0].size()/2) >> lvl;}
+
+    /*!\brief Returns the level to read at a rate (in samples/frame) so that no harmonic is above Nyquist
+     */
+    size_t levelFor(double rate) const;
+
+    /*!\brief Returns the size of the cycle (and of every level)
+     */
+    size_t size(void) const {return _levels.empty() ? 0 : _levels[0].size();}
+
+  private:
+
+    std::vector<Waveform<T>> _levels;   //!< The band-limited copies of the cycle, from the most harmonics to the fewest
+
+  };
+
+}  // audioelectric
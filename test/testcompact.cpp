@@ -0,0 +1,63 @@
+#include <cmath>
+#include <cstdint>
+#include <gtest/gtest.h>
+
+#include "compact.hpp"
+
+using namespace audioelectric;
+
+TEST(compact, conversions) {
+  // Every 16-bit integer converts back to itself, and out-of-range samples are clipped
+  for (int s=-32768; s<32768; s++)
+    ASSERT_EQ(kernel::packInt16(kernel::unpackInt16((uint16_t)s)), (uint16_t)s) << s;
+  EXPECT_EQ(kernel::packInt16(1.f), 32767);
+  EXPECT_EQ(kernel::packInt16(-2.f), 0x8000);
+
+  // So does every half that isn't a NaN
+  for (uint32_t h=0; h<0x10000; h++) {
+    if ((h & 0x7c00) == 0x7c00 && (h & 0x3ff))
+      continue;
+    ASSERT_EQ(kernel::packHalf(kernel::unpackHalf(h)), h) << std::hex << h;
+  }
+  EXPECT_EQ(kernel::packHalf(1.f), 0x3c00);
+  EXPECT_EQ(kernel::packHalf(-2.f), 0xc000);
+  EXPECT_EQ(kernel::packHalf(65504.f), 0x7bff);
+  EXPECT_EQ(kernel::packHalf(1e6f), 0x7c00);
+  EXPECT_EQ(kernel::unpackHalf(0x0001), std::ldexp(1.f, -24));
+  EXPECT_TRUE(std::isnan(kernel::unpackHalf(kernel::packHalf(NAN))));
+  // Ties round to the even half
+  EXPECT_EQ(kernel::packHalf(1.f + std::ldexp(1.f, -11)), 0x3c00);
+  EXPECT_EQ(kernel::packHalf(1.f + 3*std::ldexp(1.f, -11)), 0x3c02);
+}
+
+TEST(compact, waveform) {
+  Waveform<float> sine;
+  GenerateSin(sine, 1024);
+  for (SampleFormat format : {SampleFormat::INT16, SampleFormat::HALF}) {
+    CompactWaveform<float> compact(sine, format);
+    EXPECT_EQ(compact.size(), sine.size());
+    EXPECT_EQ(compact.format(), format);
+    EXPECT_EQ(compact.bytes(), (sine.size() + 2*WAVEFORM_GUARD)*2);
+    EXPECT_EQ(compact.guard(), Guard::WRAPPED);
+    float tol = format == SampleFormat::INT16 ? 1.f/32768 : 1.f/2048;
+    for (double pos=0; pos<1024; pos+=0.37)
+      ASSERT_NEAR(compact.interp(pos), sine.interp(pos), tol) << "pos " << pos;
+    EXPECT_EQ(compact.waveform(-1), 0);
+    EXPECT_EQ(compact.waveform(1100), 0);
+
+    // The expanded Waveform reads back exactly the same values, guards included
+    Waveform<float> expanded = compact.expand();
+    EXPECT_EQ(expanded.guard(), Guard::WRAPPED);
+    for (double pos=0; pos<1024; pos+=0.37)
+      ASSERT_EQ(compact.interp(pos), expanded.interp(pos)) << "pos " << pos;
+  }
+
+  // Other Waveforms keep their zeroed guards
+  Waveform<double> ramp = {0.25, 0.5, 0.75};
+  CompactWaveform<double> compact(ramp);
+  EXPECT_EQ(compact.guard(), Guard::ZEROS);
+  EXPECT_EQ(compact[1], 0.5);
+  EXPECT_EQ(compact.interp(2.5), 0.375);
+
+  EXPECT_THROW(CompactWaveform<float>(Waveform<float>(10, 2, ChannelLayout::PLANAR)), WaveformError);
+}
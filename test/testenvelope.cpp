@@ -509,3 +509,26 @@ TEST(enveloope, sus_change) {
 TEST(envelope, retrigger) {
   FAIL() << "Need to implement test in which trigger is applied while envelope is running";
 }
+
+TEST(envelope, block_increment) {
+  Envelope<double> env(3, 10, 2, 5, 0.5, 5);
+  Envelope<double> check(3, 10, 2, 5, 0.5, 5);
+  env.gate(true);
+  check.gate(true);
+  for (size_t n : {1, 2, 7, 4, 13, 100}) {
+    env.increment(n);
+    for (size_t i=0; i<n; i++)
+      check.increment();
+    EXPECT_DOUBLE_EQ(env.value(), check.value()) << "after increment(" << n << ")";
+  }
+  env.gate(false);
+  check.gate(false);
+  env.increment(3);
+  for (size_t i=0; i<3; i++)
+    check.increment();
+  EXPECT_DOUBLE_EQ(env.value(), check.value());
+  EXPECT_TRUE(env);
+  env.increment(100);
+  EXPECT_FALSE(env);
+  EXPECT_EQ(env.value(), 0);
+}
@@ -47,3 +47,28 @@ TEST_F(GrainTest, basic) {
   TestGrain(1, 0.1, 1);
   TestGrain(1, 1, 0.5);
 }
+
+TEST_F(GrainTest, process) {
+  Grain<double> grain(carrier, 0.7, shape, 0.05, 0.5);
+  Grain<double> check(carrier, 0.7, shape, 0.05, 0.5);
+  double out[100] = {0};
+  grain.process(out, 100);
+  for (int i=0; i<100; i++) {
+    EXPECT_DOUBLE_EQ(out[i], check.value()) << "iter " << i;
+    check.increment();
+  }
+  EXPECT_FALSE(grain);
+}
+
+TEST_F(GrainTest, fixedPoint) {
+  Grain<double> grain(carrier, 0.7, shape, 0.05, 0.5);
+  Grain<double> check(carrier, 0.7, shape, 0.05, 0.5);
+  grain.setFixedPoint(true);
+  double out[100] = {0};
+  grain.process(out, 100);
+  for (int i=0; i<100; i++) {
+    EXPECT_NEAR(out[i], check.value(), 1e-6) << "iter " << i;
+    check.increment();
+  }
+  EXPECT_FALSE(grain);
+}
@@ -1,4 +1,6 @@
 #include <chrono>
+#include <cstring>
+#include <random>
 #include <gtest/gtest.h>
 #include <portaudio.h>
 
@@ -74,10 +76,8 @@ protected:
                           paData *data = static_cast<paData*>(graingen_data);
                           //data->graingen->applyInputs(data->density, data->length, data->freq, data->ampl);
                           float *buffer = (float*)output;
-                          for (int i=0; i<frames; i++) {
-                            buffer[i] = data->graingen->value();
-                            data->graingen->increment();
-                          }
+                          memset(buffer, 0, sizeof(float)*frames);
+                          data->graingen->process(buffer, frames);
                           return 0;
                         };
 
@@ -138,6 +138,51 @@ TEST_F(StreamingGrainGenTest, veryDenseShort) {
   runTestSuite(48000, GrainParams<float>(1000, 0.01, 440, 0.25));
 }
 
+TEST(graingen, process) {
+  Waveform<double> shape;
+  Waveform<double> carrier;
+  GenerateGaussian(shape, 4800, 0.15);
+  GenerateSin(carrier, 4800);
+  GrainParams<double> params(0.01, 480, 0.01, 0.25);
+  GrainGenerator<double> graingen(shape, carrier);
+  GrainGenerator<double> check(shape, carrier);
+  graingen.applyInputs(params);
+  check.applyInputs(params);
+
+  double out[BUFSIZE];
+  for (int b=0; b<20; b++) {
+    memset(out, 0, sizeof(out));
+    graingen.process(out, BUFSIZE);
+    for (int i=0; i<BUFSIZE; i++) {
+      EXPECT_NEAR(out[i], check.value(), 1e-12) << "block " << b << ", frame " << i;
+      check.increment();
+    }
+  }
+}
+
+TEST(graingen, processCapacity) {
+  // More grains start in each block than the pool holds, and the copies keep their events' capacity
+  Waveform<double> shape;
+  Waveform<double> carrier;
+  GenerateGaussian(shape, 4800, 0.15);
+  GenerateSin(carrier, 4800);
+  GrainParams<double> params(0.25, 480, 0.01, 0.25);
+  GrainGenerator<double> orig(shape, carrier, 4);
+  orig.applyInputs(params);
+  GrainGenerator<double> graingen(orig);
+  GrainGenerator<double> check(orig);
+
+  double out[BUFSIZE];
+  for (int b=0; b<20; b++) {
+    memset(out, 0, sizeof(out));
+    graingen.process(out, BUFSIZE);
+    for (int i=0; i<BUFSIZE; i++) {
+      EXPECT_NEAR(out[i], check.value(), 1e-12) << "block " << b << ", frame " << i;
+      check.increment();
+    }
+  }
+}
+
 class SweepingGrainGenTest : public StreamingGrainGenTest {
 
 public:
@@ -177,10 +222,8 @@ public:
                           paData *data = static_cast<paData*>(graingen_data);
                           data->graingen->applyInputs(data->params);
                           float *buffer = (float*)output;
-                          for (int i=0; i<frames; i++) {
-                            buffer[i] = data->graingen->value();
-                            data->graingen->increment();
-                          }
+                          memset(buffer, 0, sizeof(float)*frames);
+                          data->graingen->process(buffer, frames);
                           return 0;
                         };
 
@@ -245,4 +288,84 @@ TEST_F(SweepingGrainGenTest, denseLongRand) {
   runTest(48000, GrainParams<float>(100, 0.033, 440, 0.25), GrainParams<float>(0.1, 0.1, 0.1, 0.1));
 }
 
+TEST(graingen, ramp) {
+  // Ramped inputs are followed the same way by process() and by increment(), including partway through a block
+  Waveform<double> shape;
+  Waveform<double> carrier;
+  GenerateGaussian(shape, 4800, 0.15);
+  GenerateSin(carrier, 4800);
+  GrainParams<double> start(0.01, 480, 0.01, 0.25);
+  GrainParams<double> end(0.05, 240, 0.03, 0.5);
+  GrainGenerator<double> graingen(shape, carrier);
+  GrainGenerator<double> check(shape, carrier);
+  graingen.applyInputs(start);
+  check.applyInputs(start);
+  graingen.rampInputs(end, 3*BUFSIZE/2);
+  check.rampInputs(end, 3*BUFSIZE/2);
+
+  double out[BUFSIZE];
+  for (int b=0; b<20; b++) {
+    memset(out, 0, sizeof(out));
+    graingen.process(out, BUFSIZE);
+    for (int i=0; i<BUFSIZE; i++) {
+      EXPECT_NEAR(out[i], check.value(), 1e-12) << "block " << b << ", frame " << i;
+      check.increment();
+    }
+  }
+}
+
+TEST(graingen, schedule) {
+  // Changing the density reschedules the next grain, whether or not any grains have been generated yet
+  Waveform<double> shape;
+  Waveform<double> carrier;
+  GenerateGaussian(shape, 4800, 0.15);
+  GenerateSin(carrier, 4800);
+  GrainGenerator<double> graingen(shape, carrier);
+  GrainGenerator<double> check(shape, carrier);
+  double out[BUFSIZE] = {0};
+  graingen.process(out, BUFSIZE);
+  for (int i=0; i<BUFSIZE; i++)
+    check.increment();
+  EXPECT_FALSE(graingen);
+  EXPECT_FALSE(check);
+
+  GrainParams<double> params(0.02, 480, 0.01, 0.25);
+  graingen.applyInputs(params);
+  check.applyInputs(params);
+  for (int b=0; b<10; b++) {
+    memset(out, 0, sizeof(out));
+    graingen.process(out, BUFSIZE);
+    for (int i=0; i<BUFSIZE; i++) {
+      EXPECT_NEAR(out[i], check.value(), 1e-12) << "block " << b << ", frame " << i;
+      check.increment();
+    }
+  }
+  EXPECT_TRUE(graingen);
+}
 
+TEST(graingen, sparse) {
+  // Blocks that fall between sparse, short grains are skipped without losing track of the next grain
+  Waveform<double> shape;
+  Waveform<double> carrier;
+  GenerateGaussian(shape, 4800, 0.15);
+  GenerateSin(carrier, 4800);
+  GrainParams<double> params(0.0007, 0.05, 0.01, 0.25);
+  GrainGenerator<double> graingen(shape, carrier);
+  GrainGenerator<double> check(shape, carrier);
+  graingen.applyInputs(params);
+  check.applyInputs(params);
+
+  double out[BUFSIZE];
+  int idle = 0;
+  for (int b=0; b<50; b++) {
+    memset(out, 0, sizeof(out));
+    graingen.process(out, BUFSIZE);
+    idle += !graingen;
+    for (int i=0; i<BUFSIZE; i++) {
+      EXPECT_NEAR(out[i], check.value(), 1e-12) << "block " << b << ", frame " << i;
+      check.increment();
+    }
+  }
+  EXPECT_GT(idle, 10);
+  EXPECT_LT(idle, 50);
+}
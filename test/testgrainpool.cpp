@@ -0,0 +1,427 @@
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "grain.hpp"
+#include "grainpool.hpp"
+#include "grainkernel.hpp"
+#include "wavetable.hpp"
+
+using namespace audioelectric;
+
+class GrainPoolTest : public ::testing::Test {
+protected:
+
+  Waveform<double> carrier = {0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0};
+  Waveform<double> shape = {0.0, 1.0, 0.0};
+
+};
+
+TEST_F(GrainPoolTest, matchesGrains) {
+  GrainPool<double> pool(carrier, shape, 8);
+  std::vector<Grain<double>> grains;
+  double params[][3] = {{1, 0.1, 1}, {0.5, 0.25, 0.5}, {2.3, 0.05, 0.25}, {-1.7, 0.2, 1}};
+  for (auto& p : params) {
+    ASSERT_TRUE(pool.add(p[0], p[1], p[2], 2, 7));
+    grains.emplace_back(carrier, 0, shape, 0, 1);
+    grains.back().setParams(p[0], p[1], p[2], 2, 7);
+    grains.back().reset();
+  }
+  EXPECT_EQ(pool.size(), 4);
+
+  int itr = 0;
+  while (pool) {
+    double check = 0;
+    for (auto& grn : grains)
+      check += grn.value();
+    EXPECT_NEAR(pool.value(), check, 1e-12) << "iter " << itr;
+    pool.increment();
+    for (auto& grn : grains)
+      grn.increment();
+    itr++;
+  }
+  EXPECT_EQ(itr, 40) << "The pool should finish with its longest grain";
+  for (auto& grn : grains)
+    EXPECT_FALSE(grn);
+}
+
+TEST_F(GrainPoolTest, interpolation) {
+  for (InterpType it : {InterpType::CUBIC, InterpType::SINC}) {
+    Waveform<double> curve(carrier);
+    for (size_t i=0; i<curve.size(); i++)
+      curve[i] = sin(i*i/7.);
+    curve.setInterpType(it);
+    GrainPool<double> pool(curve, shape, 4);
+    std::vector<Grain<double>> grains;
+    for (double crate : {0.37, -1.3}) {
+      pool.add(crate, 0.1, 1, 2, 7);
+      grains.emplace_back(curve, 0, shape, 0, 1);
+      grains.back().setParams(crate, 0.1, 1, 2, 7);
+      grains.back().reset();
+    }
+    while (pool) {
+      double check = 0;
+      for (auto& grn : grains) {
+        check += grn.value();
+        grn.increment();
+      }
+      EXPECT_NEAR(pool.value(), check, 1e-12);
+      pool.increment();
+    }
+  }
+}
+
+TEST_F(GrainPoolTest, capacity) {
+  GrainPool<double> pool(carrier, shape, 2);
+  EXPECT_EQ(pool.capacity(), 2);
+  EXPECT_TRUE(pool.add(1, 1, 1));
+  EXPECT_TRUE(pool.add(1, 0.5, 1));
+  EXPECT_FALSE(pool.add(1, 0.5, 1)) << "A full pool should not accept any more grains";
+  EXPECT_EQ(pool.size(), 2);
+
+  // The first grain finishes after 3 increments, which should make room for another
+  for (int i=0; i<3; i++)
+    pool.increment();
+  EXPECT_EQ(pool.size(), 1);
+  EXPECT_TRUE(pool.add(1, 0.5, 1));
+  pool.clear();
+  EXPECT_FALSE(pool);
+}
+
+TEST_F(GrainPoolTest, process) {
+  GrainPool<double> pool(carrier, shape, 4);
+  GrainPool<double> check(carrier, shape, 4);
+  for (auto p : {&pool, &check}) {
+    p->add(0.7, 0.05, 0.5);
+    p->add(1.3, 0.1, 0.25);
+  }
+  double out[64] = {0};
+  pool.process(out, 64);
+  for (int i=0; i<64; i++) {
+    EXPECT_DOUBLE_EQ(out[i], check.value()) << "frame " << i;
+    check.increment();
+  }
+  EXPECT_FALSE(pool);
+}
+
+TEST_F(GrainPoolTest, processEvents) {
+  GrainPool<double> pool(carrier, shape, 8);
+  GrainPool<double> check(carrier, shape, 8);
+  pool.add(0.7, 0.05, 0.5);
+  check.add(0.7, 0.05, 0.5);
+  std::vector<GrainEvent<double>> events = {{5, 1.3, 0.1, 0.25, 0, -1}, {20, -0.6, 0.5, 1, 3, 8}, {32, 1, 1, 1, 0, -1}};
+
+  double out[32] = {0};
+  pool.process(out, 32, events);
+  for (size_t i=0; i<32; i++) {
+    for (auto& grain : events) {
+      if (grain.offset == i)
+        check.add(grain);
+    }
+    EXPECT_NEAR(out[i], check.value(), 1e-12) << "frame " << i;
+    check.increment();
+  }
+  check.add(events.back());
+  EXPECT_EQ(pool.size(), check.size());
+}
+
+TEST(grainkernel, matchesScalar) {
+  Waveform<float> carrier, carrier2;
+  Waveform<float> shape;
+  GenerateSin(carrier, 4800);
+  GenerateTriangle(carrier2, 4800, 0.8f);
+  GenerateGaussian(shape, 4800, 0.15f);
+
+  // Alternate the grains between two carriers
+  std::vector<const float*> carriers;
+  std::vector<double> cphase, sphase;
+  std::vector<float> ampl;
+  std::srand(0);
+  for (int i=0; i<101; i++) {
+    carriers.push_back(i % 3 ? carrier.data() : carrier2.data());
+    // Include phases at the very end of the waveforms, which interpolate into their guard frames
+    cphase.push_back(i % 10 ? 4799.*std::rand()/RAND_MAX : 4799.);
+    sphase.push_back(i % 7 ? 4799.*std::rand()/RAND_MAX : 4799.);
+    ampl.push_back((float)std::rand()/RAND_MAX);
+  }
+
+  for (size_t n : {0, 1, 7, 8, 9, 64, 101}) {
+    float acc[GRAIN_LANES] = {0};
+    kernel::sumGrainsScalar(acc, carriers.data(), -1, cphase.data(), shape.data(), sphase.data(), ampl.data(), 0, n);
+    float check = kernel::reduce(acc);
+    float val = sumGrains(carriers.data(), -1, cphase.data(), shape.data(), sphase.data(), ampl.data(), n);
+    EXPECT_EQ(val, check) << "with " << n << " grains";
+  }
+}
+
+TEST(grainkernel, advance) {
+  std::vector<double> cphase = {2, 3, 6.5, 4, 2.5}, crate = {1, -1.5, 1, 0.25, -1};
+  std::vector<double> front(5, 2), back(5, 7);
+  std::vector<double> sphase(5, 0), srate(5, 0.5);
+  advanceGrains(cphase.data(), crate.data(), front.data(), back.data(), sphase.data(), srate.data(), 5);
+  EXPECT_DOUBLE_EQ(cphase[0], 3);
+  EXPECT_DOUBLE_EQ(cphase[1], 6.5);
+  EXPECT_DOUBLE_EQ(cphase[2], 2.5);
+  EXPECT_DOUBLE_EQ(cphase[3], 4.25);
+  EXPECT_DOUBLE_EQ(cphase[4], 6.5);
+  for (double s : sphase)
+    EXPECT_DOUBLE_EQ(s, 0.5);
+}
+
+TEST_F(GrainPoolTest, mipmap) {
+  Waveform<float> saw;
+  Waveform<float> gauss;
+  GenerateTriangle(saw, 64, 0.8f);
+  GenerateGaussian(gauss, 200, 0.15f);
+  Wavetable<float> mip(saw);
+
+  // Each grain should read from the level that suits its carrier rate
+  GrainPool<float> pool(saw, gauss, 8);
+  pool.setMipmap(mip);
+  double rates[] = {0.5, 1.5, -3, 9};
+  for (double rate : rates)
+    ASSERT_TRUE(pool.add(rate, 1, 1));
+  float out[200] = {0};
+  pool.process(out, 200);
+
+  float check[200] = {0};
+  for (double rate : rates) {
+    Waveform<float> level = mip.level(mip.levelFor(rate));
+    GrainPool<float> single(level, gauss, 1);
+    single.add(rate, 1, 1);
+    single.process(check, 200);
+  }
+  for (int i=0; i<200; i++)
+    EXPECT_NEAR(out[i], check[i], 1e-5) << "frame " << i;
+}
+
+TEST_F(GrainPoolTest, compact) {
+  // A compact carrier renders exactly like a float carrier of its decoded samples
+  Waveform<float> gauss;
+  GenerateGaussian(gauss, 300, 0.15f);
+  for (size_t len : {512, 700}) {
+    Waveform<float> noise(len);
+    std::srand(1);
+    for (size_t i=0; i<len; i++)
+      noise[i] = 2.f*std::rand()/RAND_MAX - 1;
+    for (SampleFormat format : {SampleFormat::INT16, SampleFormat::HALF}) {
+      CompactWaveform<float> compact(noise, format);
+      GrainPool<float> pool(Waveform<float>(), gauss, 32);
+      pool.setCarrier(compact);
+      GrainPool<float> check(compact.expand(), gauss, 32);
+      for (int i=0; i<20; i++) {
+        double rate = 0.3 + 0.71*i;
+        double front = i % 3 ? 0 : 50;
+        pool.add(rate, 0.5 + 0.1*i, 0.05f*i, front);
+        check.add(rate, 0.5 + 0.1*i, 0.05f*i, front);
+      }
+      for (int i=0; i<10; i++) {
+        ASSERT_EQ(pool.value(), check.value()) << "frame " << i;
+        pool.increment();
+        check.increment();
+      }
+      float out[400] = {0}, expected[400] = {0};
+      pool.process(out, 400);
+      check.process(expected, 400);
+      for (int i=0; i<400; i++)
+        ASSERT_EQ(out[i], expected[i]) << "frame " << i;
+    }
+  }
+}
+
+TEST_F(GrainPoolTest, window) {
+  // A window renders like a table of the same window, up to the table's interpolation
+  GrainWindow window(WindowType::HANN, 2048);
+  Waveform<float> table(2048);
+  for (size_t i=0; i<table.size(); i++)
+    table[i] = window(i);
+  Waveform<float> noise(512);
+  std::srand(1);
+  for (size_t i=0; i<noise.size(); i++)
+    noise[i] = 2.f*std::rand()/RAND_MAX - 1;
+  GrainPool<float> pool(noise, Waveform<float>(), 32);
+  pool.setShape(window);
+  GrainPool<float> check(noise, table, 32);
+  for (int i=0; i<20; i++) {
+    pool.add(0.3 + 0.71*i, 3 + 0.5*i, 0.05f*i);
+    check.add(0.3 + 0.71*i, 3 + 0.5*i, 0.05f*i);
+  }
+  for (int i=0; i<10; i++) {
+    ASSERT_NEAR(pool.value(), check.value(), 1e-5) << "frame " << i;
+    pool.increment();
+    check.increment();
+  }
+  float out[1000] = {0}, expected[1000] = {0};
+  pool.process(out, 1000);
+  check.process(expected, 1000);
+  for (int i=0; i<1000; i++)
+    ASSERT_NEAR(out[i], expected[i], 1e-5) << "frame " << i;
+  EXPECT_FALSE(pool);
+
+  // Switching to a window partway through a grain picks it up at the grain's phase
+  pool.add(1, 2, 1);
+  check.add(1, 2, 1);
+  pool.process(out, 300);
+  check.process(expected, 300);
+  pool.setShape(GrainWindow(WindowType::TRAPEZOID, 2048, 0.25));
+  check.setShape(Waveform<float>([](size_t i) {return (float)GrainWindow(WindowType::TRAPEZOID, 2048, 0.25)(i);}, 2048));
+  EXPECT_NEAR(pool.value(), check.value(), 1e-5);
+}
+
+TEST_F(GrainPoolTest, sine) {
+  // A sine carrier renders like a long sine table, up to the table's interpolation
+  SineCarrier sine(4096);
+  Waveform<float> table;
+  GenerateSin(table, 4096);
+  GrainWindow window(WindowType::HANN, 1024);
+  Waveform<float> hann(1024);
+  for (size_t i=0; i<hann.size(); i++)
+    hann[i] = window(i);
+  GrainPool<float> pool(Waveform<float>(), hann, 32);
+  pool.setCarrier(sine);
+  GrainPool<float> check(table, hann, 32);
+  for (int i=0; i<20; i++) {
+    // Half of the grains cycle over part of the sine, so their rotators are restarted as they cycle
+    double front = i % 2 ? 100 : 0;
+    double back = i % 2 ? 1700.5 : -1;
+    pool.add(3.7 + 11.3*i, 0.09 + 0.01*i, 0.05f*i, front, back);
+    check.add(3.7 + 11.3*i, 0.09 + 0.01*i, 0.05f*i, front, back);
+  }
+  for (int i=0; i<10; i++) {
+    ASSERT_NEAR(pool.value(), check.value(), 1e-5) << "frame " << i;
+    pool.increment();
+    check.increment();
+  }
+  float out[2000] = {0}, expected[2000] = {0};
+  pool.process(out, 2000);
+  check.process(expected, 2000);
+  for (int i=0; i<2000; i++)
+    ASSERT_NEAR(out[i], expected[i], 1e-5) << "frame " << i;
+
+  // A long grain is renormalized along the way, with a window as well as with a table
+  pool.setShape(window);
+  check.setShape(hann);
+  pool.clear();
+  check.clear();
+  pool.add(17.1, 0.05, 1);
+  check.add(17.1, 0.05, 1);
+  for (int i=0; i<SINE_RESTART_FRAMES + 10; i++) {
+    ASSERT_NEAR(pool.value(), check.value(), 1e-5) << "frame " << i;
+    pool.increment();
+    check.increment();
+  }
+  std::fill(out, out + 2000, 0.f);
+  std::fill(expected, expected + 2000, 0.f);
+  pool.process(out, 2000);
+  check.process(expected, 2000);
+  for (int i=0; i<2000; i++)
+    ASSERT_NEAR(out[i], expected[i], 1e-5) << "frame " << i;
+  EXPECT_TRUE(pool);
+}
+
+TEST_F(GrainPoolTest, fixedPoint) {
+  // A fixed-point pool matches fixed-point grains
+  GrainPool<double> pool(carrier, shape, 8);
+  pool.setFixedPoint(true);
+  ASSERT_TRUE(pool.fixedPoint());
+  std::vector<Grain<double>> grains;
+  double params[][3] = {{1, 0.1, 1}, {0.5, 0.25, 0.5}, {2.3, 0.05, 0.25}, {-1.7, 0.2, 1}};
+  for (auto& p : params) {
+    ASSERT_TRUE(pool.add(p[0], p[1], p[2], 2, 7));
+    grains.emplace_back(carrier, 0, shape, 0, 1);
+    grains.back().setParams(p[0], p[1], p[2], 2, 7);
+    grains.back().setFixedPoint(true);
+    grains.back().reset();
+  }
+  int itr = 0;
+  while (pool) {
+    double check = 0;
+    for (auto& grn : grains)
+      check += grn.value();
+    EXPECT_NEAR(pool.value(), check, 1e-12) << "iter " << itr;
+    pool.increment();
+    for (auto& grn : grains)
+      grn.increment();
+    itr++;
+  }
+  EXPECT_EQ(itr, 40);
+
+  // The block path advances the phases just as increment() does, with and without a sine carrier
+  GrainPool<double> check(carrier, shape, 8);
+  for (bool sine : {false, true}) {
+    for (auto p : {&pool, &check}) {
+      p->clear();
+      if (sine)
+        p->setCarrier(SineCarrier(16));
+      p->setFixedPoint(true);
+      p->add(0.7, 0.01, 0.5, 2, 7);
+      p->add(1.3, 0.02, 0.25);
+    }
+    double out[256] = {0};
+    pool.process(out, 256);
+    for (int i=0; i<256; i++) {
+      EXPECT_NEAR(out[i], check.value(), 1e-12) << "when sine = " << sine << ", frame " << i;
+      check.increment();
+    }
+  }
+
+  // Over a long grain, the fixed-point carrier stays at exactly front + n*rate (mod the cycle), for the rate rounded
+  // to fixed point
+  Waveform<double> ramp(64);
+  for (size_t i=0; i<ramp.size(); i++)
+    ramp[i] = i;
+  Waveform<double> flat = {1.0, 1.0};
+  GrainPool<double> longgrain(ramp, flat, 1);
+  longgrain.setFixedPoint(true);
+  longgrain.add(0.1, 1e-6, 1, 0, 60);
+  int64_t phase = 0, rate = std::llround(0.1*PHASE_ONE), back = std::llround(60*PHASE_ONE);
+  for (long n=0; n<200000; n++) {
+    if (n % 1000 == 0) {
+      ASSERT_NEAR(longgrain.value(), phase/PHASE_ONE, 1e-12) << "frame " << n;
+    }
+    longgrain.increment();
+    if ((phase += rate) > back)
+      phase %= back;
+  }
+}
+
+TEST(GrainPoolChannels, playsChannel0) {
+  Waveform<double> shape = {1.0, 1.0, 1.0, 1.0, 1.0};
+  for (ChannelLayout layout : {ChannelLayout::INTERLEAVED, ChannelLayout::PLANAR}) {
+    // Not a power of two, whose guards the pool would wrap
+    Waveform<double> stereo(9, 2, layout);
+    for (size_t i=0; i<9; i++) {
+      stereo.sample(i, 0) = 1;
+      stereo.sample(i, 1) = -1;
+    }
+    GrainPool<double> pool(stereo, shape);
+    ASSERT_TRUE(pool.add(1, 1, 1, 0, 7));
+    for (int i=0; i<4; i++) {
+      EXPECT_DOUBLE_EQ(pool.value(), 1) << "i = " << i;
+      pool.increment();
+    }
+    pool.clear();
+    pool.setCarrier(stereo);
+    ASSERT_TRUE(pool.add(1, 1, 1, 0, 7));
+    double out[4] = {0};
+    pool.process(out, 4);
+    for (int i=0; i<4; i++)
+      EXPECT_DOUBLE_EQ(out[i], 1) << "i = " << i;
+
+    // Each output channel plays its own channel of the carrier, which the pool reads in place rather than copying
+    EXPECT_TRUE(stereo.shared());
+    const double* data = std::as_const(stereo).data();
+    pool.clear();
+    ASSERT_TRUE(pool.add(1, 1, 1, 0, 7));
+    double outs[3][4] = {{0}};
+    pool.process(outs[0], 4, 3, 4);
+    for (int i=0; i<4; i++) {
+      EXPECT_DOUBLE_EQ(outs[0][i], 1) << "i = " << i;
+      EXPECT_DOUBLE_EQ(outs[1][i], -1) << "i = " << i;
+      EXPECT_DOUBLE_EQ(outs[2][i], 1) << "i = " << i;
+    }
+    EXPECT_EQ(std::as_const(stereo).data(), data);
+  }
+}
@@ -0,0 +1,74 @@
+#include <cmath>
+#include <cstdint>
+#include <gtest/gtest.h>
+
+#include "grainrandom.hpp"
+
+using namespace audioelectric;
+
+TEST(grainrandom, philox) {
+  // The known answers of Philox4x32-10 from the Random123 distribution
+  struct {uint32_t ctr[4]; uint32_t key[2]; uint32_t out[4];} kat[] = {
+    {{0, 0, 0, 0}, {0, 0}, {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+    {{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff},
+     {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+    {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0},
+     {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+  };
+  for (auto& k : kat) {
+    uint32_t out[4];
+    Philox4x32(k.ctr, k.key, out);
+    for (int w=0; w<4; w++)
+      EXPECT_EQ(out[w], k.out[w]) << "word " << w;
+  }
+}
+
+TEST(grainrandom, blocks) {
+  // The batched (SIMD) blocks match the scalar generator, including across the 32-bit boundary of the counter
+  uint32_t key[2] = {0x12345678, 0x9abcdef0};
+  uint64_t first = 0xfffffff0ull;
+  uint64_t stream = 0x0123456789abcdefull;
+  const size_t n = 36;
+  uint32_t out[4*n];
+  PhiloxBlocks(key, first, stream, out, n);
+  for (size_t i=0; i<n; i++) {
+    uint64_t c = first + i;
+    uint32_t ctr[4] = {(uint32_t)c, (uint32_t)(c >> 32), (uint32_t)stream, (uint32_t)(stream >> 32)};
+    uint32_t block[4];
+    Philox4x32(ctr, key, block);
+    for (int w=0; w<4; w++)
+      ASSERT_EQ(out[16*(i/4) + 4*w + i%4], block[w]) << "counter " << i << ", word " << w;
+  }
+}
+
+TEST(grainrandom, values) {
+  // Seeded generators repeat themselves, streams differ, and the values cover [-1,1] evenly
+  GrainRandom<double> a(7, 1), b(7, 1), c(7, 2);
+  double sum = 0, sumsq = 0, lo = 1, hi = -1;
+  int same = 0;
+  const int n = 100000;
+  for (int i=0; i<n; i++) {
+    double x = a();
+    ASSERT_EQ(x, b());
+    same += x == c();
+    sum += x;
+    sumsq += x*x;
+    lo = x < lo ? x : lo;
+    hi = x > hi ? x : hi;
+  }
+  EXPECT_LT(same, 5);
+  EXPECT_NEAR(sum/n, 0, 0.01);
+  EXPECT_NEAR(sumsq/n, 1./3, 0.01);
+  EXPECT_GE(lo, -1);
+  EXPECT_LE(hi, 1);
+  EXPECT_LT(lo, -0.999);
+  EXPECT_GT(hi, 0.999);
+
+  // Reseeding starts the stream over
+  GrainRandom<float> f(3);
+  float first = f();
+  for (int i=0; i<RANDOM_BATCH; i++)
+    f();
+  f.seed(3);
+  EXPECT_EQ(f(), first);
+}
@@ -0,0 +1,78 @@
+#include <cmath>
+#include <gtest/gtest.h>
+
+#include "grainwindow.hpp"
+#include "waveform.hpp"
+
+using namespace audioelectric;
+
+TEST(grainwindow, shapes) {
+  GrainWindow gauss(WindowType::GAUSSIAN, 101, 0.15);
+  EXPECT_NEAR(gauss(0), 0, 1e-15);
+  EXPECT_NEAR(gauss(50), 1, 1e-15);
+  EXPECT_NEAR(gauss(100), 0, 1e-15);
+  GrainWindow hann(WindowType::HANN, 101);
+  EXPECT_NEAR(hann(25), 0.5, 1e-15);
+  EXPECT_NEAR(hann(50), 1, 1e-15);
+  GrainWindow tukey(WindowType::TUKEY, 101, 0.5);
+  EXPECT_NEAR(tukey(12.5), 0.5, 1e-15);
+  EXPECT_EQ(tukey(50), 1);
+  EXPECT_NEAR(tukey(87.5), 0.5, 1e-15);
+  GrainWindow trap(WindowType::TRAPEZOID, 101, 0.25);
+  EXPECT_NEAR(trap(12.5), 0.5, 1e-15);
+  EXPECT_EQ(trap(30), 1);
+  EXPECT_NEAR(trap(90), 0.4, 1e-15);
+  EXPECT_EQ(GrainWindow().size(), 0);
+
+  EXPECT_THROW(GrainWindow(WindowType::TUKEY, 101, 0), WaveformError);
+  EXPECT_THROW(GrainWindow(WindowType::TRAPEZOID, 101, 0.6), WaveformError);
+  EXPECT_THROW(GrainWindow(WindowType::HANN, 1), WaveformError);
+}
+
+TEST(grainwindow, recurrence) {
+  // The recurrences track the directly computed windows over a long grain, from any starting phase
+  for (WindowType type : {WindowType::GAUSSIAN, WindowType::HANN, WindowType::TUKEY, WindowType::TRAPEZOID}) {
+    GrainWindow window(type, 4096, type == WindowType::GAUSSIAN ? 0.15 : 0.3);
+    for (double start : {0., 1000.3}) {
+      double rate = 0.0137;
+      WindowState state;
+      window.start(state, start, rate);
+      size_t frames = 0;
+      for (double phase=start; phase<=window.end(); frames++) {
+        ASSERT_NEAR(window.value(state, phase), window(phase), 1e-10) << "phase " << phase;
+        phase += rate;
+        window.step(state, phase, rate);
+      }
+      EXPECT_GT(frames, 200000);
+    }
+  }
+}
+
+TEST(grainwindow, fill) {
+  // fill() matches value() and step() exactly, across the regions of the window and the restarts of the recurrence
+  for (WindowType type : {WindowType::GAUSSIAN, WindowType::HANN, WindowType::TUKEY, WindowType::TRAPEZOID}) {
+    GrainWindow window(type, 512, type == WindowType::GAUSSIAN ? 0.15 : 0.3);
+    for (double rate : {0.0937, -0.0937}) {
+      WindowState state, check;
+      double phase = rate > 0 ? 0 : window.end();
+      window.start(state, phase, rate);
+      window.start(check, phase, rate);
+      double phases[100];
+      float out[100];
+      for (int b=0; b<50; b++) {
+        for (double& p : phases) {
+          p = phase;
+          phase += rate;
+        }
+        window.fill(state, phases, phase, rate, out, 100);
+        for (int i=0; i<100; i++) {
+          ASSERT_EQ(out[i], (float)window.value(check, phases[i])) << "block " << b << ", frame " << i;
+          window.step(check, i < 99 ? phases[i+1] : phase, rate);
+        }
+      }
+      EXPECT_EQ(state.a, check.a);
+      EXPECT_EQ(state.b, check.b);
+      EXPECT_EQ(state.left, check.left);
+    }
+  }
+}
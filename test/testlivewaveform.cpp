@@ -0,0 +1,116 @@
+#include <thread>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "cloud.hpp"
+#include "grainpool.hpp"
+#include "livewaveform.hpp"
+
+using namespace audioelectric;
+
+TEST(livewaveform, write) {
+  LiveWaveform<double> live(200);
+  EXPECT_EQ(live.capacity(), 256);
+  EXPECT_EQ(live.written(), 0);
+
+  // Record a ramp in blocks that don't line up with the capacity, so that some of them wrap
+  std::vector<double> block(37);
+  double next = 0;
+  for (int b=0; b<30; b++) {
+    for (double& v : block)
+      v = next++;
+    live.write(block.data(), block.size());
+    ASSERT_EQ(live.written(), (uint64_t)next);
+    for (int d=1; d<=250 && d<=next; d++)
+      ASSERT_EQ(live.read(d), next - d) << "delay " << d << " after block " << b;
+    // Positions between frames interpolate across the wrap, through the guards
+    if (next > 200) {
+      EXPECT_DOUBLE_EQ(live.read(99.25), next - 99.25);
+    }
+  }
+  const Waveform<double>& wf = live.waveform();
+  EXPECT_EQ(wf.guard(), Guard::WRAPPED);
+  EXPECT_EQ(wf.data()[-1], wf[255]);
+  EXPECT_EQ(wf.data()[256], wf[0]);
+
+  // Writing more than the capacity keeps the end of it
+  std::vector<double> big(600);
+  for (double& v : big)
+    v = next++;
+  live.write(big.data(), big.size());
+  EXPECT_EQ(live.written(), (uint64_t)next);
+  for (int d=1; d<=256; d++)
+    ASSERT_EQ(live.read(d), next - d) << "delay " << d;
+}
+
+TEST(livewaveform, concurrent) {
+  // The capacity holds the whole recording, so the reader can check every frame it sees
+  const size_t total = 1 << 18;
+  LiveWaveform<double> live(total);
+  std::thread writer([&live, total] {
+    std::vector<double> block(64);
+    for (size_t n=0; n<total; n+=block.size()) {
+      for (size_t i=0; i<block.size(); i++)
+        block[i] = n + i;
+      live.write(block.data(), block.size());
+    }
+  });
+  Waveform<double> wf = live.waveform();
+  uint64_t head = 0;
+  while (head < total) {
+    head = live.written();
+    for (uint64_t d=1; d<=64 && d<=head; d++)
+      ASSERT_EQ(std::as_const(wf)[(head - d) & (total - 1)], head - d);
+  }
+  writer.join();
+}
+
+TEST(livewaveform, grains) {
+  // A grain that starts behind the write head reads what was recorded there, and keeps reading across the wrap
+  LiveWaveform<float> live(64);
+  std::vector<float> ramp(100);
+  for (size_t i=0; i<ramp.size(); i++)
+    ramp[i] = i;
+  live.write(ramp.data(), ramp.size());
+  Waveform<float> shape = {1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f, 1.f};
+  GrainPool<float> pool(live.waveform(), shape, 4);
+  ASSERT_TRUE(pool.add(1, 1, 1, 0, -1, live.phase(40)));
+  for (int i=0; i<10; i++) {
+    EXPECT_EQ(pool.value(), 60 + i) << "frame " << i;
+    pool.increment();
+  }
+}
+
+TEST(livewaveform, cloud) {
+  // A Cloud granulating its input plays it delay frames late. The input is silent until frame 1024, so the output must
+  // stay silent until frame 1024 + delay, even though the grains start all along the recording.
+  const size_t fs = 48000;
+  const size_t block = 64;
+  const size_t delay = 256;
+  LiveWaveform<float> live(4096, fs);
+  Cloud<float> cloud(fs, 1, Shape::Hann, Carrier::Saw);
+  cloud.setCarrier(live, delay);
+  cloud.params().density = 0.01;
+  cloud.params().length = 0.002;
+  cloud.startNote(1, 0);
+
+  std::vector<float> in(block), out(block);
+  bool sound = false;
+  for (size_t b=0; b<64; b++) {
+    for (size_t n=0; n<block; n++)
+      in[n] = b*block + n < 1024 ? 0 : 1;
+    live.write(in.data(), block);
+    cloud.process(out.data(), block);
+    for (size_t n=0; n<block; n++) {
+      size_t frame = b*block + n;
+      if (frame < 1024 + delay)
+        ASSERT_EQ(out[n], 0) << "frame " << frame;
+      else
+        sound |= out[n] != 0;
+      // Hann windows over an input of 0s and 1s are never negative
+      ASSERT_GE(out[n], 0) << "frame " << frame;
+    }
+  }
+  EXPECT_TRUE(sound);
+}
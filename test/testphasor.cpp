@@ -130,3 +130,137 @@ TEST_F(PhasorTest, basic) {
   testPhasor(-1.2864, 0.1);
   testVariableRatePhasor();
 }
+
+TEST_F(PhasorTest, process) {
+  // Each way of reading (bounded, periodic, and both in fixed point) matches value() and increment()
+  Waveform<double> periodic = {0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0};
+  for (Waveform<double>* w : {&wt, &periodic}) {
+    for (bool fixed : {false, true}) {
+      for (double rate : {0.5, 1.2864, -0.3428, 0.0}) {
+        for (bool cycle : {false, true}) {
+          auto phs = Phasor<double>(*w, rate, cycle, rate >= 0 ? 0 : 7);
+          phs.setFixedPoint(fixed);
+          auto check = phs;
+          double out[32];
+          for (int b=0; b<4; b++) {
+            phs.process(out, 32);
+            for (int i=0; i<32; i++) {
+              EXPECT_DOUBLE_EQ(out[i], check.value())
+                << "when rate = " << rate << ", cycle = " << cycle << " and fixed = " << fixed << ", i = " << b*32+i;
+              check.increment();
+            }
+          }
+          EXPECT_EQ(phs.getPhase(), check.getPhase());
+          EXPECT_EQ((bool)phs, (bool)check);
+        }
+      }
+    }
+  }
+}
+
+TEST(PhasorPeriodic, wrapsWithMask) {
+  Waveform<double> wt = {0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0};
+  ASSERT_TRUE(wt.powerOfTwo());
+  for (double rate : {0.75, 3.5, -0.75, -9.25}) {
+    auto phs = Phasor<double>(wt, rate, true, 0);
+    double phase = 0;
+    for (int i=0; i<64; i++) {
+      ASSERT_TRUE(phs);
+      // The last sample interpolates back to the first, so the period is the full table length
+      double whole = std::floor(phase);
+      double frac = phase - whole;
+      int idx = (int)whole;
+      double expected = wt[idx]*(1-frac) + wt[(idx+1)%8]*frac;
+      EXPECT_NEAR(phs.value(), expected, 1e-12) << "when rate = " << rate << ", i = " << i;
+      phs.increment();
+      phase = std::fmod(phase + rate, 8.);
+      if (phase < 0)
+        phase += 8.;
+    }
+  }
+}
+
+TEST_F(PhasorTest, fixedPoint) {
+  Waveform<double> periodic = {0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0};
+  for (Waveform<double>* w : {&wt, &periodic}) {
+    for (double rate : {0.5, 1.2864, -0.3428, 3.75}) {
+      for (bool cycle : {false, true}) {
+        auto phs = Phasor<double>(*w, rate, cycle, rate > 0 ? 0 : 7);
+        auto fixed = phs;
+        fixed.setFixedPoint(true);
+        ASSERT_TRUE(fixed.fixedPoint());
+        for (int i=0; i<200; i++) {
+          EXPECT_EQ((bool)phs, (bool)fixed) << "when rate = " << rate << " and cycle = " << cycle << ", i = " << i;
+          EXPECT_NEAR(phs.value(), fixed.value(), 1e-6)
+            << "when rate = " << rate << " and cycle = " << cycle << ", i = " << i;
+          EXPECT_NEAR(phs.getPhase(), fixed.getPhase(), 1e-6);
+          phs.increment();
+          fixed.increment();
+        }
+      }
+    }
+  }
+}
+
+TEST(PhasorFixedPoint, copyFinished) {
+  Waveform<double> wf(100);
+  auto phs = Phasor<double>(wf, 7.0);
+  phs.setFixedPoint(true);
+  for (int i=0; i<20; i++)
+    phs.increment();
+  ASSERT_FALSE(phs);
+  // The copy must not check the (stale) floating-point phase
+  Phasor<double> copy(phs);
+  EXPECT_FALSE(copy);
+  EXPECT_EQ(copy.value(), 0);
+}
+
+TEST(PhasorAssign, differentLengths) {
+  Waveform<double> shortwf(10), longwf(1000);
+  for (size_t i=0; i<longwf.size(); i++) {
+    longwf[i] = i;
+    if (i < shortwf.size())
+      shortwf[i] = -(double)i;
+  }
+  for (bool cycle : {false, true}) {
+    auto a = Phasor<double>(shortwf, 0.75, cycle);
+    auto b = Phasor<double>(longwf, 0.75);
+    b = a;
+    // b takes a's front and back as well as its waveform, so it stays within the shorter waveform
+    auto check = a;
+    for (int i=0; i<500; i++) {
+      ASSERT_EQ((bool)b, (bool)check) << "when cycle = " << cycle << ", i = " << i;
+      EXPECT_EQ(b.value(), check.value()) << "when cycle = " << cycle << ", i = " << i;
+      b.increment();
+      check.increment();
+    }
+    EXPECT_EQ((bool)b, cycle);
+  }
+}
+
+TEST_F(PhasorTest, sharesWaveform) {
+  // Setting a Phasor's waveform shares it rather than overwriting the waveform the Phasor was built on
+  Waveform<double> other = {9.0, 8.0, 7.0};
+  auto phs = Phasor<double>(wt, 1);
+  phs.setWaveform(other);
+  EXPECT_EQ(phs.value(), 9.0);
+  EXPECT_EQ(wt.size(), 10);
+  EXPECT_EQ(wt[0], 0.0);
+}
+
+TEST(PhasorGenerate, multichannel) {
+  Waveform<double> wf(8, 2, ChannelLayout::PLANAR);
+  for (size_t i=0; i<8; i++) {
+    wf.sample(i, 0) = i;
+    wf.sample(i, 1) = -(double)i;
+  }
+  auto phs = Phasor<double>(wf, 0.75);
+  double left[8], right[8], third[8];
+  double* outputs[] = {left, right, third};
+  phs.generate(outputs, 8, 3);
+  for (int i=0; i<8; i++) {
+    EXPECT_DOUBLE_EQ(left[i], 0.75*i);
+    EXPECT_DOUBLE_EQ(right[i], -0.75*i);
+    EXPECT_DOUBLE_EQ(third[i], left[i]);
+  }
+}
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "cloud.hpp"
+#include "renderpool.hpp"
+
+using namespace audioelectric;
+
+TEST(renderpool, tasks) {
+  // Every task runs exactly once, however the number of tasks compares to the number of threads
+  RenderPool pool(4);
+  EXPECT_EQ(pool.threads(), 4u);
+  for (size_t n : {0, 1, 2, 3, 4, 5, 16, 100}) {
+    for (int rep=0; rep<50; rep++) {
+      std::vector<std::atomic<int>> counts(n);
+      for (auto& count : counts)
+        count = 0;
+      pool.run(n, [&](size_t i) {counts[i]++;});
+      for (size_t i=0; i<n; i++)
+        ASSERT_EQ(counts[i].load(), 1) << "task " << i << " of " << n;
+    }
+  }
+}
+
+TEST(renderpool, cloud) {
+  // A Cloud that renders its voices on several threads puts out exactly what one that renders them on one thread does
+  const size_t fs = 48000;
+  const size_t block = 256;
+  Cloud<float> serial(fs, 8, Shape::Hann, Carrier::Saw);
+  Cloud<float> parallel(fs, 8, Shape::Hann, Carrier::Saw);
+  parallel.setThreads(4);
+  for (auto* cloud : {&serial, &parallel}) {
+    cloud->params().density = 200;
+    cloud->params().length = 0.01;
+    cloud->rand().density = 0.5;
+    cloud->rand().freq = 0.01;
+    cloud->setSeed(7);
+  }
+
+  std::vector<float> expected(block), actual(block);
+  bool sound = false;
+  for (int b=0; b<100; b++) {
+    if (b < 8) {
+      serial.startNote(110*(b + 1), 0.5);
+      parallel.startNote(110*(b + 1), 0.5);
+    }
+    else if (b == 50) {
+      for (int note=0; note<8; note++) {
+        serial.releaseNote(110*(note + 1));
+        parallel.releaseNote(110*(note + 1));
+      }
+    }
+    serial.process(expected.data(), block);
+    parallel.process(actual.data(), block);
+    for (size_t n=0; n<block; n++) {
+      ASSERT_EQ(actual[n], expected[n]) << "block " << b << ", frame " << n;
+      sound |= expected[n] != 0;
+    }
+  }
+  EXPECT_TRUE(sound);
+}
+
+TEST(renderpool, blockSize) {
+  // A block that's longer than a Cloud's block buffers is rendered in pieces, just as if it had been passed in pieces
+  const size_t fs = 48000;
+  const size_t block = 256;
+  const size_t piece = 100;
+  Cloud<float> pieces(fs, 4, Shape::Hann, Carrier::Saw);
+  Cloud<float> whole(fs, 4, Shape::Hann, Carrier::Saw);
+  whole.setMaxBlockSize(piece);
+  whole.setThreads(2);
+  for (auto* cloud : {&pieces, &whole}) {
+    cloud->params().density = 200;
+    cloud->params().length = 0.01;
+    cloud->rand().density = 0.5;
+    cloud->setSeed(3);
+    for (int note=0; note<4; note++)
+      cloud->startNote(110*(note + 1), 0.5);
+  }
+
+  std::vector<float> expected(block), actual(block);
+  bool sound = false;
+  for (int b=0; b<20; b++) {
+    for (size_t n=0; n<block; n+=piece)
+      pieces.process(expected.data() + n, std::min(piece, block - n));
+    whole.process(actual.data(), block);
+    for (size_t n=0; n<block; n++) {
+      ASSERT_EQ(actual[n], expected[n]) << "block " << b << ", frame " << n;
+      sound |= expected[n] != 0;
+    }
+  }
+  EXPECT_TRUE(sound);
+}
+
+TEST(renderpool, stereo) {
+  // A stereo file carrier plays each of its channels to its own output, and a single output plays its channel 0. Its
+  // channels are the same whether they're kept planar or interleaved, and mixing them down plays their average.
+  const size_t fs = 44100;
+  const size_t block = 256;
+  Cloud<double> planar(fs, 4, Shape::Hann, "testfilestereo.wav", 20000, 60000);
+  Cloud<double> interleaved(fs, 4, Shape::Hann, Carrier::Saw);
+  Cloud<double> mono(fs, 4, Shape::Hann, "testfilestereo.wav", 20000, 60000);
+  Cloud<double> mixdown(fs, 4, Shape::Hann, Carrier::Saw);
+  interleaved.setCarrier("testfilestereo.wav", 20000, 60000, InterpType::LINEAR, ChannelLayout::INTERLEAVED);
+  mixdown.setCarrier("testfilestereo.wav", 20000, 60000, InterpType::LINEAR, ChannelLayout::MIXDOWN);
+  planar.setThreads(2);
+  for (auto* cloud : {&planar, &interleaved, &mono, &mixdown}) {
+    cloud->params().density = 200;
+    cloud->params().length = 0.01;
+    cloud->rand().density = 0.5;
+    cloud->setSeed(5);
+    for (int note=0; note<4; note++)
+      cloud->startNote(0.5*(note + 1), 0.5);
+  }
+
+  std::vector<double> left(block), right(block), ileft(block), iright(block), first(block), mixed(block);
+  double* outputs[] = {left.data(), right.data()};
+  double* ioutputs[] = {ileft.data(), iright.data()};
+  bool stereo = false;
+  for (int b=0; b<20; b++) {
+    planar.process(outputs, 2, block);
+    interleaved.process(ioutputs, 2, block);
+    mono.process(first.data(), block);
+    mixdown.process(mixed.data(), block);
+    for (size_t n=0; n<block; n++) {
+      ASSERT_EQ(first[n], left[n]) << "block " << b << ", frame " << n;
+      ASSERT_NEAR(ileft[n], left[n], 1e-12) << "block " << b << ", frame " << n;
+      ASSERT_NEAR(iright[n], right[n], 1e-12) << "block " << b << ", frame " << n;
+      ASSERT_NEAR(mixed[n], (left[n] + right[n])/2, 1e-6) << "block " << b << ", frame " << n;
+      stereo |= left[n] != right[n];
+    }
+  }
+  EXPECT_TRUE(stereo);
+}
@@ -0,0 +1,184 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <sys/stat.h>
+#include <utime.h>
+
+#include "resample.hpp"
+
+using namespace audioelectric;
+
+/*!\brief Returns the largest difference between a Waveform and a sine of a frequency, away from its ends
+ */
+static double sineError(const Waveform<double>& wf, double freq, double fs)
+{
+  double err = 0;
+  for (size_t i=100; i<wf.size()-100; i++)
+    err = std::max(err, std::abs(wf[i] - sin(2*M_PI*freq*i/fs)));
+  return err;
+}
+
+TEST(resample, upsample) {
+  Waveform<double> in(44100, 44100.);
+  for (size_t i=0; i<in.size(); i++)
+    in[i] = sin(2*M_PI*1000*i/44100);
+  Resampler<double> rs(44100, 48000);
+  EXPECT_DOUBLE_EQ(rs.ratio(), 44100./48000);
+  Waveform<double> out = rs.process(in);
+  EXPECT_EQ(out.size(), rs.length(in.size()));
+  EXPECT_EQ(out.size(), 47999);
+  EXPECT_DOUBLE_EQ(out.samplerate(), 48000);
+  EXPECT_LT(sineError(out, 1000, 48000), 1e-4);
+}
+
+TEST(resample, downsampleFilters) {
+  // A tone above the output's Nyquist frequency is removed rather than aliased
+  Waveform<double> in(48000, 48000.);
+  for (size_t i=0; i<in.size(); i++)
+    in[i] = sin(2*M_PI*1000*i/48000) + sin(2*M_PI*15000*i/48000);
+  Waveform<double> out = Resampler<double>(48000, 22050).process(in);
+  EXPECT_LT(sineError(out, 1000, 22050), 1e-3);
+}
+
+TEST(resample, threads) {
+  Waveform<float> in(100000, 2, ChannelLayout::PLANAR, 44100.f);
+  std::srand(0);
+  for (size_t i=0; i<in.size(); i++) {
+    in.sample(i, 0) = (float)std::rand()/RAND_MAX;
+    in.sample(i, 1) = -(float)std::rand()/RAND_MAX;
+  }
+  Resampler<float> rs(44100, 96000);
+  Waveform<float> one = rs.process(in, 1);
+  Waveform<float> many = rs.process(in, 4);
+  ASSERT_EQ(one.size(), many.size());
+  EXPECT_EQ(many.channels(), 2);
+  EXPECT_EQ(many.layout(), ChannelLayout::PLANAR);
+  for (size_t i=0; i<one.size(); i++) {
+    ASSERT_EQ(one.sample(i, 0), many.sample(i, 0)) << "frame " << i;
+    ASSERT_EQ(one.sample(i, 1), many.sample(i, 1)) << "frame " << i;
+  }
+}
+
+TEST(resample, constructor) {
+  Waveform<double> in(1000);
+  for (size_t i=0; i<in.size(); i++)
+    in[i] = sin(2*M_PI*i/100);
+  // Reading every other sample halves the length and doubles the frequency
+  Waveform<double> out(in, 2, 600);
+  ASSERT_EQ(out.size(), 600);
+  for (size_t i=50; i<450; i++)
+    EXPECT_NEAR(out[i], sin(2*M_PI*i/50), 1e-3) << "frame " << i;
+  for (size_t i=520; i<600; i++)
+    EXPECT_NEAR(out[i], 0, 1e-12) << "frame " << i;
+  EXPECT_THROW(Waveform<double>(in, 0, 10), WaveformError);
+}
+
+TEST(resample, load) {
+  std::string cache = "testresample_cache";
+  SetResampleCache(cache);
+  SF_INFO info{};
+  info.samplerate = 44100;
+  info.channels = 1;
+  info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+  SNDFILE* sf = sf_open("testresample.wav", SFM_WRITE, &info);
+  ASSERT_NE(sf, nullptr);
+  std::vector<float> frames(44100);
+  for (size_t i=0; i<frames.size(); i++)
+    frames[i] = sin(2*M_PI*440*i/44100);
+  sf_writef_float(sf, frames.data(), frames.size());
+  sf_close(sf);
+
+  {
+    // A file at the requested rate is loaded as is
+    Waveform<float> same = LoadWaveform<float>("testresample.wav", 44100);
+    EXPECT_EQ(same.size(), 44100);
+
+    Waveform<float> first = LoadWaveform<float>("testresample.wav", 48000);
+    EXPECT_EQ(first.samplerate(), 48000);
+    EXPECT_EQ(first.size(), Resampler<float>(44100, 48000).length(44100));
+    EXPECT_FALSE(first.mapped());
+
+    // The second load reads (and maps) the cached conversion
+    Waveform<float> second = LoadWaveform<float>("testresample.wav", 48000);
+    EXPECT_TRUE(second.mapped());
+    ASSERT_EQ(second.size(), first.size());
+    for (size_t i=0; i<first.size(); i++)
+      ASSERT_EQ(second[i], first[i]) << "frame " << i;
+
+    // Doubles are cached separately
+    Waveform<double> dbl = LoadWaveform<double>("testresample.wav", 48000);
+    Waveform<double> dbl2 = LoadWaveform<double>("testresample.wav", 48000);
+    for (size_t i=0; i<dbl.size(); i++)
+      ASSERT_EQ(dbl[i], dbl2[i]) << "frame " << i;
+
+    // Rewriting the file (even at the same size) misses the cache
+    for (size_t i=0; i<frames.size(); i++)
+      frames[i] = sin(2*M_PI*660*i/44100);
+    sf = sf_open("testresample.wav", SFM_WRITE, &info);
+    ASSERT_NE(sf, nullptr);
+    sf_writef_float(sf, frames.data(), frames.size());
+    sf_close(sf);
+    Waveform<float> rewritten = LoadWaveform<float>("testresample.wav", 48000);
+    EXPECT_FALSE(rewritten.mapped());
+    ASSERT_EQ(rewritten.size(), first.size());
+    bool differs = false;
+    for (size_t i=0; i<first.size(); i++)
+      differs |= rewritten[i] != first[i];
+    EXPECT_TRUE(differs);
+
+    // So does changing a single frame in the middle of the file, even if its modification time is put back
+    struct stat st;
+    ASSERT_EQ(stat("testresample.wav", &st), 0);
+    frames[22050] = 0.5f;
+    sf = sf_open("testresample.wav", SFM_WRITE, &info);
+    ASSERT_NE(sf, nullptr);
+    sf_writef_float(sf, frames.data(), frames.size());
+    sf_close(sf);
+    struct utimbuf times = {st.st_atime, st.st_mtime};
+    ASSERT_EQ(utime("testresample.wav", &times), 0);
+    Waveform<float> edited = LoadWaveform<float>("testresample.wav", 48000);
+    EXPECT_FALSE(edited.mapped());
+  }
+  std::remove("testresample.wav");
+  std::system(("rm -rf " + cache).c_str());
+}
+
+TEST(resample, concurrentCache) {
+  // Threads that convert the same section at once each write the cache file under their own temporary name
+  std::string cache = "testresample_cache";
+  SetResampleCache(cache);
+  SF_INFO info{};
+  info.samplerate = 44100;
+  info.channels = 1;
+  info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+  SNDFILE* sf = sf_open("testresample.wav", SFM_WRITE, &info);
+  ASSERT_NE(sf, nullptr);
+  std::vector<float> frames(44100);
+  for (size_t i=0; i<frames.size(); i++)
+    frames[i] = sin(2*M_PI*440*i/44100);
+  sf_writef_float(sf, frames.data(), frames.size());
+  sf_close(sf);
+
+  {
+    std::vector<Waveform<float>> loaded(8);
+    std::vector<std::thread> threads;
+    for (auto& wf : loaded)
+      threads.emplace_back([&wf] {wf = LoadWaveform<float>("testresample.wav", 48000);});
+    for (auto& t : threads)
+      t.join();
+    Waveform<float> cached = LoadWaveform<float>("testresample.wav", 48000);
+    EXPECT_TRUE(cached.mapped());
+    for (auto& wf : loaded) {
+      ASSERT_EQ(wf.size(), cached.size());
+      for (size_t i=0; i<wf.size(); i++)
+        ASSERT_EQ(wf[i], cached[i]) << "frame " << i;
+    }
+  }
+  std::remove("testresample.wav");
+  std::system(("rm -rf " + cache).c_str());
+}
@@ -0,0 +1,134 @@
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "resample.hpp"
+#include "samplelibrary.hpp"
+
+using namespace audioelectric;
+
+/*!\brief Writes a mono WAV file of a ramp, and removes it when the test is done
+ */
+class SampleLibraryTest : public ::testing::Test {
+protected:
+
+  std::string afile = "testsamplelibrary.wav";
+
+  void SetUp(void) override {
+    SF_INFO info = {0};
+    info.samplerate = 44100;
+    info.channels = 1;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+    SNDFILE* sf = sf_open(afile.c_str(), SFM_WRITE, &info);
+    ASSERT_NE(sf, nullptr);
+    std::vector<float> frames(1000);
+    for (size_t i=0; i<frames.size(); i++)
+      frames[i] = (float)i/frames.size();
+    sf_writef_float(sf, frames.data(), frames.size());
+    sf_close(sf);
+  }
+
+  void TearDown(void) override {
+    std::remove(afile.c_str());
+  }
+
+};
+
+/*!\brief Returns the address of a Waveform's samples, without copying them
+ */
+static const float* samples(const Waveform<float>& wf)
+{
+  return wf.data();
+}
+
+TEST_F(SampleLibraryTest, shares) {
+  SampleLibrary<float> lib;
+  Waveform<float> a = lib.load(afile, 100, 500);
+  Waveform<float> b = lib.load(afile, 100, 500, 0, InterpType::SINC);
+  Waveform<float> c = lib.load(afile, 200, 500);
+  EXPECT_EQ(samples(a), samples(b));
+  EXPECT_NE(samples(a), samples(c));
+  EXPECT_EQ(std::as_const(a)[0], std::as_const(b)[0]);
+  EXPECT_EQ(a.getInterpType(), InterpType::LINEAR);
+  EXPECT_EQ(b.getInterpType(), InterpType::SINC);
+  EXPECT_EQ(lib.size(), 2);
+  EXPECT_EQ(lib.usage(), (a.size() + c.size())*sizeof(float));
+
+  // Writing to a handle gives it its own copy, and leaves the library's alone
+  b[0] = 5;
+  EXPECT_NE(samples(a), samples(b));
+  EXPECT_EQ(samples(lib.load(afile, 100, 500)), samples(a));
+  EXPECT_NE(std::as_const(a)[0], 5);
+}
+
+TEST_F(SampleLibraryTest, evicts) {
+  // Room for two 200-frame sections
+  SampleLibrary<float> lib(400*sizeof(float));
+  const float* first = samples(lib.load(afile, 0, 200));
+  lib.load(afile, 200, 400);
+  EXPECT_EQ(lib.size(), 2);
+
+  // Requesting the first section makes the second one the least recently requested, so a third evicts the second
+  EXPECT_EQ(samples(lib.load(afile, 0, 200)), first);
+  lib.load(afile, 400, 600);
+  EXPECT_EQ(lib.size(), 2);
+  EXPECT_EQ(lib.usage(), 400*sizeof(float));
+  EXPECT_EQ(samples(lib.load(afile, 0, 200)), first);
+
+  // Sections in use are never evicted, even over budget
+  {
+    Waveform<float> a = lib.load(afile, 0, 300);
+    Waveform<float> b = lib.load(afile, 300, 600);
+    EXPECT_EQ(lib.size(), 2);
+    EXPECT_GT(lib.usage(), lib.budget());
+  }
+  lib.trim();
+  EXPECT_LE(lib.usage(), lib.budget());
+
+  lib.setBudget(0);
+  EXPECT_EQ(lib.size(), 0);
+  EXPECT_EQ(lib.usage(), 0);
+}
+
+TEST_F(SampleLibraryTest, powerOfTwo) {
+  // Cycled power-of-two sections are wrapped by the library, so players that cycle over them don't copy them
+  SampleLibrary<float> lib;
+  Waveform<float> a = lib.load(afile, 0, 256, 0, InterpType::LINEAR, ChannelLayout::MIXDOWN, true);
+  EXPECT_EQ(a.guard(), Guard::WRAPPED);
+  EXPECT_EQ(samples(a)[-1], samples(a)[255]);
+
+  // One-shot sections keep their zero guards, and are kept apart from the cycled ones
+  Waveform<float> b = lib.load(afile, 0, 256);
+  EXPECT_EQ(b.guard(), Guard::ZEROS);
+  EXPECT_EQ(samples(b)[-1], 0);
+  EXPECT_EQ(samples(b)[256], 0);
+  EXPECT_EQ(lib.size(), 2);
+  EXPECT_EQ(a.guard(), Guard::WRAPPED);
+}
+
+TEST_F(SampleLibraryTest, errors) {
+  SampleLibrary<float> lib;
+  EXPECT_THROW(lib.load("nonexistent.wav"), WaveformError);
+  EXPECT_EQ(lib.size(), 0);
+  EXPECT_EQ(lib.usage(), 0);
+}
+
+TEST_F(SampleLibraryTest, threads) {
+  // Every thread asks for a conversion at once, and only one of them does it (without caching it on disk)
+  std::string cache = ResampleCache();
+  SetResampleCache("");
+  SampleLibrary<float> lib;
+  std::vector<const float*> loaded(8);
+  std::vector<std::thread> threads;
+  for (size_t t=0; t<loaded.size(); t++)
+    threads.emplace_back([&, t] {loaded[t] = samples(lib.load(afile, 0, 1000, 48000.f));});
+  for (auto& thread : threads)
+    thread.join();
+  EXPECT_EQ(lib.size(), 1);
+  for (size_t t=1; t<loaded.size(); t++)
+    EXPECT_EQ(loaded[t], loaded[0]);
+  SetResampleCache(cache);
+}
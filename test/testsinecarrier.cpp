@@ -0,0 +1,40 @@
+#include <cmath>
+#include <gtest/gtest.h>
+
+#include "sinecarrier.hpp"
+#include "grainkernel.hpp"
+#include "waveform.hpp"
+
+using namespace audioelectric;
+
+TEST(sinecarrier, values) {
+  SineCarrier sine(400);
+  EXPECT_EQ(sine.size(), 400);
+  EXPECT_EQ(sine.end(), 399);
+  EXPECT_NEAR(sine(0), 0, 1e-15);
+  EXPECT_NEAR(sine(100), 1, 1e-15);
+  EXPECT_NEAR(sine(300), -1, 1e-15);
+  EXPECT_NEAR(sine(450), sine(50), 1e-14);
+  EXPECT_EQ(SineCarrier().size(), 0);
+  EXPECT_THROW(SineCarrier(1), WaveformError);
+}
+
+TEST(sinecarrier, rotate) {
+  // Rotating every grain together tracks the directly computed sines, whatever the SIMD lanes
+  SineCarrier sine(4096);
+  const size_t n = 11;
+  double re[n], im[n], dre[n], dim[n], phase[n], rate[n];
+  for (size_t i=0; i<n; i++) {
+    phase[i] = 37.3*i;
+    rate[i] = 0.5 + 3.1*i;
+    sine.start(phase[i], rate[i], re[i], im[i], dre[i], dim[i]);
+  }
+  for (int f=0; f<SINE_RESTART_FRAMES; f++) {
+    rotateGrains(re, im, dre, dim, n);
+    for (size_t i=0; i<n; i++) {
+      phase[i] += rate[i];
+      ASSERT_NEAR(im[i], sine(phase[i]), 1e-10) << "grain " << i << ", frame " << f;
+      ASSERT_NEAR(re[i]*re[i] + im[i]*im[i], 1, 1e-12);
+    }
+  }
+}
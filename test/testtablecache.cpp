@@ -0,0 +1,109 @@
+#include <cmath>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "bakedtables.hpp"
+#include "tablecache.hpp"
+
+using namespace audioelectric;
+
+/*!\brief Returns the address of a Waveform's samples, without copying them
+ */
+template <typename T>
+static const T* samples(const Waveform<T>& wf)
+{
+  return wf.data();
+}
+
+TEST(tablecache, shares) {
+  TableCache<float> cache;
+  Waveform<float> a = cache.table(TableType::GAUSSIAN, 4800, 0.15f);
+  Waveform<float> b = cache.table(TableType::GAUSSIAN, 4800, 0.15f);
+  Waveform<float> c = cache.table(TableType::GAUSSIAN, 4800, 0.2f);
+  Waveform<float> d = cache.table(TableType::GAUSSIAN, 2400, 0.15f);
+  EXPECT_EQ(samples(a), samples(b));
+  EXPECT_NE(samples(a), samples(c));
+  EXPECT_NE(samples(a), samples(d));
+  // SIN has no parameter, so every parameter gets the same table
+  EXPECT_EQ(samples(cache.table(TableType::SIN, 1024)), samples(cache.table(TableType::SIN, 1024, 3.f)));
+  EXPECT_EQ(cache.size(), 4);
+
+  // The cached tables are exactly what the generators make
+  Waveform<float> check;
+  GenerateGaussian(check, 4800, 0.15f);
+  for (size_t i=0; i<check.size(); i++)
+    ASSERT_EQ(std::as_const(a)[i], std::as_const(check)[i]);
+  Waveform<float> square = cache.table(TableType::SQUARE, 64, 0.5f);
+  GenerateSquare(check, 64, 0.5f);
+  EXPECT_EQ(square.guard(), Guard::WRAPPED);
+  for (size_t i=0; i<check.size(); i++)
+    ASSERT_EQ(std::as_const(square)[i], std::as_const(check)[i]);
+
+  // Wavetables are built from the cached table, and shared too
+  Wavetable<float> mip = cache.wavetable(TableType::TRIANGLE, 256, 0.8f);
+  Wavetable<float> mip2 = cache.wavetable(TableType::TRIANGLE, 256, 0.8f);
+  ASSERT_EQ(mip.levels(), mip2.levels());
+  for (size_t lvl=0; lvl<mip.levels(); lvl++)
+    EXPECT_EQ(mip.level(lvl).data(), mip2.level(lvl).data());
+  EXPECT_EQ(mip.level(0).data(), samples(cache.table(TableType::TRIANGLE, 256, 0.8f)));
+  EXPECT_THROW(cache.wavetable(TableType::SIN, 100), WaveformError);
+
+  cache.clear();
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(std::as_const(a)[2399], 1) << "Tables that are in use outlive the cache's reference";
+}
+
+TEST(tablecache, threads) {
+  TableCache<double> cache;
+  std::vector<const double*> tables(8);
+  std::vector<std::thread> threads;
+  for (size_t t=0; t<tables.size(); t++)
+    threads.emplace_back([&, t] {tables[t] = cache.wavetable(TableType::SQUARE, 1024, 0.25).level(1).data();});
+  for (auto& thread : threads)
+    thread.join();
+  EXPECT_EQ(cache.size(), 2);
+  for (size_t t=1; t<tables.size(); t++)
+    EXPECT_EQ(tables[t], tables[0]);
+}
+
+TEST(tablecache, baked) {
+  // The generators can be evaluated by the compiler
+  static_assert(baked::triangleTable<8>(0)[2] == 0.5 && baked::triangleTable<8>(0)[6] == 0.5);
+  static_assert(baked::squareTable<8>(0.5)[3] == 0 && baked::squareTable<8>(0.5)[4] == 1);
+
+  // Only the carrier tables are baked
+  EXPECT_EQ(BakedTable(TableType::GAUSSIAN, 4096, 0.15), nullptr);
+  EXPECT_EQ(BakedTable(TableType::SIN, 4096, 0.), nullptr);
+  EXPECT_EQ(BakedTable(TableType::TRIANGLE, 4800, 0.), nullptr);
+  EXPECT_EQ(BakedTable(TableType::TRIANGLE, 2048, 0.8f), BakedTable(TableType::TRIANGLE, 2048, 0.8));
+
+  // The baked tables match the runtime generators
+  Waveform<double> check;
+  for (size_t len : {1024, 2048, 4096}) {
+    for (double slant : {0., 0.8}) {
+      const double* tri = BakedTable(TableType::TRIANGLE, len, slant);
+      ASSERT_NE(tri, nullptr);
+      GenerateTriangle(check, len, slant);
+      for (size_t i=0; i<len; i++)
+        ASSERT_EQ(tri[i], std::as_const(check)[i]);
+    }
+    const double* square = BakedTable(TableType::SQUARE, len, 0.5);
+    ASSERT_NE(square, nullptr);
+    GenerateSquare(check, len, 0.5);
+    for (size_t i=0; i<len; i++)
+      ASSERT_EQ(square[i], std::as_const(check)[i]);
+  }
+
+  // The cache hands out the baked tables with the same guards as the generated ones
+  TableCache<float> cache;
+  Waveform<float> saw = cache.table(TableType::TRIANGLE, 4096, 0.8f);
+  Waveform<float> tri;
+  GenerateTriangle(tri, 4096, 0.8f);
+  const double* table = BakedTable(TableType::TRIANGLE, 4096, 0.8f);
+  for (size_t i=0; i<saw.size(); i++)
+    ASSERT_EQ(std::as_const(saw)[i], (float)table[i]);
+  EXPECT_EQ(saw.guard(), tri.guard());
+  EXPECT_EQ(samples(saw)[4096], samples(saw)[0]);
+}
@@ -0,0 +1,70 @@
+#include <cstring>
+#include <gtest/gtest.h>
+
+#include "voice.hpp"
+
+using namespace audioelectric;
+
+TEST(voice, process) {
+  // process() evaluates the envelopes and the grain parameters at the same points as value() and increment(), whatever
+  // the control rate and however the blocks line up with the control points
+  Waveform<double> shape;
+  Waveform<double> carrier;
+  GenerateGaussian(shape, 4800, 0.15);
+  GenerateSin(carrier, 4800);
+  GrainParams<double> params(0.02, 480, 0.01, 0.25);
+  const size_t block = 100;
+
+  for (size_t rate : {1, 16, VOICE_CONTROL_FRAMES}) {
+    Voice<double> voice(shape, carrier);
+    Voice<double> check(shape, carrier);
+    voice.setControlRate(rate);
+    check.setControlRate(rate);
+    voice.trigger(params);
+    check.trigger(params);
+
+    double out[block];
+    bool sound = false;
+    for (int b=0; b<30; b++) {
+      if (b == 20) {
+        voice.release();
+        check.release();
+      }
+      memset(out, 0, sizeof(out));
+      voice.process(out, block);
+      for (size_t i=0; i<block; i++) {
+        ASSERT_NEAR(out[i], check.value(), 1e-12) << "control rate " << rate << ", block " << b << ", frame " << i;
+        sound |= out[i] != 0;
+        check.increment();
+      }
+      EXPECT_EQ((bool)voice, (bool)check) << "control rate " << rate << ", block " << b;
+    }
+    EXPECT_TRUE(sound) << "control rate " << rate;
+  }
+}
+
+TEST(voice, perFrame) {
+  // At a control period of 1, process() evaluates the parameters on every frame and applies them at once, just as
+  // value() and increment() did before there was a control rate
+  Waveform<double> shape;
+  Waveform<double> carrier;
+  GenerateGaussian(shape, 4800, 0.15);
+  GenerateSin(carrier, 4800);
+  GrainParams<double> params(0.02, 480, 0.01, 0.25);
+  Voice<double> voice(shape, carrier);
+  GrainGenerator<double> check(shape, carrier);
+  voice.setControlRate(1);
+  voice.trigger(params);
+  check.applyInputs(params);
+
+  double out[100];
+  for (int b=0; b<20; b++) {
+    memset(out, 0, sizeof(out));
+    voice.process(out, 100);
+    for (size_t i=0; i<100; i++) {
+      ASSERT_NEAR(out[i], check.value(), 1e-12) << "block " << b << ", frame " << i;
+      check.applyInputs(params);
+      check.increment();
+    }
+  }
+}
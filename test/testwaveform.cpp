@@ -1,6 +1,11 @@
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
+#include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include <portaudio.h>
@@ -125,6 +130,257 @@ TEST(waveform, fromfile_noexist)
   ASSERT_THROW(Waveform<double> wf("doesnt_exist.wav"), WaveformError);
 }
 
+TEST(waveform, fromfile_mapped)
+{
+  // A mono float WAV can be mapped rather than read
+  SF_INFO info = {0};
+  info.samplerate = 48000;
+  info.channels = 1;
+  info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+  SNDFILE* sf = sf_open("testfloat.wav", SFM_WRITE, &info);
+  ASSERT_NE(sf, nullptr);
+  std::vector<float> frames(20000);
+  for (size_t i=0; i<frames.size(); i++)
+    frames[i] = i/20000.f;
+  sf_writef_float(sf, frames.data(), frames.size());
+  sf_close(sf);
+
+  {
+    Waveform<float> mapped("testfloat.wav", 5000, 15000);
+    Waveform<float> read("testfloat.wav", 5000, 15000, InterpType::LINEAR, ChannelLayout::MIXDOWN, false);
+    EXPECT_TRUE(mapped.mapped());
+    EXPECT_FALSE(read.mapped());
+    EXPECT_EQ(mapped.samplerate(), 48000);
+    ASSERT_EQ(mapped.size(), 10000);
+    for (size_t i=0; i<mapped.size(); i++)
+      ASSERT_EQ(mapped[i], read[i]) << "frame " << i;
+
+    // Writing to a mapped waveform doesn't change the file
+    mapped[0] = 5;
+    Waveform<float> again("testfloat.wav", 5000, 15000);
+    EXPECT_EQ(again[0], read[0]);
+
+    // Copies share the mapping
+    Waveform<float> copy(again);
+    EXPECT_TRUE(copy.mapped());
+    EXPECT_TRUE(copy.shared());
+    EXPECT_EQ(copy[100], read[100]);
+    EXPECT_FALSE(copy.mapped());
+    Waveform<float> moved(std::move(again));
+    EXPECT_TRUE(moved.mapped());
+    EXPECT_EQ(moved[100], read[100]);
+
+    // The guard frames of a mapped section are zeroed, even where they reach past the ends of the file's data
+    Waveform<float> whole("testfloat.wav");
+    ASSERT_TRUE(whole.mapped());
+    const float* wdata = std::as_const(whole).data();
+    for (long g=1; g<=WAVEFORM_GUARD; g++) {
+      EXPECT_EQ(wdata[-g], 0);
+      EXPECT_EQ(wdata[whole.size() - 1 + g], 0);
+    }
+    EXPECT_FLOAT_EQ(whole.interp(whole.size() - 0.5), frames.back()/2);
+
+    // Doubles need to be converted, so they're always read
+    Waveform<double> dbl("testfloat.wav");
+    EXPECT_FALSE(dbl.mapped());
+    EXPECT_EQ(dbl.size(), frames.size());
+  }
+  std::remove("testfloat.wav");
+}
+
+TEST(waveform, shared)
+{
+  Waveform<double> wf = {0.0, 1.0, 2.0, 3.0};
+  EXPECT_FALSE(wf.shared());
+
+  // Copies share the data
+  Waveform<double> copy(wf);
+  Waveform<double> assigned;
+  assigned = wf;
+  EXPECT_TRUE(wf.shared());
+  const Waveform<double>& ccopy = copy;
+  EXPECT_EQ(ccopy.data(), static_cast<const Waveform<double>&>(wf).data());
+  EXPECT_EQ(ccopy[2], 2.0);
+  EXPECT_TRUE(copy.shared());
+
+  // Writing gives the writer its own copy
+  copy[2] = 10;
+  EXPECT_FALSE(copy.shared());
+  EXPECT_EQ(copy[2], 10);
+  EXPECT_EQ(copy[3], 3);
+  EXPECT_EQ(wf[2], 2);
+  EXPECT_EQ(assigned[2], 2);
+
+  // The last reference owns the data
+  {
+    Waveform<double> tmp(wf);
+    wf = Waveform<double>(4);
+  }
+  EXPECT_FALSE(assigned.shared());
+  EXPECT_EQ(assigned[1], 1);
+}
+
+TEST(waveform, multichannel)
+{
+  for (ChannelLayout layout : {ChannelLayout::INTERLEAVED, ChannelLayout::PLANAR}) {
+    Waveform<double> wf(10, 3, layout);
+    EXPECT_EQ(wf.size(), 10);
+    EXPECT_EQ(wf.channels(), 3);
+    EXPECT_EQ(wf.layout(), layout);
+    for (size_t i=0; i<10; i++) {
+      for (size_t c=0; c<3; c++)
+        wf.sample(i, c) = i*(c+1.);
+    }
+    if (layout == ChannelLayout::INTERLEAVED)
+      EXPECT_EQ(wf[7], 2*2.);
+    else
+      EXPECT_EQ(wf[10 + 2*WAVEFORM_GUARD + 2], 2*2.);
+
+    double frame[3];
+    for (double pos : {0., 2.5, 8.75, 9.}) {
+      wf.frame(pos, frame);
+      for (size_t c=0; c<3; c++) {
+        EXPECT_DOUBLE_EQ(wf.waveform(pos, c), pos*(c+1.)) << "pos " << pos << ", channel " << c;
+        EXPECT_EQ(frame[c], wf.waveform(pos, c));
+      }
+    }
+    wf.frame(-1, frame);
+    EXPECT_EQ(frame[2], 0);
+  }
+}
+
+TEST(waveform, fromfile_multichannel)
+{
+  SF_INFO info = {0};
+  info.samplerate = 48000;
+  info.channels = 2;
+  info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+  SNDFILE* sf = sf_open("teststereo.wav", SFM_WRITE, &info);
+  ASSERT_NE(sf, nullptr);
+  std::vector<float> frames(2*10000);
+  for (size_t i=0; i<10000; i++) {
+    frames[2*i] = i/10000.f;
+    frames[2*i+1] = -(i/10000.f);
+  }
+  sf_writef_float(sf, frames.data(), 10000);
+  sf_close(sf);
+
+  {
+    Waveform<float> mixed("teststereo.wav", 1000, 2000);
+    EXPECT_EQ(mixed.channels(), 1);
+    EXPECT_EQ(mixed[10], 0);
+
+    Waveform<float> mapped("teststereo.wav", 1000, 2000, InterpType::LINEAR, ChannelLayout::INTERLEAVED);
+    Waveform<float> inter("teststereo.wav", 1000, 2000, InterpType::LINEAR, ChannelLayout::INTERLEAVED, false);
+    Waveform<float> planar("teststereo.wav", 1000, 2000, InterpType::LINEAR, ChannelLayout::PLANAR);
+    EXPECT_TRUE(mapped.mapped());
+    EXPECT_FALSE(inter.mapped());
+    EXPECT_FALSE(planar.mapped());
+    for (auto* wf : {&mapped, &inter, &planar}) {
+      ASSERT_EQ(wf->size(), 1000);
+      ASSERT_EQ(wf->channels(), 2);
+      for (size_t i=0; i<1000; i++) {
+        ASSERT_EQ(wf->sample(i, 0), frames[2*(i+1000)]) << "frame " << i;
+        ASSERT_EQ(wf->sample(i, 1), frames[2*(i+1000)+1]) << "frame " << i;
+      }
+    }
+  }
+  std::remove("teststereo.wav");
+}
+
+TEST(waveform, guards)
+{
+  Waveform<double> wf = {1, 2, 3, 4};
+  EXPECT_EQ(wf.guard(), Guard::ZEROS);
+  const double* data = std::as_const(wf).data();
+  for (long g=1; g<=WAVEFORM_GUARD; g++) {
+    EXPECT_EQ(data[-g], 0);
+    EXPECT_EQ(data[3 + g], 0);
+  }
+  // Past the last frame, interp() fades toward the zero guard, while waveform() is zero
+  EXPECT_DOUBLE_EQ(wf.interp(3.5), 2);
+  EXPECT_EQ(wf.waveform(3.5), 0);
+  EXPECT_DOUBLE_EQ(wf.interp(1.25), wf.waveform(1.25));
+
+  // Wrapped guards are copies of the other end of the data, and setting them on shared data copies it first
+  Waveform<double> copy(wf);
+  copy.setGuard(Guard::WRAPPED);
+  EXPECT_FALSE(copy.shared());
+  EXPECT_EQ(std::as_const(wf).data()[4], 0);
+  const double* cdata = std::as_const(copy).data();
+  for (long g=1; g<=WAVEFORM_GUARD; g++) {
+    EXPECT_EQ(cdata[-g], cdata[(4 - g%4) % 4]) << "guard " << -g;
+    EXPECT_EQ(cdata[3 + g], cdata[(g - 1) % 4]) << "guard " << 3 + g;
+  }
+  EXPECT_DOUBLE_EQ(copy.cyclic(3.5), 2.5);
+  copy[0] = 10;
+  copy.updateGuards();
+  EXPECT_DOUBLE_EQ(copy.cyclic(3.5), 7);
+
+  // Each channel of a planar waveform has its own guards
+  Waveform<double> planar(4, 2, ChannelLayout::PLANAR);
+  for (size_t i=0; i<4; i++) {
+    planar.sample(i, 0) = i + 1;
+    planar.sample(i, 1) = -(i + 1.);
+  }
+  planar.setGuard(Guard::WRAPPED);
+  EXPECT_DOUBLE_EQ(planar.interp(3.5, 0), 2.5);
+  EXPECT_DOUBLE_EQ(planar.interp(3.5, 1), -2.5);
+
+  // Generated cycles wrap
+  Waveform<float> sine;
+  GenerateSin(sine, 256);
+  EXPECT_EQ(sine.guard(), Guard::WRAPPED);
+}
+
+TEST(waveform, interpolation)
+{
+  // Cubic interpolation is exact on a quadratic
+  Waveform<double> quad(16);
+  for (size_t i=0; i<16; i++)
+    quad[i] = 0.5*i*i - 3.*i;
+  quad.setInterpType(InterpType::CUBIC);
+  for (double pos : {1.0, 2.5, 7.25, 13.9})
+    EXPECT_NEAR(quad.waveform(pos), 0.5*pos*pos - 3*pos, 1e-12) << "pos " << pos;
+
+  // Windowed-sinc interpolation passes through the samples, and it follows a sine much more closely than linear
+  // interpolation does
+  Waveform<double> sine(256);
+  for (size_t i=0; i<256; i++)
+    sine[i] = sin(2*M_PI*i/16);
+  Waveform<double> linear(sine);
+  sine.setInterpType(InterpType::SINC);
+  double sincerr = 0, linerr = 0;
+  for (double pos=16; pos<240; pos+=0.37) {
+    double val = sin(2*M_PI*pos/16);
+    sincerr = std::max(sincerr, std::abs(sine.waveform(pos) - val));
+    linerr = std::max(linerr, std::abs(linear.waveform(pos) - val));
+  }
+  EXPECT_LT(sincerr, 1e-3);
+  EXPECT_GT(linerr, 10*sincerr);
+  for (size_t i=0; i<256; i+=7)
+    EXPECT_NEAR(sine.waveform(i), sine[i], 1e-12);
+
+  // The vectorized sinc kernel matches the scalar one, on mono and interleaved data alike
+  Waveform<float> fsine(64, 2, ChannelLayout::INTERLEAVED);
+  for (size_t i=0; i<64; i++) {
+    fsine.sample(i, 0) = sin(2*M_PI*i/16);
+    fsine.sample(i, 1) = cos(2*M_PI*i/9);
+  }
+  const float* fdata = std::as_const(fsine).data();
+  for (double diff=0; diff<1; diff+=0.0625) {
+    for (size_t i=0; i<64; i++) {
+      EXPECT_EQ(kernel::sinc(fdata + 2*i, 2, diff), kernel::sincScalar(fdata + 2*i, 2, diff));
+      EXPECT_EQ(kernel::sinc(fdata + 2*i + 1, 2, diff), kernel::sincScalar(fdata + 2*i + 1, 2, diff));
+    }
+  }
+  Waveform<float> fmono(64);
+  for (size_t i=0; i<64; i++)
+    fmono[i] = sin(2*M_PI*i/16);
+  for (double diff=0; diff<1; diff+=0.0625)
+    EXPECT_EQ(kernel::sinc(fmono.data() + 30, 1, diff), kernel::sincScalar(fmono.data() + 30, 1, diff));
+}
+
 class SimpleWaveformTest : public ::testing::Test {
 protected:
 
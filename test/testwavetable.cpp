@@ -0,0 +1,81 @@
+#include <cmath>
+#include <gtest/gtest.h>
+
+#include "phasor.hpp"
+#include "wavetable.hpp"
+
+using namespace audioelectric;
+
+/*!\brief Returns the magnitude of a harmonic of a single cycle
+ */
+static double harmonic(const Waveform<double>& wf, size_t h)
+{
+  double re = 0, im = 0;
+  for (size_t i=0; i<wf.size(); i++) {
+    re += wf[i]*cos(2*M_PI*h*i/wf.size());
+    im -= wf[i]*sin(2*M_PI*h*i/wf.size());
+  }
+  return sqrt(re*re + im*im)/wf.size();
+}
+
+TEST(wavetable, levels) {
+  Waveform<double> saw;
+  GenerateTriangle(saw, 256, 0.8);
+  Wavetable<double> mip(saw);
+  ASSERT_EQ(mip.levels(), 8);
+  EXPECT_EQ(mip.size(), 256);
+
+  for (size_t i=0; i<saw.size(); i++)
+    EXPECT_EQ(mip.level(0)[i], saw[i]);
+
+  for (size_t lvl=1; lvl<mip.levels(); lvl++) {
+    const Waveform<double>& wf = mip.level(lvl);
+    ASSERT_EQ(wf.size(), saw.size());
+    size_t limit = mip.harmonics(lvl);
+    EXPECT_NEAR(harmonic(wf, 0), harmonic(saw, 0), 1e-12) << "level " << lvl;
+    for (size_t h=1; h<=limit; h++)
+      EXPECT_NEAR(harmonic(wf, h), harmonic(saw, h), 1e-12) << "level " << lvl << ", harmonic " << h;
+    for (size_t h=limit+1; h<=saw.size()/2; h++)
+      EXPECT_NEAR(harmonic(wf, h), 0, 1e-12) << "level " << lvl << ", harmonic " << h;
+  }
+}
+
+TEST(wavetable, levelFor) {
+  Waveform<double> saw;
+  GenerateTriangle(saw, 256, 0.8);
+  Wavetable<double> mip(saw);
+  EXPECT_EQ(mip.levelFor(0), 0);
+  EXPECT_EQ(mip.levelFor(1), 0);
+  EXPECT_EQ(mip.levelFor(1.01), 1);
+  EXPECT_EQ(mip.levelFor(2), 1);
+  EXPECT_EQ(mip.levelFor(-3), 2);
+  EXPECT_EQ(mip.levelFor(4), 2);
+  EXPECT_EQ(mip.levelFor(100), 7);
+  EXPECT_EQ(mip.levelFor(1000), 7);
+
+  Waveform<double> odd(100);
+  EXPECT_THROW(Wavetable<double> bad(odd), WaveformError);
+}
+
+TEST(wavetable, phasor) {
+  Waveform<double> saw;
+  GenerateTriangle(saw, 256, 0.8);
+  Wavetable<double> mip(saw);
+
+  auto phs = Phasor<double>(mip, 3.3, true);
+  auto check = Phasor<double>(mip.level(2), 3.3, true);
+  for (int i=0; i<100; i++) {
+    EXPECT_DOUBLE_EQ(phs.value(), check.value()) << "iter " << i;
+    phs.increment();
+    check.increment();
+  }
+
+  // Changing the rate changes the level
+  phs.setRate(0.7);
+  auto check0 = Phasor<double>(mip.level(0), 0.7, true, phs.getPhase());
+  for (int i=0; i<100; i++) {
+    EXPECT_DOUBLE_EQ(phs.value(), check0.value()) << "iter " << i;
+    phs.increment();
+    check0.increment();
+  }
+}